@@ -134,6 +134,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <sys/uio.h>
 
 /**
  * @ingroup DTCPMGR_DS
@@ -157,11 +158,67 @@ typedef enum {
 	DTCP_ERR_CONT_KEY_REQ        = -8, /**< Content key error.                   */
 	DTCP_ERR_INVALID_KEY_LABEL   = -9, /**< Invalid exchange key label supplied. */
 	DTCP_ERR_INVALID_IP_ADDRESS	 = -10, /**< Invalid IP address supplied.         */  
-	DTCP_ERR_SERVER_NOT_REACHABLE	= -11  /**< DTCP Server not reachable.           */
+	DTCP_ERR_SERVER_NOT_REACHABLE	= -11, /**< DTCP Server not reachable.           */
+	DTCP_ERR_TIMEOUT             = -12, /**< No result within the given time.     */
+	DTCP_ERR_BUSY                = -13 /**< Too many packets in flight.          */
 } dtcp_result_t;
 
 typedef unsigned char  BOOLEAN;
 
+/**
+ * @brief DTCP Manager log levels.
+ *
+ * A level enables its own messages and those of all lower levels.
+ */
+typedef enum {
+	DTCP_LOG_NONE  = 0,  /**< Logging off.                               */
+	DTCP_LOG_ERROR = 1,  /**< Failures.                                  */
+	DTCP_LOG_WARN  = 2,  /**< Unexpected conditions that are handled.    */
+	DTCP_LOG_INFO  = 3,  /**< Initialization and session lifecycle.      */
+	DTCP_LOG_DEBUG = 4,  /**< Details of API calls.                      */
+	DTCP_LOG_TRACE = 5   /**< Every API call, including per-packet ones. */
+} DTCPLogLevel;
+
+/**
+ * @brief Size of a PCP header in bytes.
+ */
+#define DTCPIP_PCP_HEADER_SIZE 14
+
+/**
+ * @brief PCPPacketSize of DTCPMgrCreateSourceSession() that sizes PCPs from the bitrate of the stream.
+ */
+#define DTCPIP_PCP_SIZE_ADAPTIVE (-1)
+
+/**
+ * @brief Largest number of segments of a processed packet, see DTCPMgrGetPacketSegments().
+ */
+#define DTCPIP_MAX_PACKET_SEGMENTS 3
+
+/**
+ * @brief DTCPMgrProcessToFd() flag: send with MSG_ZEROCOPY where the socket supports it.
+ */
+#define DTCPIP_FD_ZEROCOPY 0x1
+
+/**
+ * @brief Largest number of packets submitted to a session and not yet completed.
+ */
+#define DTCPIP_MAX_IN_FLIGHT 64
+
+/**
+ * @brief Largest number of source sessions that can join one shared stream.
+ */
+#define DTCPIP_MAX_SHARED_MEMBERS 32
+
+/**
+ * @brief Number of buckets of a ::DTCPIP_Histogram.
+ */
+#define DTCPIP_HISTOGRAM_BUCKETS 40
+
+/**
+ * @brief Handle passed to DTCPMgrGetSessionStats() for the totals of all sessions.
+ */
+#define DTCPIP_ALL_SESSIONS ((DTCP_SESSION_HANDLE)0)
+
 /**
  * @brief DTCP-IP session handle.
  *
@@ -216,8 +273,143 @@ typedef struct DTCPIP_Session_s
     DTCPDeviceType device_type;          /**< Type of device (source/sink).  */
     char * remote_ip;                    /**< Remote source/sink IP address. */
     BOOLEAN uniqueKey;                   /**< Flag indicating unique key.    */
+    int PCPPacketSize;                   /**< Current minimum PCP size of a source session, 0 for one PCP per
+                                              buffer and for sink sessions. */
 } DTCPIP_Session;
 
+/**
+ * @brief DTCP-IP session buffer pool information.
+ *
+ * This structure reports the state of a buffer pool used by a session for the buffers
+ * returned in ::DTCPIP_Packet. Buffers are recycled by DTCPMgrReleasePacket(), so once a
+ * session has reached its working set, @a heapAllocations stops increasing.
+ */
+typedef struct DTCPIP_BufferPoolInfo_s
+{
+    uint32_t bufferSize;        /**< Size of each pooled buffer in bytes.                          */
+    uint32_t buffersAllocated;  /**< Buffers owned by the pool, free or in use.                    */
+    uint32_t buffersInUse;      /**< Buffers currently held by processed, unreleased packets.      */
+    uint32_t highWaterMark;     /**< Largest number of buffers in use at the same time.            */
+    uint64_t heapAllocations;   /**< Heap allocations made by the pool since the session started.  */
+} DTCPIP_BufferPoolInfo;
+
+/**
+ * @brief Log-scale latency histogram.
+ *
+ * Bucket i counts durations of 2^i to 2^(i+1)-1 nanoseconds. Bucket 0 also counts zero durations,
+ * the last bucket everything longer.
+ */
+typedef struct DTCPIP_Histogram_s
+{
+    uint64_t count;                               /**< Durations recorded.                */
+    uint64_t totalNs;                             /**< Sum of the recorded durations.     */
+    uint64_t buckets[DTCPIP_HISTOGRAM_BUCKETS];   /**< Durations recorded in each bucket. */
+} DTCPIP_Histogram;
+
+/**
+ * @brief DTCP-IP session statistics.
+ *
+ * Counters start at zero when the session is created. For ::DTCPIP_ALL_SESSIONS the counters and
+ * histograms cover every session since DTCPMgrInitialize(), deleted ones included, while the pool
+ * figures are the sums over the active sessions (with bufferSize 0).
+ *
+ * Packets processed together by DTCPMgrProcessPacketV() are not timed one by one: each is recorded
+ * in processLatency with the average time of the packets in its call.
+ */
+typedef struct DTCPIP_SessionStats_s
+{
+    uint64_t bytesIn;                   /**< Bytes passed in dataInPtr of successfully processed packets. */
+    uint64_t bytesOut;                  /**< Bytes returned, PCP headers included.                        */
+    uint64_t packets;                   /**< Packets processed successfully.                              */
+    uint64_t errors;                    /**< Packets whose processing failed.                             */
+    uint64_t pcps;                      /**< PCPs started (source) or parsed (sink).                      */
+    uint64_t ncRotations;               /**< Times the content key changed because Nc did.                */
+    DTCPIP_BufferPoolInfo dataPool;     /**< See DTCPMgrGetBufferPoolInfo().                              */
+    DTCPIP_BufferPoolInfo headerPool;   /**< See DTCPMgrGetBufferPoolInfo().                              */
+    DTCPIP_Histogram processLatency;    /**< Time to process each packet, on whichever thread did it.     */
+    DTCPIP_Histogram akeLatency;        /**< Time to authenticate and establish the exchange key.         */
+} DTCPIP_SessionStats;
+
+/**
+ * @brief Result of DTCPMgrProcessFile().
+ */
+typedef struct DTCPIP_FileStats_s
+{
+    uint64_t bytesIn;                   /**< Bytes read from the input file.                    */
+    uint64_t bytesOut;                  /**< Bytes written to the output, PCP headers included. */
+    uint64_t elapsedNs;                 /**< Time from mapping the input to the last write.     */
+} DTCPIP_FileStats;
+
+/**
+ * @brief Result of DTCPMgrWaitInitialized().
+ */
+typedef struct DTCPIP_InitStats_s
+{
+    uint64_t initializeNs;              /**< Time spent in the first DTCPMgrInitialize() or DTCPMgrInitializeEx(). */
+    uint64_t deferredNs;                /**< Time of the part of the initialization run in the background.        */
+    uint64_t waitedNs;                  /**< Total time callers were held up waiting for that part.               */
+    BOOLEAN  cacheHit;                  /**< The derived tables were mapped from DTCPIP_Config::cachePath.        */
+} DTCPIP_InitStats;
+
+/**
+ * @brief Output buffer modes.
+ *
+ * This enumeration defines where DTCPMgrProcessPacketEx() places the processed data.
+ */
+typedef enum {
+	DTCP_OUTPUT_ALLOCATED,  /**< Buffers allocated by DTCP Manager, as with DTCPMgrProcessPacket(). */
+	DTCP_OUTPUT_IN_PLACE,   /**< Processed data overwrites the input buffer at dataInPtr.           */
+	DTCP_OUTPUT_CALLER      /**< Processed data is written into a buffer supplied by the caller.    */
+} DTCPOutputMode;
+
+/**
+ * @brief DTCP-IP output buffer structure.
+ *
+ * This structure describes the destination of a packet processed with DTCPMgrProcessPacketEx().
+ * The caller buffer may be any CPU-mapped memory, e.g. a mapped memfd or dma-buf backed GStreamer buffer.
+ * (For dma-buf memory the caller is responsible for the CPU access synchronization around the call.)
+ */
+typedef struct DTCPIP_OutputBuffer_s
+{
+    DTCPOutputMode mode;    /**< Output buffer mode.                                                            */
+    uint8_t *dataPtr;       /**< (DTCP_OUTPUT_CALLER) Virtual data buffer, allocated by the caller.             */
+    uint8_t *dataPhyPtr;    /**< (DTCP_OUTPUT_CALLER) Physical data buffer, allocated by the caller.
+                                 (Set to NULL if not available.)                                                */
+    uint32_t capacity;      /**< Size in bytes of dataPtr (DTCP_OUTPUT_CALLER) or of the buffer at
+                                 dataInPtr (DTCP_OUTPUT_IN_PLACE). See DTCPMgrGetOutputSize().                  */
+    uint8_t *headerPtr;     /**< (Source, DTCP_OUTPUT_IN_PLACE and DTCP_OUTPUT_CALLER) Caller buffer of at least
+                                 DTCPIP_PCP_HEADER_SIZE bytes receiving the PCP header.                          */
+} DTCPIP_OutputBuffer;
+
+/**
+ * @brief DTCP Manager configuration.
+ *
+ * This structure holds the settings fixed at DTCPMgrInitializeEx() time.
+ */
+typedef struct DTCPIP_Config_s
+{
+    uint32_t numWorkers;    /**< Number of threads of the internal worker pool that processes packets passed to
+                                 DTCPMgrSubmitPacket() and DTCPMgrProcessPacketAsync(), at most 64.
+                                 (0 processes them in the submitting thread.)                                    */
+    BOOLEAN asyncLog;       /**< Write log messages from a background thread through a lock-free ring, so that
+                                 logging threads do not block on stdout. When it is full, messages are dropped,
+                                 except errors, which are written directly.                                      */
+    const uint8_t *srm;     /**< System Renewability Message whose revoked devices the AKE refuses, or NULL.
+                                 It is parsed once; see DTCPMgrUpdateSRM().                                     */
+    uint32_t srmLength;     /**< Length of srm in bytes.                                                         */
+    const char *cachePath;  /**< File in which tables derived at initialization, such as the index of srm, are
+                                 kept across restarts, or NULL to derive them at every start. The directory
+                                 should be writable by the DTCP Manager only.                                    */
+} DTCPIP_Config;
+
+/**
+ * @brief Completion callback of DTCPMgrProcessPacketAsync().
+ *
+ * Called on a worker thread, in submit order within a session, with the processed packet and the
+ * result of processing it. A successfully processed packet must be released with DTCPMgrReleasePacket().
+ */
+typedef void (*DTCPIP_CompletionCallback)(DTCPIP_Packet *packet, dtcp_result_t result, void *userData);
+
 /** @} */ //End of Doxygen tag DTCPMGR_DS
 
 /**
@@ -240,6 +432,67 @@ typedef struct DTCPIP_Session_s
  */
 dtcp_result_t DTCPMgrInitialize(void);
 
+/**
+ * @brief Initializes the DTCP Manager with a configuration.
+ *
+ * This function is DTCPMgrInitialize() with settings. With @a config->numWorkers greater than 0 an internal
+ * worker pool is started, which spreads packets submitted with DTCPMgrSubmitPacket() across cores.
+ * The pool is started by the first successful call only and stays up for the life of the process.
+ * An SRM in @a config->srm is parsed into the revocation index every AKE checks its peer against.
+ *
+ * Only the configuration checks and the thread starts are done before this function returns. Deriving
+ * the tables the AKE needs, such as the SRM index, is left to a background thread, once per process,
+ * and DTCPMgrStartSource() and DTCPMgrCreateSinkSession() wait for it on first use, failing as
+ * DTCPMgrWaitInitialized() does if it failed. DTCPMgrUpdateSRM() waits for it too.
+ * With @a config->cachePath set the tables are kept in that file, so later starts map them instead.
+ * @a config->srm is copied and may be freed on return.
+ * Initializing again after DTCPMgrStopSource() takes the cache path and SRM of @a config, waiting for
+ * the background part of the first initialization if it is still running.
+ *
+ * @param[in] config Configuration (NULL is the same as DTCPMgrInitialize()).
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           DTCP Manager successfully initialized.
+ * @retval DTCP_ERR_INVALID_PARAM @a config->numWorkers is too large, or the header of @a config->srm is
+ *                                malformed. (Malformed entries are reported by DTCPMgrWaitInitialized().)
+ *                                On re-initialization also if the SRM is malformed or older than the one in use.
+ * @retval DTCP_ERR_GENERAL       The worker threads or the initialization thread could not be started.
+ */
+dtcp_result_t DTCPMgrInitializeEx(const DTCPIP_Config *config);
+
+/**
+ * @brief Waits for the background part of the initialization.
+ *
+ * Returns at once if it is done, or if the DTCP Manager was never initialized.
+ *
+ * @param[out] stats The address of a location to fill with the initialization times (may be NULL).
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           The initialization is complete.
+ * @retval DTCP_ERR_INVALID_PARAM The SRM given to DTCPMgrInitializeEx() is malformed, and no SRM is in use.
+ * @retval DTCP_ERR_MEMORY_ALLOC  The SRM index could not be allocated.
+ */
+dtcp_result_t DTCPMgrWaitInitialized(DTCPIP_InitStats *stats);
+
+/**
+ * @brief Replaces the System Renewability Message (SRM) with a newer one.
+ *
+ * Both ends of an AKE refuse a peer whose device ID the SRM revokes, with ::DTCP_ERR_INVALID_CERTIFICATE.
+ * The SRM is parsed into an index of merged ID ranges behind a Bloom filter, so a check takes a few bit
+ * tests for most devices and a binary search otherwise, whatever the size of the SRM. The new index is
+ * built while the previous one stays in use and then swapped in, so AKEs in progress are not held up.
+ * Exchange keys cached from a source revoked by the new SRM are no longer used.
+ *
+ * @param[in] srm    The SRM, as distributed by the DTCP licensing authority.
+ * @param[in] length Length of @a srm in bytes.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           The SRM is in use.
+ * @retval DTCP_ERR_INVALID_PARAM @a srm is malformed, or its version is not newer than that of the SRM in use.
+ * @retval DTCP_ERR_MEMORY_ALLOC  The index could not be allocated.
+ */
+dtcp_result_t DTCPMgrUpdateSRM(const uint8_t *srm, uint32_t length);
+
 /**
  * @brief Starts the DTCP-IP source.
  * 
@@ -248,11 +501,18 @@ dtcp_result_t DTCPMgrInitialize(void);
  *
  * @note Calling this function multiple times adds multiple listeners.
  *
- * @param[in] ifName   Interface name (e.g. "eth0").
+ * All listeners and the AKE handshakes in progress are served by one thread with non-blocking
+ * sockets, so many sinks can authenticate at once and a slow sink does not delay the others.
+ * The first call generates the source's exchange key, which ::DTCPMgrCreateSourceSession()
+ * uses from then on.
+ *
+ * @param[in] ifName   Interface name (e.g. "eth0"), or NULL or "" to listen on all interfaces.
  * @param[in] portNum  TCP/IP port number that the source listens for AKE requests.
  *
  * @return Error code.
  * @retval ::DTCP_SUCCESS    Successfully started the DTCP-IP source and/or added a listener.
+ * @retval ::DTCP_ERR_INVALID_PARAM @a ifName has no IPv4 address, or @a portNum is out of range.
+ * @retval ::DTCP_ERR_GENERAL       The port could not be bound, or too many listeners were added.
  *
  * @par Example usage
  * @code
@@ -265,7 +525,8 @@ dtcp_result_t DTCPMgrStartSource(char* ifName, int portNum);
  * @brief Stops the DTCP-IP source.
  * 
  * This function stops the DTCP-IP source and removes all AKE request listeners
- * added with ::DTCPMgrStartSource().
+ * added with ::DTCPMgrStartSource(). Handshakes in progress are dropped and the
+ * exchange keys issued so far become invalid.
  *
  * @return Error code.
  * @retval DTCP_SUCCESS Successfully stopped the DTCP-IP source and removed all listeners.
@@ -280,12 +541,19 @@ dtcp_result_t DTCPMgrStopSource(void);
  * @param[in] sinkIpAddress IP address of the remote DTCP-IP sink.
  * @param[in] key_label Exchange key label, if available from streaming request.
  * If provided, the stream will be encrypted with the session key.
+ * While the source is started, the label must be one the AKE issued to a sink, and -1 selects
+ * the source's shared exchange key.
  * @param [in] PCPPacketSize  Minimum size of a packet. If the buffer provided in DTCPMgrProcessPacket() is less
  * than @a PCPPacketSize, then the PCP packet is set to @a PCPPacketSize and fragmented across multiple DTCPIP_Packets.
  * @n This is for reducing PCP space and processing overheads for low latency low bit-rate transfers
  * where each buffer can be very small. @a PCPPacketSize of 0 would return every buffer as a PCP packet.
  * @n i.e. If @a PCPPacketSize is 64 KB and if the buffer size in DTCPMgrProcessPacket() is 1 KB, the first decrypted
  * buffer would be a PCP packet. And after first packet, decrypted buffer wouldn't have a PCP header until 64 KB.
+ * @n With ::DTCPIP_PCP_SIZE_ADAPTIVE the content must be an MPEG transport stream. Every buffer is a PCP until
+ * the stream's bitrate is measured from its PCRs, which takes about 100 ms of stream time; from then on
+ * PCPs span about 100 ms of the stream, in multiples of 752 bytes (four TS packets, a whole number of AES
+ * blocks). Content that is not a transport stream keeps one PCP per buffer. ::DTCPMgrGetSessionInfo()
+ * reports the size in use.
  * @param [in] maxPacketSize  Maximum size of a packet.
  * @n If the @a DataLength provided in DTCPMgrProcessPacket() is more than @a MaxPacketSize,
  * the DTCP library can reject the process request.
@@ -294,6 +562,10 @@ dtcp_result_t DTCPMgrStopSource(void);
  *
  * @return Error code.
  * @retval DTCP_SUCCESS Successfully created a DTCP-IP source session.
+ * @retval DTCP_ERR_OUT_OF_SESSIONS The maximum number of concurrent sessions is reached.
+ * @retval DTCP_ERR_INVALID_KEY_LABEL The started source has issued no exchange key with @a key_label.
+ * @retval DTCP_ERR_INVALID_PARAM @a PCPPacketSize is negative and not ::DTCPIP_PCP_SIZE_ADAPTIVE, or too large.
+ * @retval DTCP_ERR_GENERAL No random initial Nc could be drawn from the kernel.
  */
 dtcp_result_t DTCPMgrCreateSourceSession(char *sinkIpAddress, int key_label, int PCPPacketSize, int maxPacketSize, DTCP_SESSION_HANDLE *handle);
 
@@ -301,9 +573,17 @@ dtcp_result_t DTCPMgrCreateSourceSession(char *sinkIpAddress, int key_label, int
  * @brief Creates a new DTCP-IP sink session.
  *
  * This function creates a new authenticated session with a remote DTCP-IP source.
+ * If @a srcIpPort is positive, an AKE with the source obtains the exchange key first, and
+ * the session then fails PCPs of any other exchange key label with ::DTCP_ERR_INVALID_KEY_LABEL.
  *
- * @param[in] srcIpAddress IP address of the remote DTCP-IP source.
- * @param[in] srcIpPort TCP/IP port of the remote DTCP-IP source.
+ * The shared exchange key of a source is cached by source address, port and key label for the
+ * validity the source gave it, so a new session with the same source, e.g. on a channel change,
+ * skips the AKE. A session that fails with ::DTCP_ERR_INVALID_KEY_LABEL drops the cached key,
+ * since the source has restarted or replaced it; creating the session again runs a new AKE.
+ * Keys requested with @a uniqueKey are never cached.
+ *
+ * @param[in] srcIpAddress IPv4 address of the remote DTCP-IP source.
+ * @param[in] srcIpPort TCP/IP port of the remote DTCP-IP source, 0 to skip the AKE.
  * @param[in] uniqueKey Flag to request unique exchange keys.
  * (Both server and client should have 'session exchange key' support.)
  * @param[in] maxPacketSize Maximum size of packet. If @a DataLength provided in DTCPMgrProcessPacket()
@@ -312,6 +592,11 @@ dtcp_result_t DTCPMgrCreateSourceSession(char *sinkIpAddress, int key_label, int
  *
  * @return Error code.
  * @retval DTCP_SUCCESS Successfully created a DTCP-IP sink session.
+ * @retval DTCP_ERR_OUT_OF_SESSIONS The maximum number of concurrent sessions is reached.
+ * @retval DTCP_ERR_INVALID_IP_ADDRESS @a srcIpAddress is not an IPv4 address.
+ * @retval DTCP_ERR_SERVER_NOT_REACHABLE No connection to the source could be made.
+ * @retval DTCP_ERR_AKE The source rejected the AKE, or it did not complete in time.
+ * @retval DTCP_ERR_INVALID_CERTIFICATE The SRM revokes the source, or the source's SRM revokes this device.
  */
 dtcp_result_t DTCPMgrCreateSinkSession(char *srcIpAddress, int srcIpPort, BOOLEAN uniqueKey, int maxPacketSize, DTCP_SESSION_HANDLE *handle);
 
@@ -322,6 +607,10 @@ dtcp_result_t DTCPMgrCreateSinkSession(char *srcIpAddress, int srcIpPort, BOOLEA
  * - Source - encrypt the provided buffers and create a DTCP-IP packet.
  * - Sink - process the DTCP-IP packet and return decrypted buffers.
  *
+ * A sink accepts the PCP stream in buffers of any size, split anywhere, also inside a PCP header or an
+ * AES block, e.g. as HTTP chunks arrive. Bytes that do not complete an AES block yet are kept by the
+ * session and decrypted with the next buffer, so no staging copy is needed in the caller.
+ *
  * @note All processing is done inside the ::DTCPIP_Packet data structure.
  *
  * @param[in] session Session handle.
@@ -331,13 +620,411 @@ dtcp_result_t DTCPMgrCreateSinkSession(char *srcIpAddress, int srcIpPort, BOOLEA
  * @retval DTCP_SUCCESS  Successfully processed the packet.
  */
 dtcp_result_t DTCPMgrProcessPacket(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet);
-    
+
+/**
+ * @brief Gets the output buffer size needed to process a packet.
+ *
+ * This function returns the buffer size that DTCPMgrProcessPacketEx() requires for a packet of
+ * @a dataLength bytes in the modes DTCP_OUTPUT_IN_PLACE and DTCP_OUTPUT_CALLER.
+ * A source may emit more bytes than it was given: the AES padding of a PCP that ends in the
+ * buffer, the partial AES block carried from the previous buffer and, at end of stream,
+ * the remainder of an open PCP. A sink may emit up to 15 bytes more than it was given, from
+ * the partial AES block carried from the previous buffer.
+ *
+ * @param[in]  session    Session handle.
+ * @param[in]  dataLength Length of the input buffer in bytes.
+ * @param[in]  isEOF      Whether the buffer will be the last one of the session.
+ * @param[out] outputSize The address of a location to hold the required size on return.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully returned the size.
+ * @retval DTCP_ERR_INVALID_PARAM @a session is not a handle of an active session.
+ */
+dtcp_result_t DTCPMgrGetOutputSize(DTCP_SESSION_HANDLE session, uint32_t dataLength, BOOLEAN isEOF, uint32_t *outputSize);
+
+/**
+ * @brief Processes a DTCP-IP packet into a chosen output buffer.
+ *
+ * This function is DTCPMgrProcessPacket() with control over the output buffer:
+ * - DTCP_OUTPUT_ALLOCATED - same as DTCPMgrProcessPacket().
+ * - DTCP_OUTPUT_IN_PLACE - the result overwrites dataInPtr and dataOutPtr is set to dataInPtr.
+ * - DTCP_OUTPUT_CALLER - the result is written to @a output->dataPtr, which becomes dataOutPtr.
+ *
+ * In the last two modes no copy between a DTCP Manager buffer and the pipeline's buffer is needed.
+ * The PCP header of a source is written to @a output->headerPtr and pcpHeader points to it.
+ *
+ * @note In the modes DTCP_OUTPUT_IN_PLACE and DTCP_OUTPUT_CALLER the packet holds no DTCP Manager buffers
+ * and must not be passed to DTCPMgrReleasePacket().
+ *
+ * @param[in]     session Session handle.
+ * @param[in,out] packet  Address of the location of the processed DTCP-IP packet.
+ * @param[in]     output  Output buffer description (NULL is the same as DTCP_OUTPUT_ALLOCATED).
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully processed the packet.
+ * @retval DTCP_ERR_INVALID_PARAM The output buffer is smaller than DTCPMgrGetOutputSize(), or a
+ * required buffer is missing.
+ */
+dtcp_result_t DTCPMgrProcessPacketEx(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet, const DTCPIP_OutputBuffer *output);
+
+/**
+ * @brief Submits a DTCP-IP packet for processing by the worker pool.
+ *
+ * This function queues the packet and returns; the packet is processed as by DTCPMgrProcessPacket()
+ * on one of the worker threads configured with DTCPMgrInitializeEx(), or in the calling thread if there
+ * are none. Submitted packets of a session are completed in submit order. Packets that start on a PCP
+ * boundary do not depend on the ones before them and are processed in parallel, so even a single session
+ * scales across cores when each buffer starts a new PCP (e.g. PCPPacketSize 0).
+ *
+ * At most DTCPIP_MAX_IN_FLIGHT packets per session are outstanding; further submissions wait for
+ * DTCPMgrCompletePacket().
+ * A synchronous call on the session, e.g. DTCPMgrProcessPacket(), first waits until all submitted packets
+ * are processed.
+ *
+ * @note The packet must stay valid until it is returned by DTCPMgrCompletePacket(). Packets of one session
+ * must be submitted from one thread at a time. Packets processed but not completed when the session is deleted
+ * are released with DTCPMgrReleasePacket().
+ *
+ * @param[in]     session Session handle.
+ * @param[in,out] packet  Address of the location of the DTCP-IP packet.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Packet queued.
+ * @retval DTCP_ERR_INVALID_PARAM Invalid session or packet, or packets with a completion callback are outstanding.
+ * @retval DTCP_ERR_MEMORY_ALLOC  The session's submission queue could not be allocated.
+ */
+dtcp_result_t DTCPMgrSubmitPacket(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet);
+
+/**
+ * @brief Completes the oldest packet submitted to a session.
+ *
+ * This function waits until the oldest outstanding packet of the session has been processed and returns it
+ * together with its processing result. A successfully processed packet must be released with
+ * DTCPMgrReleasePacket() as usual.
+ *
+ * @param[in]  session   Session handle.
+ * @param[in]  timeoutMs Time to wait in milliseconds, also for a packet submitted meanwhile by another thread,
+ *                       0 to poll, negative to wait as long as packets are outstanding.
+ * @param[out] packet    The address of a location to hold the completed packet.
+ * @param[out] result    The address of a location to hold the result of processing the packet.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           A packet was completed.
+ * @retval DTCP_ERR_TIMEOUT       No packet was processed in time, or none is outstanding.
+ * @retval DTCP_ERR_INVALID_PARAM Invalid session, @a packet or @a result.
+ */
+dtcp_result_t DTCPMgrCompletePacket(DTCP_SESSION_HANDLE session, int timeoutMs, DTCPIP_Packet **packet, dtcp_result_t *result);
+
+/**
+ * @brief Processes a DTCP-IP packet asynchronously.
+ *
+ * This function is DTCPMgrSubmitPacket() that never waits: when DTCPIP_MAX_IN_FLIGHT packets of the session
+ * are outstanding it returns DTCP_ERR_BUSY, and the caller retries once some have completed. The caller's
+ * thread is free for network I/O while the packet is encrypted or decrypted on the worker pool.
+ *
+ * With a @a callback the packet is completed by calling it, see DTCPIP_CompletionCallback. Without one
+ * the packet is returned by DTCPMgrCompletePacket(), and the session's completion fd (see
+ * DTCPMgrGetCompletionFd()) becomes readable when it has been processed.
+ *
+ * @note Packets outstanding at the same time must all have a callback or all have none. The callback must
+ * not call synchronous functions of the same session, e.g. DTCPMgrProcessPacket(). Callbacks of packets still
+ * undelivered when the session is deleted are not called.
+ *
+ * @param[in]     session  Session handle.
+ * @param[in,out] packet   Address of the location of the DTCP-IP packet.
+ * @param[in]     callback Completion callback, or NULL to complete with DTCPMgrCompletePacket().
+ * @param[in]     userData Passed to @a callback.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Packet queued.
+ * @retval DTCP_ERR_BUSY          DTCPIP_MAX_IN_FLIGHT packets are outstanding; nothing was queued.
+ * @retval DTCP_ERR_INVALID_PARAM Invalid session or packet, or outstanding packets are completed the other way.
+ * @retval DTCP_ERR_MEMORY_ALLOC  The session's submission queue could not be allocated.
+ */
+dtcp_result_t DTCPMgrProcessPacketAsync(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet,
+                                        DTCPIP_CompletionCallback callback, void *userData);
+
+/**
+ * @brief Returns a pollable descriptor signalling processed packets of a session.
+ *
+ * The descriptor is an eventfd owned by the session and closed when it is deleted. It becomes readable
+ * each time a packet submitted without a callback has been processed. After poll() reports it readable,
+ * read its 8-byte counter and call DTCPMgrCompletePacket() with timeout 0 until it returns DTCP_ERR_TIMEOUT.
+ *
+ * @param[in]  session Session handle.
+ * @param[out] fd      The address of a location to hold the descriptor.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully returned the descriptor.
+ * @retval DTCP_ERR_INVALID_PARAM Invalid session or @a fd.
+ * @retval DTCP_ERR_MEMORY_ALLOC  The session's submission queue could not be allocated.
+ */
+dtcp_result_t DTCPMgrGetCompletionFd(DTCP_SESSION_HANDLE session, int *fd);
+
+/**
+ * @brief Processes a batch of DTCP-IP packets.
+ *
+ * This function is the vectored form of DTCPMgrProcessPacket(). Every entry of @a packets is processed
+ * as if it had been passed to DTCPMgrProcessPacket() together with its own @a session member, in array order.
+ * Packets of several sessions may be mixed in one batch. Consecutive packets of the same session share one
+ * session lookup, which amortizes the per-call overhead for small buffers.
+ *
+ * @note A failure on one packet does not stop processing of the remaining packets.
+ * Each successfully processed packet must still be released with DTCPMgrReleasePacket().
+ *
+ * @param[in,out] packets    Array of DTCP-IP packets to process.
+ * @param[in]     numPackets Number of entries in @a packets.
+ * @param[out]    results    Array of @a numPackets entries receiving the result of each packet (may be NULL).
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           All packets were processed successfully.
+ * @retval DTCP_ERR_INVALID_PARAM @a packets is NULL.
+ * @n Otherwise, the error code of the first packet that failed.
+ *
+ * @par Example usage
+ * @code
+      DTCPIP_Packet packets[8];
+      dtcp_result_t results[8];
+      dtcp_result_t result = DTCPMgrProcessPacketV(packets, 8, results);
+   @endcode
+ */
+dtcp_result_t DTCPMgrProcessPacketV(DTCPIP_Packet *packets, uint32_t numPackets, dtcp_result_t *results);
+
+/**
+ * @brief Creates a shared stream.
+ *
+ * A shared stream encrypts content once for every sink watching it. It is a source session that is fed with
+ * DTCPMgrProcessSharedPacket() and joined by the source sessions of the individual sinks with
+ * DTCPMgrJoinSharedStream(). The members then get packets referencing the same encrypted buffers instead of
+ * encrypting the content again. Members must use the stream's exchange key, so this suits sinks that did not
+ * request a unique key. The stream is deleted with DTCPMgrDeleteDTCPSession(), which releases its members.
+ *
+ * @param[in]  key_label     Exchange key label, as for DTCPMgrCreateSourceSession().
+ * @param[in]  PCPPacketSize Minimum size of a PCP, as for DTCPMgrCreateSourceSession().
+ * @param[in]  maxPacketSize Maximum size of a packet, as for DTCPMgrCreateSourceSession().
+ * @param[out] handle        The address of a location to hold the handle of the stream on return.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS Successfully created the shared stream.
+ * @n Otherwise, the errors of DTCPMgrCreateSourceSession().
+ */
+dtcp_result_t DTCPMgrCreateSharedStream(int key_label, int PCPPacketSize, int maxPacketSize, DTCP_SESSION_HANDLE *handle);
+
+/**
+ * @brief Adds a source session to a shared stream.
+ *
+ * From the next PCP of the stream on, the session's packets come from DTCPMgrProcessSharedPacket(), and the
+ * session cannot process packets of its own until it leaves. A session that joins in the middle of a PCP gets
+ * its first packet when the next PCP starts, beginning with that PCP's header.
+ *
+ * @param[in] stream  Handle of the shared stream.
+ * @param[in] session Handle of a source session using the stream's exchange key.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS               The session joined the stream.
+ * @retval DTCP_ERR_INVALID_PARAM     A handle is invalid, @a session is not a source session or is already a member.
+ * @retval DTCP_ERR_INVALID_KEY_LABEL @a session does not use the stream's exchange key.
+ * @retval DTCP_ERR_OUT_OF_SESSIONS   The stream has DTCPIP_MAX_SHARED_MEMBERS members.
+ */
+dtcp_result_t DTCPMgrJoinSharedStream(DTCP_SESSION_HANDLE stream, DTCP_SESSION_HANDLE session);
+
+/**
+ * @brief Removes a source session from its shared stream.
+ *
+ * Deleting a member with DTCPMgrDeleteDTCPSession() removes it as well.
+ *
+ * @param[in] session Handle of a member of a shared stream.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           The session left the stream.
+ * @retval DTCP_ERR_INVALID_PARAM @a session is invalid or not a member of a stream.
+ */
+dtcp_result_t DTCPMgrLeaveSharedStream(DTCP_SESSION_HANDLE session);
+
+/**
+ * @brief Encrypts a packet once for all members of a shared stream.
+ *
+ * @a packet is processed as by DTCPMgrProcessPacket() on a source session. Every member ready for it receives
+ * a packet of its own in @a memberPackets, with @a session set to the member, that references the same
+ * encrypted buffers. @a packet and every member packet must each be released with DTCPMgrReleasePacket();
+ * the buffers are recycled when the last of them is released.
+ *
+ * @param[in]     stream        Handle of the shared stream.
+ * @param[in,out] packet        The packet to encrypt.
+ * @param[out]    memberPackets Array receiving the member packets.
+ * @param[in]     maxMembers    Number of entries in @a memberPackets; DTCPIP_MAX_SHARED_MEMBERS always suffices.
+ * @param[out]    numMembers    Number of member packets filled in.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully processed the packet.
+ * @retval DTCP_ERR_INVALID_PARAM @a stream is not a shared stream, or it has more than @a maxMembers members.
+ */
+dtcp_result_t DTCPMgrProcessSharedPacket(DTCP_SESSION_HANDLE stream, DTCPIP_Packet *packet,
+                                         DTCPIP_Packet *memberPackets, uint32_t maxMembers, uint32_t *numMembers);
+
+/**
+ * @brief Starts building a PCP index of a session's stream.
+ *
+ * From the next packet on, the session records where each PCP of its stream starts: in the output for a
+ * source session, in the input for a sink session. Offsets count from the first byte of the session's
+ * stream, so the index of a stream recorded to a file from its start is the index of the file.
+ * Retrieve it with DTCPMgrGetPcpIndex() and keep it next to the recording; DTCPMgrSeekSinkSession()
+ * then decrypts the recording from any byte.
+ *
+ * @param[in] session Handle of a source or sink session.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           The session is indexing its stream (also if it already was).
+ * @retval DTCP_ERR_INVALID_PARAM @a session is not a valid handle.
+ * @retval DTCP_ERR_MEMORY_ALLOC  The index could not be allocated.
+ */
+dtcp_result_t DTCPMgrStartPcpIndex(DTCP_SESSION_HANDLE session);
+
+/**
+ * @brief Gets the PCP index built by a session so far.
+ *
+ * The index is a self-contained sidecar of 8 bytes plus 22 bytes per PCP, valid for as many bytes of
+ * the stream as the session has processed.
+ *
+ * @param[in]  session Handle of a session indexing its stream.
+ * @param[out] index   Buffer of @a size bytes receiving the index, or NULL to query its length.
+ * @param[in]  size    Size of @a index in bytes.
+ * @param[out] length  Length of the index in bytes.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           The index (or its length) was returned.
+ * @retval DTCP_ERR_INVALID_PARAM @a session is not a valid handle or does not index its stream, @a length
+ * is NULL, or @a size is less than @a length.
+ * @retval DTCP_ERR_MEMORY_ALLOC  PCPs were left out of the index for lack of memory.
+ */
+dtcp_result_t DTCPMgrGetPcpIndex(DTCP_SESSION_HANDLE session, uint8_t *index, uint32_t size, uint32_t *length);
+
+/**
+ * @brief Positions a sink session to decrypt a recorded stream from any byte.
+ *
+ * Looks up the PCP holding stream byte @a offset in @a index and sets up the session inside it. The caller
+ * then passes the stream from @a readOffset on to DTCPMgrProcessPacket(); @a readOffset is at most 16 bytes
+ * before the PCP payload byte at @a offset, since the ciphertext block before it is needed for decryption,
+ * and the first decrypted byte returned is the content at @a offset. The lookup takes the same time for
+ * any length of recording. Packets submitted to the worker pool are completed first.
+ *
+ * @param[in]  session     Handle of a sink session.
+ * @param[in]  index       PCP index of the stream, from DTCPMgrGetPcpIndex().
+ * @param[in]  indexLength Length of @a index in bytes.
+ * @param[in]  offset      Offset in the stream to decrypt from.
+ * @param[out] readOffset  Offset in the stream to continue reading from.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS               The session decrypts from @a offset.
+ * @retval DTCP_ERR_INVALID_PARAM     A parameter is invalid, @a index is malformed, or @a offset is outside
+ * the PCPs it lists.
+ * @retval DTCP_ERR_INVALID_KEY_LABEL The session has an exchange key from an AKE with another label.
+ */
+dtcp_result_t DTCPMgrSeekSinkSession(DTCP_SESSION_HANDLE session, const uint8_t *index, uint32_t indexLength,
+                                     uint64_t offset, uint64_t *readOffset);
+
+/**
+ * @brief Gets the output of a processed packet as an ordered list of segments.
+ *
+ * This function describes the PCP stream produced by a source packet as up to DTCPIP_MAX_PACKET_SEGMENTS
+ * iovec entries: the payload before pcpHeaderOffset, the PCP header and the rest of the payload. The list
+ * can be handed to writev() or sendmsg() as is, so the caller does not need to move the payload to insert
+ * the header. For a sink packet, or a source packet without a header, the list is the payload alone.
+ * Empty segments are left out. The segments point into the packet's buffers and stay valid until
+ * the packet is released.
+ *
+ * @param[in]  packet      Address of the location of the processed DTCP-IP packet.
+ * @param[out] segments    Array of @a maxSegments entries receiving the segments.
+ * @param[in]  maxSegments Number of entries in @a segments (DTCPIP_MAX_PACKET_SEGMENTS is always enough).
+ * @param[out] numSegments Number of segments filled in.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully described the packet.
+ * @retval DTCP_ERR_INVALID_PARAM A parameter is NULL, pcpHeaderOffset is beyond the payload,
+ * or @a segments is too small.
+ *
+ * @par Example usage
+ * @code
+      struct iovec segments[DTCPIP_MAX_PACKET_SEGMENTS];
+      uint32_t numSegments;
+      if (DTCPMgrGetPacketSegments(&packet, segments, DTCPIP_MAX_PACKET_SEGMENTS, &numSegments) == DTCP_SUCCESS)
+      {
+          writev(socketFd, segments, numSegments);
+      }
+   @endcode
+ */
+dtcp_result_t DTCPMgrGetPacketSegments(const DTCPIP_Packet *packet, struct iovec *segments, uint32_t maxSegments, uint32_t *numSegments);
+
+/**
+ * @brief Processes a DTCP-IP packet and writes the result to a file descriptor.
+ *
+ * This function processes the packet as DTCPMgrProcessPacket() does and writes the output,
+ * including a PCP header of a source, to @a fd with writev() (sendmsg() on a socket), so the
+ * caller does not copy it into a socket buffer of its own. A non-blocking @a fd is waited on, for up
+ * to 5 seconds in which it accepts no data; then the call fails with errno EAGAIN.
+ *
+ * With DTCPIP_FD_ZEROCOPY, a TCP socket is switched to SO_ZEROCOPY and written with MSG_ZEROCOPY.
+ * The output buffers are then held by DTCP Manager until the kernel reports on the socket's error
+ * queue that it has released them; completions are reaped on later calls and at session delete.
+ * Other descriptors, and kernels without MSG_ZEROCOPY, fall back to copying writes.
+ *
+ * @note DTCP Manager owns the zero-copy notifications of @a fd: the caller must not read its error queue.
+ * Switching a session to a new fd, or deleting it, first waits up to a second for the completions of
+ * the previous one. Buffers the kernel still references after that are only reused once it releases
+ * them, through a duplicate of the fd kept by DTCP Manager, so closing the fd early is safe.
+ *
+ * @param[in]     session Session handle.
+ * @param[in,out] packet  Address of the location of the DTCP-IP packet. On return dataLength holds the number
+ *                        of bytes written to @a fd. The packet holds no buffers and is not to be released.
+ * @param[in]     fd      Socket, pipe or file descriptor to write to.
+ * @param[in]     flags   0 or DTCPIP_FD_ZEROCOPY.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully processed and written the packet.
+ * @retval DTCP_ERR_INVALID_PARAM Invalid session, packet or @a fd.
+ * @retval DTCP_ERR_GENERAL       The write failed; errno holds the cause.
+ */
+dtcp_result_t DTCPMgrProcessToFd(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet, int fd, uint32_t flags);
+
+/**
+ * @brief Encrypts or decrypts a whole file.
+ *
+ * This function maps the input file with mmap() and madvise(MADV_SEQUENTIAL) and streams it through the
+ * session in chunks of up to @a chunkSize bytes, so no read() copies are made. A source session encrypts
+ * the file as one stream and pads its last PCP; a sink session decrypts a file that starts with a PCP header.
+ * The chunks are submitted as with DTCPMgrSubmitPacket(), so with worker threads configured in
+ * DTCPMgrInitializeEx() they are processed on several cores: a sink cuts the file at PCP boundaries found
+ * from the PCP headers, and a source starts a PCP per chunk when created with PCPPacketSize 0. The output is
+ * written to @a outFd in order.
+ *
+ * @note The session must have no submitted packets outstanding. A chunk larger than the session's
+ * maxPacketSize is cut to it.
+ *
+ * @param[in]  session   Handle of a source or sink session.
+ * @param[in]  inFd      Descriptor of a regular file, read from its start.
+ * @param[in]  outFd     File, pipe or socket descriptor to write to.
+ * @param[in]  chunkSize Largest number of bytes processed as one packet, 0 for the default of 1 MiB.
+ * @param[out] stats     The address of a location to hold the byte counts and elapsed time, or NULL.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           The whole file was processed and written.
+ * @retval DTCP_ERR_INVALID_PARAM Invalid session or descriptor, or @a inFd is not a regular file.
+ * @retval DTCP_ERR_GENERAL       The input could not be mapped or a write failed; errno holds the cause.
+ * @retval DTCP_ERR_MEMORY_ALLOC  Out of memory.
+ * Errors of processing a chunk are returned as by DTCPMgrProcessPacket().
+ */
+dtcp_result_t DTCPMgrProcessFile(DTCP_SESSION_HANDLE session, int inFd, int outFd, uint32_t chunkSize,
+                                 DTCPIP_FileStats *stats);
+
 /**
  * @brief Releases a processed DTCP-IP packet.
  * 
  * This function releases the DTCP-IP packet. The processed packet may contain DTCP Manager allocated/owned 
  * buffers/memory - this call frees up these resources.
  *
+ * @note Buffers are returned to the buffer pool of the session that produced them, so the packet may be
+ * released from any thread, also after its session has been deleted.
+ *
  * @param [in] packet Address of the location of the DTCP-IP packet.
  *
  * @return Error code.
@@ -354,6 +1041,8 @@ dtcp_result_t DTCPMgrReleasePacket(DTCPIP_Packet *packet);
  *
  * @return Error code.
  * @retval DTCP_SUCCESS Successfully deleted the session.
+ * @retval DTCP_ERR_INVALID_PARAM @a session is not a handle of an active session.
+ * Handles of deleted sessions stay invalid even when their resources are reused.
  */
 dtcp_result_t DTCPMgrDeleteDTCPSession(DTCP_SESSION_HANDLE session);
     
@@ -378,24 +1067,62 @@ int DTCPMgrGetNumSessions(DTCPDeviceType deviceType);
  * @brief Gets session information.
  * 
  * This function retrieves information related to an active session.
+ * The remote_ip string belongs to the session and is valid until the session is deleted.
  *
  * @param[in] handle DTCP-IP session handle.
  * @param[out] session The address of a location of the DTCP-IP session structure to fill on return.
  *
  * @return Error code.
  * @retval DTCP_SUCCESS Successfully returned the session info.
+ * @retval DTCP_ERR_INVALID_PARAM @a handle is not a handle of an active session, or @a session is NULL.
  */
 dtcp_result_t DTCPMgrGetSessionInfo(DTCP_SESSION_HANDLE handle, DTCPIP_Session *session);
+
+/**
+ * @brief Gets the statistics of a session, or of all sessions.
+ *
+ * The counters are updated without locks as packets are processed, so they can be read at any
+ * time, e.g. periodically to find stalled or slow sessions. A snapshot taken while packets are
+ * being processed need not be consistent across fields.
+ *
+ * @param[in]  handle DTCP-IP session handle, or ::DTCPIP_ALL_SESSIONS.
+ * @param[out] stats  The address of a location to hold the statistics.
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully returned the statistics.
+ * @retval DTCP_ERR_INVALID_PARAM @a handle is not a handle of an active session, or @a stats is NULL.
+ */
+dtcp_result_t DTCPMgrGetSessionStats(DTCP_SESSION_HANDLE handle, DTCPIP_SessionStats *stats);
+
+/**
+ * @brief Gets buffer pool information of a session.
+ *
+ * This function retrieves the state of the pools serving the output buffers (@a dataOutPtr)
+ * and the PCP header buffers (@a pcpHeader) of a session's packets.
+ * The data pool's buffer size is derived from the @a maxPacketSize given at session creation.
+ *
+ * @param[in]  handle     DTCP-IP session handle.
+ * @param[out] dataPool   The address of a location to fill with the data buffer pool information (may be NULL).
+ * @param[out] headerPool The address of a location to fill with the header buffer pool information (may be NULL).
+ *
+ * @return Error code.
+ * @retval DTCP_SUCCESS           Successfully returned the pool information.
+ * @retval DTCP_ERR_INVALID_PARAM @a handle is not a handle of an active session.
+ */
+dtcp_result_t DTCPMgrGetBufferPoolInfo(DTCP_SESSION_HANDLE handle, DTCPIP_BufferPoolInfo *dataPool, DTCPIP_BufferPoolInfo *headerPool);
     
 /**
  * @brief Sets log level.
  * 
- * This function sets DTCP Manager's logging verbosity level.
+ * This function sets DTCP Manager's logging verbosity level, one of ::DTCPLogLevel. The default is
+ * DTCP_LOG_INFO. Messages above the level the library was built with (configure --with-log-level)
+ * are not compiled in and cannot be enabled.
  *
  * @param [in] level Logging level.
  *
  * @return Error code.
  * @retval DTCP_SUCCESS  Logging level was set successfully.
+ * @retval DTCP_ERR_INVALID_PARAM @a level is not a ::DTCPLogLevel.
  */
 dtcp_result_t DTCPMgrSetLogLevel(int level);
 
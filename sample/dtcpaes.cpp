@@ -0,0 +1,855 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "dtcpaes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DTCP_AES_HAVE_NI 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#define DTCP_AES_HAVE_CE 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+typedef struct
+{
+	const char *name;
+	void (*encryptBlock)(const DTCPAesKey *key, const uint8_t *in, uint8_t *out);
+	void (*cbcEncrypt)(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks);
+	void (*cbcDecrypt)(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks);
+} DTCPAesEngine;
+
+/*
+ * Portable kernel.
+ *
+ * The state is kept bitsliced in eight 64-bit planes: bit (16 * lane + k) of
+ * plane i is bit i of byte k of the block in that lane, so up to four blocks
+ * are processed at once. Every step is a fixed sequence of logic operations
+ * with no secret-dependent table lookups or branches.
+ */
+#define LANES(x) ((uint64_t)(x) * 0x0001000100010001ULL)
+#define SLICE_LANES 4
+
+static inline uint64_t laneRor(uint64_t q, int n)
+{
+	return ((q >> n) & LANES(0xFFFFu >> n)) | ((q << (16 - n)) & LANES((0xFFFFu << (16 - n)) & 0xFFFFu));
+}
+
+/* Rotate the four row bits of every column (nibble) down by one, two or three rows. */
+static inline uint64_t rowRot1(uint64_t q)
+{
+	return ((q >> 1) & LANES(0x7777)) | ((q << 3) & LANES(0x8888));
+}
+
+static inline uint64_t rowRot2(uint64_t q)
+{
+	return ((q >> 2) & LANES(0x3333)) | ((q << 2) & LANES(0xCCCC));
+}
+
+static inline uint64_t rowRot3(uint64_t q)
+{
+	return ((q >> 3) & LANES(0x1111)) | ((q << 1) & LANES(0xEEEE));
+}
+
+/* Boyar-Peralta S-box circuit. */
+static void sliceSubBytes(uint64_t *q)
+{
+	uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+	uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	uint64_t y20, y21;
+	uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+	uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+	uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/* Top linear transformation. */
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9 = x0 ^ x3;
+	y8 = x0 ^ x5;
+	t0 = x1 ^ x2;
+	y1 = t0 ^ x7;
+	y4 = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2 = y1 ^ x0;
+	y5 = y1 ^ x6;
+	y3 = y5 ^ y8;
+	t1 = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6 = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7 = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	/* Non-linear section. */
+	t2 = y12 & y15;
+	t3 = y3 & y6;
+	t4 = t3 ^ t2;
+	t5 = y4 & x7;
+	t6 = t5 ^ t2;
+	t7 = y13 & y16;
+	t8 = y5 & y1;
+	t9 = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0 = t44 & y15;
+	z1 = t37 & y6;
+	z2 = t33 & x7;
+	z3 = t43 & y16;
+	z4 = t40 & y1;
+	z5 = t29 & y7;
+	z6 = t42 & y11;
+	z7 = t45 & y17;
+	z8 = t41 & y10;
+	z9 = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	/* Bottom linear transformation. */
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0 = t59 ^ t63;
+	s6 = t56 ^ ~t62;
+	s7 = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3 = t53 ^ t66;
+	s4 = t51 ^ t66;
+	s5 = t47 ^ t65;
+	s1 = t64 ^ ~s3;
+	s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+/* Inverse affine transform of the S-box, including its 0x63 constant. */
+static void sliceInvAffine(uint64_t *q)
+{
+	uint64_t v[8];
+	memcpy(v, q, sizeof(v));
+	for (int i = 0; i < 8; i++)
+	{
+		q[i] = v[(i + 2) & 7] ^ v[(i + 5) & 7] ^ v[(i + 7) & 7];
+	}
+	q[0] = ~q[0];
+	q[2] = ~q[2];
+}
+
+static void sliceInvSubBytes(uint64_t *q)
+{
+	sliceInvAffine(q);
+	sliceSubBytes(q);
+	sliceInvAffine(q);
+}
+
+static void sliceShiftRows(uint64_t *q)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		uint64_t x = q[i];
+		q[i] = (x & LANES(0x1111))
+			| (laneRor(x, 4) & LANES(0x2222))
+			| (laneRor(x, 8) & LANES(0x4444))
+			| (laneRor(x, 12) & LANES(0x8888));
+	}
+}
+
+static void sliceInvShiftRows(uint64_t *q)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		uint64_t x = q[i];
+		q[i] = (x & LANES(0x1111))
+			| (laneRor(x, 12) & LANES(0x2222))
+			| (laneRor(x, 8) & LANES(0x4444))
+			| (laneRor(x, 4) & LANES(0x8888));
+	}
+}
+
+/* Multiply every byte by x in GF(2^8). */
+static inline void sliceXtime(uint64_t *t)
+{
+	uint64_t hi = t[7];
+	t[7] = t[6];
+	t[6] = t[5];
+	t[5] = t[4];
+	t[4] = t[3] ^ hi;
+	t[3] = t[2] ^ hi;
+	t[2] = t[1];
+	t[1] = t[0] ^ hi;
+	t[0] = hi;
+}
+
+static void sliceMixColumns(uint64_t *q)
+{
+	uint64_t t[8], rest[8];
+	for (int i = 0; i < 8; i++)
+	{
+		uint64_t r1 = rowRot1(q[i]);
+		t[i] = q[i] ^ r1;
+		rest[i] = r1 ^ rowRot2(q[i]) ^ rowRot3(q[i]);
+	}
+	sliceXtime(t);
+	for (int i = 0; i < 8; i++)
+	{
+		q[i] = t[i] ^ rest[i];
+	}
+}
+
+static void sliceInvMixColumns(uint64_t *q)
+{
+	uint64_t u[8];
+	for (int i = 0; i < 8; i++)
+	{
+		u[i] = q[i] ^ rowRot2(q[i]);
+	}
+	sliceXtime(u);
+	sliceXtime(u);
+	for (int i = 0; i < 8; i++)
+	{
+		q[i] ^= u[i];
+	}
+	sliceMixColumns(q);
+}
+
+static inline void sliceAddRoundKey(uint64_t *q, const uint64_t *sk)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		q[i] ^= sk[i];
+	}
+}
+
+/* 8x8 bit matrix transpose: bit j of byte k moves to bit k of byte j. */
+static inline uint64_t transpose8(uint64_t x)
+{
+	uint64_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x ^= t ^ (t << 28);
+	return x;
+}
+
+static inline uint64_t load64(const uint8_t *p)
+{
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; i--)
+	{
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static inline void store64(uint8_t *p, uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		p[i] = (uint8_t)(v >> (8 * i));
+	}
+}
+
+static void sliceLoad(uint64_t *q, const uint8_t *in, int lanes)
+{
+	memset(q, 0, 8 * sizeof(uint64_t));
+	for (int b = 0; b < lanes; b++)
+	{
+		uint64_t lo = transpose8(load64(in + 16 * b));
+		uint64_t hi = transpose8(load64(in + 16 * b + 8));
+		for (int j = 0; j < 8; j++)
+		{
+			uint64_t bits = ((lo >> (8 * j)) & 0xFF) | (((hi >> (8 * j)) & 0xFF) << 8);
+			q[j] |= bits << (16 * b);
+		}
+	}
+}
+
+static void sliceStore(const uint64_t *q, uint8_t *out, int lanes)
+{
+	for (int b = 0; b < lanes; b++)
+	{
+		uint64_t lo = 0;
+		uint64_t hi = 0;
+		for (int j = 0; j < 8; j++)
+		{
+			lo |= ((q[j] >> (16 * b)) & 0xFF) << (8 * j);
+			hi |= ((q[j] >> (16 * b + 8)) & 0xFF) << (8 * j);
+		}
+		store64(out + 16 * b, transpose8(lo));
+		store64(out + 16 * b + 8, transpose8(hi));
+	}
+}
+
+static void sliceEncrypt(const DTCPAesKey *key, uint64_t *q)
+{
+	sliceAddRoundKey(q, key->sliceKey[0]);
+	for (int r = 1; r < DTCP_AES_ROUNDS; r++)
+	{
+		sliceSubBytes(q);
+		sliceShiftRows(q);
+		sliceMixColumns(q);
+		sliceAddRoundKey(q, key->sliceKey[r]);
+	}
+	sliceSubBytes(q);
+	sliceShiftRows(q);
+	sliceAddRoundKey(q, key->sliceKey[DTCP_AES_ROUNDS]);
+}
+
+static void sliceDecrypt(const DTCPAesKey *key, uint64_t *q)
+{
+	sliceAddRoundKey(q, key->sliceKey[DTCP_AES_ROUNDS]);
+	for (int r = DTCP_AES_ROUNDS - 1; r > 0; r--)
+	{
+		sliceInvShiftRows(q);
+		sliceInvSubBytes(q);
+		sliceAddRoundKey(q, key->sliceKey[r]);
+		sliceInvMixColumns(q);
+	}
+	sliceInvShiftRows(q);
+	sliceInvSubBytes(q);
+	sliceAddRoundKey(q, key->sliceKey[0]);
+}
+
+static void portableEncryptBlock(const DTCPAesKey *key, const uint8_t *in, uint8_t *out)
+{
+	uint64_t q[8];
+	sliceLoad(q, in, 1);
+	sliceEncrypt(key, q);
+	sliceStore(q, out, 1);
+}
+
+static void portableCbcEncrypt(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	uint8_t block[DTCP_AES_BLOCK_SIZE];
+	memcpy(block, iv, DTCP_AES_BLOCK_SIZE);
+	for (size_t n = 0; n < blocks; n++)
+	{
+		for (int i = 0; i < DTCP_AES_BLOCK_SIZE; i++)
+		{
+			block[i] ^= in[i];
+		}
+		portableEncryptBlock(key, block, block);
+		memcpy(out, block, DTCP_AES_BLOCK_SIZE);
+		in += DTCP_AES_BLOCK_SIZE;
+		out += DTCP_AES_BLOCK_SIZE;
+	}
+	memcpy(iv, block, DTCP_AES_BLOCK_SIZE);
+}
+
+static void portableCbcDecrypt(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	uint8_t cipher[SLICE_LANES * DTCP_AES_BLOCK_SIZE];
+	uint8_t chain[DTCP_AES_BLOCK_SIZE];
+	uint64_t q[8];
+
+	memcpy(chain, iv, DTCP_AES_BLOCK_SIZE);
+	while (blocks > 0)
+	{
+		int lanes = (blocks < SLICE_LANES) ? (int)blocks : SLICE_LANES;
+		size_t bytes = (size_t)lanes * DTCP_AES_BLOCK_SIZE;
+
+		/* Keep the ciphertext: in and out may overlap. */
+		memcpy(cipher, in, bytes);
+		sliceLoad(q, cipher, lanes);
+		sliceDecrypt(key, q);
+		sliceStore(q, out, lanes);
+		for (int b = 0; b < lanes; b++)
+		{
+			const uint8_t *prev = (b == 0) ? chain : &cipher[(b - 1) * DTCP_AES_BLOCK_SIZE];
+			for (int i = 0; i < DTCP_AES_BLOCK_SIZE; i++)
+			{
+				out[b * DTCP_AES_BLOCK_SIZE + i] ^= prev[i];
+			}
+		}
+		memcpy(chain, &cipher[bytes - DTCP_AES_BLOCK_SIZE], DTCP_AES_BLOCK_SIZE);
+		in += bytes;
+		out += bytes;
+		blocks -= lanes;
+	}
+	memcpy(iv, chain, DTCP_AES_BLOCK_SIZE);
+}
+
+static const DTCPAesEngine portableEngine =
+{
+	"portable",
+	portableEncryptBlock,
+	portableCbcEncrypt,
+	portableCbcDecrypt
+};
+
+#ifdef DTCP_AES_HAVE_NI
+__attribute__((target("aes,sse2")))
+static void niEncryptBlock(const DTCPAesKey *key, const uint8_t *in, uint8_t *out)
+{
+	__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), _mm_load_si128((const __m128i *)key->encKey[0]));
+	for (int r = 1; r < DTCP_AES_ROUNDS; r++)
+	{
+		s = _mm_aesenc_si128(s, _mm_load_si128((const __m128i *)key->encKey[r]));
+	}
+	s = _mm_aesenclast_si128(s, _mm_load_si128((const __m128i *)key->encKey[DTCP_AES_ROUNDS]));
+	_mm_storeu_si128((__m128i *)out, s);
+}
+
+__attribute__((target("aes,sse2")))
+static void niCbcEncrypt(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	__m128i rk[DTCP_AES_ROUNDS + 1];
+	for (int r = 0; r <= DTCP_AES_ROUNDS; r++)
+	{
+		rk[r] = _mm_load_si128((const __m128i *)key->encKey[r]);
+	}
+	__m128i s = _mm_loadu_si128((const __m128i *)iv);
+	for (size_t n = 0; n < blocks; n++)
+	{
+		s = _mm_xor_si128(s, _mm_loadu_si128((const __m128i *)in));
+		s = _mm_xor_si128(s, rk[0]);
+		for (int r = 1; r < DTCP_AES_ROUNDS; r++)
+		{
+			s = _mm_aesenc_si128(s, rk[r]);
+		}
+		s = _mm_aesenclast_si128(s, rk[DTCP_AES_ROUNDS]);
+		_mm_storeu_si128((__m128i *)out, s);
+		in += DTCP_AES_BLOCK_SIZE;
+		out += DTCP_AES_BLOCK_SIZE;
+	}
+	_mm_storeu_si128((__m128i *)iv, s);
+}
+
+__attribute__((target("aes,sse2")))
+static void niCbcDecrypt(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	__m128i dk[DTCP_AES_ROUNDS + 1];
+	for (int r = 0; r <= DTCP_AES_ROUNDS; r++)
+	{
+		dk[r] = _mm_load_si128((const __m128i *)key->decKey[r]);
+	}
+	__m128i prev = _mm_loadu_si128((const __m128i *)iv);
+
+	/* CBC decryption has no dependency between blocks; keep four in flight. */
+	while (blocks >= 4)
+	{
+		__m128i c0 = _mm_loadu_si128((const __m128i *)(in + 0));
+		__m128i c1 = _mm_loadu_si128((const __m128i *)(in + 16));
+		__m128i c2 = _mm_loadu_si128((const __m128i *)(in + 32));
+		__m128i c3 = _mm_loadu_si128((const __m128i *)(in + 48));
+		__m128i b0 = _mm_xor_si128(c0, dk[0]);
+		__m128i b1 = _mm_xor_si128(c1, dk[0]);
+		__m128i b2 = _mm_xor_si128(c2, dk[0]);
+		__m128i b3 = _mm_xor_si128(c3, dk[0]);
+		for (int r = 1; r < DTCP_AES_ROUNDS; r++)
+		{
+			b0 = _mm_aesdec_si128(b0, dk[r]);
+			b1 = _mm_aesdec_si128(b1, dk[r]);
+			b2 = _mm_aesdec_si128(b2, dk[r]);
+			b3 = _mm_aesdec_si128(b3, dk[r]);
+		}
+		b0 = _mm_xor_si128(_mm_aesdeclast_si128(b0, dk[DTCP_AES_ROUNDS]), prev);
+		b1 = _mm_xor_si128(_mm_aesdeclast_si128(b1, dk[DTCP_AES_ROUNDS]), c0);
+		b2 = _mm_xor_si128(_mm_aesdeclast_si128(b2, dk[DTCP_AES_ROUNDS]), c1);
+		b3 = _mm_xor_si128(_mm_aesdeclast_si128(b3, dk[DTCP_AES_ROUNDS]), c2);
+		_mm_storeu_si128((__m128i *)(out + 0), b0);
+		_mm_storeu_si128((__m128i *)(out + 16), b1);
+		_mm_storeu_si128((__m128i *)(out + 32), b2);
+		_mm_storeu_si128((__m128i *)(out + 48), b3);
+		prev = c3;
+		in += 4 * DTCP_AES_BLOCK_SIZE;
+		out += 4 * DTCP_AES_BLOCK_SIZE;
+		blocks -= 4;
+	}
+	while (blocks > 0)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i *)in);
+		__m128i b = _mm_xor_si128(c, dk[0]);
+		for (int r = 1; r < DTCP_AES_ROUNDS; r++)
+		{
+			b = _mm_aesdec_si128(b, dk[r]);
+		}
+		b = _mm_xor_si128(_mm_aesdeclast_si128(b, dk[DTCP_AES_ROUNDS]), prev);
+		_mm_storeu_si128((__m128i *)out, b);
+		prev = c;
+		in += DTCP_AES_BLOCK_SIZE;
+		out += DTCP_AES_BLOCK_SIZE;
+		blocks--;
+	}
+	_mm_storeu_si128((__m128i *)iv, prev);
+}
+
+static bool niSupported(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+	{
+		return false;
+	}
+	return (ecx & bit_AES) && (edx & bit_SSE2);
+}
+
+static const DTCPAesEngine niEngine =
+{
+	"aesni",
+	niEncryptBlock,
+	niCbcEncrypt,
+	niCbcDecrypt
+};
+#endif
+
+#ifdef DTCP_AES_HAVE_CE
+static void ceEncryptBlock(const DTCPAesKey *key, const uint8_t *in, uint8_t *out)
+{
+	uint8x16_t s = vld1q_u8(in);
+	for (int r = 0; r < DTCP_AES_ROUNDS - 1; r++)
+	{
+		s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(key->encKey[r])));
+	}
+	s = vaeseq_u8(s, vld1q_u8(key->encKey[DTCP_AES_ROUNDS - 1]));
+	vst1q_u8(out, veorq_u8(s, vld1q_u8(key->encKey[DTCP_AES_ROUNDS])));
+}
+
+static void ceCbcEncrypt(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	uint8x16_t rk[DTCP_AES_ROUNDS + 1];
+	for (int r = 0; r <= DTCP_AES_ROUNDS; r++)
+	{
+		rk[r] = vld1q_u8(key->encKey[r]);
+	}
+	uint8x16_t s = vld1q_u8(iv);
+	for (size_t n = 0; n < blocks; n++)
+	{
+		s = veorq_u8(s, vld1q_u8(in));
+		for (int r = 0; r < DTCP_AES_ROUNDS - 1; r++)
+		{
+			s = vaesmcq_u8(vaeseq_u8(s, rk[r]));
+		}
+		s = veorq_u8(vaeseq_u8(s, rk[DTCP_AES_ROUNDS - 1]), rk[DTCP_AES_ROUNDS]);
+		vst1q_u8(out, s);
+		in += DTCP_AES_BLOCK_SIZE;
+		out += DTCP_AES_BLOCK_SIZE;
+	}
+	vst1q_u8(iv, s);
+}
+
+static void ceCbcDecrypt(const DTCPAesKey *key, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	uint8x16_t dk[DTCP_AES_ROUNDS + 1];
+	for (int r = 0; r <= DTCP_AES_ROUNDS; r++)
+	{
+		dk[r] = vld1q_u8(key->decKey[r]);
+	}
+	uint8x16_t prev = vld1q_u8(iv);
+	while (blocks >= 4)
+	{
+		uint8x16_t c0 = vld1q_u8(in + 0);
+		uint8x16_t c1 = vld1q_u8(in + 16);
+		uint8x16_t c2 = vld1q_u8(in + 32);
+		uint8x16_t c3 = vld1q_u8(in + 48);
+		uint8x16_t b0 = c0, b1 = c1, b2 = c2, b3 = c3;
+		for (int r = 0; r < DTCP_AES_ROUNDS - 1; r++)
+		{
+			b0 = vaesimcq_u8(vaesdq_u8(b0, dk[r]));
+			b1 = vaesimcq_u8(vaesdq_u8(b1, dk[r]));
+			b2 = vaesimcq_u8(vaesdq_u8(b2, dk[r]));
+			b3 = vaesimcq_u8(vaesdq_u8(b3, dk[r]));
+		}
+		b0 = veorq_u8(veorq_u8(vaesdq_u8(b0, dk[DTCP_AES_ROUNDS - 1]), dk[DTCP_AES_ROUNDS]), prev);
+		b1 = veorq_u8(veorq_u8(vaesdq_u8(b1, dk[DTCP_AES_ROUNDS - 1]), dk[DTCP_AES_ROUNDS]), c0);
+		b2 = veorq_u8(veorq_u8(vaesdq_u8(b2, dk[DTCP_AES_ROUNDS - 1]), dk[DTCP_AES_ROUNDS]), c1);
+		b3 = veorq_u8(veorq_u8(vaesdq_u8(b3, dk[DTCP_AES_ROUNDS - 1]), dk[DTCP_AES_ROUNDS]), c2);
+		vst1q_u8(out + 0, b0);
+		vst1q_u8(out + 16, b1);
+		vst1q_u8(out + 32, b2);
+		vst1q_u8(out + 48, b3);
+		prev = c3;
+		in += 4 * DTCP_AES_BLOCK_SIZE;
+		out += 4 * DTCP_AES_BLOCK_SIZE;
+		blocks -= 4;
+	}
+	while (blocks > 0)
+	{
+		uint8x16_t c = vld1q_u8(in);
+		uint8x16_t b = c;
+		for (int r = 0; r < DTCP_AES_ROUNDS - 1; r++)
+		{
+			b = vaesimcq_u8(vaesdq_u8(b, dk[r]));
+		}
+		b = veorq_u8(veorq_u8(vaesdq_u8(b, dk[DTCP_AES_ROUNDS - 1]), dk[DTCP_AES_ROUNDS]), prev);
+		vst1q_u8(out, b);
+		prev = c;
+		in += DTCP_AES_BLOCK_SIZE;
+		out += DTCP_AES_BLOCK_SIZE;
+		blocks--;
+	}
+	vst1q_u8(iv, prev);
+}
+
+static bool ceSupported(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+}
+
+static const DTCPAesEngine ceEngine =
+{
+	"armv8-ce",
+	ceEncryptBlock,
+	ceCbcEncrypt,
+	ceCbcDecrypt
+};
+#endif
+
+static const DTCPAesEngine *selectEngine(void)
+{
+	const char *forced = getenv("DTCPMGR_AES_ENGINE");
+	if (forced != NULL && strcmp(forced, "portable") == 0)
+	{
+		return &portableEngine;
+	}
+#ifdef DTCP_AES_HAVE_NI
+	if (niSupported())
+	{
+		return &niEngine;
+	}
+#endif
+#ifdef DTCP_AES_HAVE_CE
+	if (ceSupported())
+	{
+		return &ceEngine;
+	}
+#endif
+	return &portableEngine;
+}
+
+static const DTCPAesEngine *engine(void)
+{
+	static const DTCPAesEngine *selected = selectEngine();
+	return selected;
+}
+
+/* Constant-time S-box on the four bytes of a key schedule word. */
+static void subWord(uint8_t *w)
+{
+	uint64_t q[8];
+	memset(q, 0, sizeof(q));
+	for (int k = 0; k < 4; k++)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			q[i] |= (uint64_t)((w[k] >> i) & 1) << k;
+		}
+	}
+	sliceSubBytes(q);
+	for (int k = 0; k < 4; k++)
+	{
+		uint8_t b = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			b |= (uint8_t)(((q[i] >> k) & 1) << i);
+		}
+		w[k] = b;
+	}
+}
+
+static inline uint8_t gfMul(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		r ^= a & (uint8_t)-(b & 1);
+		a = (uint8_t)((a << 1) ^ (0x1B & (uint8_t)-(a >> 7)));
+		b >>= 1;
+	}
+	return r;
+}
+
+static void invMixColumn(const uint8_t *in, uint8_t *out)
+{
+	for (int c = 0; c < 4; c++)
+	{
+		const uint8_t *a = in + 4 * c;
+		for (int r = 0; r < 4; r++)
+		{
+			out[4 * c + r] = gfMul(a[r], 14) ^ gfMul(a[(r + 1) & 3], 11) ^ gfMul(a[(r + 2) & 3], 13) ^ gfMul(a[(r + 3) & 3], 9);
+		}
+	}
+}
+
+void DTCPAesSetKey(DTCPAesKey *key, const uint8_t rawKey[DTCP_AES_BLOCK_SIZE])
+{
+	static const uint8_t rcon[DTCP_AES_ROUNDS] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+	uint8_t *w = &key->encKey[0][0];
+
+	memcpy(w, rawKey, DTCP_AES_BLOCK_SIZE);
+	for (int i = 4; i < 4 * (DTCP_AES_ROUNDS + 1); i++)
+	{
+		uint8_t t[4];
+		memcpy(t, &w[4 * (i - 1)], 4);
+		if ((i & 3) == 0)
+		{
+			uint8_t t0 = t[0];
+			t[0] = t[1];
+			t[1] = t[2];
+			t[2] = t[3];
+			t[3] = t0;
+			subWord(t);
+			t[0] ^= rcon[i / 4 - 1];
+		}
+		for (int k = 0; k < 4; k++)
+		{
+			w[4 * i + k] = w[4 * (i - 4) + k] ^ t[k];
+		}
+	}
+
+	memcpy(key->decKey[0], key->encKey[DTCP_AES_ROUNDS], DTCP_AES_BLOCK_SIZE);
+	for (int r = 1; r < DTCP_AES_ROUNDS; r++)
+	{
+		invMixColumn(key->encKey[DTCP_AES_ROUNDS - r], key->decKey[r]);
+	}
+	memcpy(key->decKey[DTCP_AES_ROUNDS], key->encKey[0], DTCP_AES_BLOCK_SIZE);
+
+	for (int r = 0; r <= DTCP_AES_ROUNDS; r++)
+	{
+		sliceLoad(key->sliceKey[r], key->encKey[r], 1);
+		for (int i = 0; i < 8; i++)
+		{
+			key->sliceKey[r][i] = LANES(key->sliceKey[r][i] & 0xFFFF);
+		}
+	}
+}
+
+void DTCPAesEncryptBlock(const DTCPAesKey *key, const uint8_t in[DTCP_AES_BLOCK_SIZE], uint8_t out[DTCP_AES_BLOCK_SIZE])
+{
+	engine()->encryptBlock(key, in, out);
+}
+
+void DTCPAesCbcEncrypt(const DTCPAesKey *key, uint8_t iv[DTCP_AES_BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	if (blocks > 0)
+	{
+		engine()->cbcEncrypt(key, iv, in, out, blocks);
+	}
+}
+
+void DTCPAesCbcDecrypt(const DTCPAesKey *key, uint8_t iv[DTCP_AES_BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	if (blocks > 0)
+	{
+		engine()->cbcDecrypt(key, iv, in, out, blocks);
+	}
+}
+
+const char *DTCPAesEngineName(void)
+{
+	return engine()->name;
+}
@@ -0,0 +1,83 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpaes.h
+ * AES-128 engine used by the reference DTCP Manager.
+ *
+ * The engine is selected once at runtime: AES-NI on x86, the ARMv8 crypto
+ * extensions on AArch64, or a constant-time bitsliced portable kernel.
+ * Setting the environment variable DTCPMGR_AES_ENGINE to "portable" forces
+ * the portable kernel, which is useful to cross-check the accelerated paths.
+ */
+
+#ifndef __DTCPAES_H_
+#define __DTCPAES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DTCP_AES_BLOCK_SIZE 16
+#define DTCP_AES_ROUNDS     10
+
+/**
+ * @brief Expanded AES-128 key.
+ *
+ * Holds the round keys in every layout needed by the available kernels,
+ * so a key can be shared by all of them without re-expansion.
+ */
+typedef struct DTCPAesKey_s
+{
+	uint8_t  encKey[DTCP_AES_ROUNDS + 1][DTCP_AES_BLOCK_SIZE] __attribute__((aligned(16))); /**< Encryption round keys.            */
+	uint8_t  decKey[DTCP_AES_ROUNDS + 1][DTCP_AES_BLOCK_SIZE] __attribute__((aligned(16))); /**< Equivalent inverse cipher keys.   */
+	uint64_t sliceKey[DTCP_AES_ROUNDS + 1][8];                                              /**< Bitsliced keys (portable kernel). */
+} DTCPAesKey;
+
+/**
+ * @brief Expands a 128-bit key into @a key.
+ */
+void DTCPAesSetKey(DTCPAesKey *key, const uint8_t rawKey[DTCP_AES_BLOCK_SIZE]);
+
+/**
+ * @brief Encrypts a single block (ECB).
+ */
+void DTCPAesEncryptBlock(const DTCPAesKey *key, const uint8_t in[DTCP_AES_BLOCK_SIZE], uint8_t out[DTCP_AES_BLOCK_SIZE]);
+
+/**
+ * @brief CBC-encrypts @a blocks blocks from @a in to @a out.
+ *
+ * @a iv holds the chaining value on entry and is updated with the last ciphertext block.
+ * @a in and @a out may be the same buffer.
+ */
+void DTCPAesCbcEncrypt(const DTCPAesKey *key, uint8_t iv[DTCP_AES_BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t blocks);
+
+/**
+ * @brief CBC-decrypts @a blocks blocks from @a in to @a out.
+ *
+ * @a iv holds the chaining value on entry and is updated with the last ciphertext block.
+ * @a out may be the same buffer as @a in, or start before @a in in the same buffer.
+ */
+void DTCPAesCbcDecrypt(const DTCPAesKey *key, uint8_t iv[DTCP_AES_BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t blocks);
+
+/**
+ * @brief Returns the name of the kernel selected at runtime ("aesni", "armv8-ce" or "portable").
+ */
+const char *DTCPAesEngineName(void);
+
+#endif //__DTCPAES_H_
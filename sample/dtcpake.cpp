@@ -0,0 +1,998 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <arpa/inet.h>
+#include <atomic>
+#include <errno.h>
+#include <ifaddrs.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <new>
+#include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include "dtcpake.h"
+#include "dtcplog.h"
+#include "dtcpsrm.h"
+#include "dtcpstats.h"
+
+#define AKE_TYPE_CONTROL          0x01
+#define AKE_CHALLENGE             0x01
+#define AKE_SOURCE_CHALLENGE      0x02
+#define AKE_RESPONSE              0x03
+#define AKE_EXCHANGE_KEY          0x04
+#define AKE_REJECTED              0x7F
+#define AKE_FLAG_UNIQUE_KEY       0x01
+#define AKE_REJECT_GENERAL        0x00
+#define AKE_REJECT_REVOKED        0x01    /* The peer's device ID is on the SRM. */
+#define AKE_HEADER_SIZE           4
+#define AKE_CHALLENGE_SIZE        (1 + DTCP_AES_BLOCK_SIZE + DTCP_SRM_DEVICE_ID_SIZE)
+#define AKE_SOURCE_CHALLENGE_SIZE (2 * DTCP_AES_BLOCK_SIZE + DTCP_SRM_DEVICE_ID_SIZE)
+#define AKE_MAX_BODY              AKE_SOURCE_CHALLENGE_SIZE
+#define AKE_MAX_MESSAGE           (AKE_HEADER_SIZE + AKE_MAX_BODY)
+#define AKE_KEY_MESSAGE_SIZE      (1 + 4 + DTCP_EXCHANGE_KEY_SIZE)
+#define AKE_MAX_EVENTS            64
+#define AKE_NUM_LABELS            256
+#define AKE_MAC_SOURCE            0x01    /* Purposes of a MAC; see dtcpake.h. */
+#define AKE_MAC_SINK              0x02
+#define AKE_MAC_KEY               0x03
+
+enum akeKind
+{
+	akeWakeup,
+	akeListener,
+	akeConnection
+};
+
+enum akeState
+{
+	akeIdle,
+	akeWaitChallenge,
+	akeWaitResponse,
+	akeClosing        /* Sends what is queued, then closes. */
+};
+
+typedef struct
+{
+	akeKind kind;
+	int     fd;
+} akeEndpoint;
+
+/* What both ends of a handshake know once SOURCE_CHALLENGE is sent, and every MAC covers. */
+typedef struct
+{
+	uint64_t sinkId;
+	uint64_t sourceId;
+	uint8_t  sinkNonce[DTCP_AES_BLOCK_SIZE];
+	uint8_t  sourceNonce[DTCP_AES_BLOCK_SIZE];
+} akeTranscript;
+
+typedef struct
+{
+	akeEndpoint endpoint;     /* First, so the epoll tag of any endpoint reads its kind. */
+	akeState    state;
+	bool        wantWrite;    /* EPOLLOUT is armed. */
+	bool        uniqueKey;
+	uint64_t    deadline;
+	uint8_t     in[AKE_MAX_MESSAGE];
+	uint32_t    inLength;
+	uint8_t     out[AKE_MAX_MESSAGE];
+	uint32_t    outLength;
+	uint32_t    outSent;
+	akeTranscript transcript;
+} akeHandshake;
+
+typedef struct
+{
+	bool              running;
+	std::atomic<bool> stop;
+	std::thread       thread;
+	int               epollFd;
+	akeEndpoint       wakeup;
+	akeEndpoint       listeners[DTCP_AKE_MAX_LISTENERS];
+	uint32_t          numListeners;
+	akeHandshake      handshakes[DTCP_AKE_MAX_CONNECTIONS];   /* Owned by the AKE thread. */
+	DTCPAesKey        auth;
+	std::mutex        keyLock;
+	bool              keysValid;
+	bool              keyIssued[AKE_NUM_LABELS];
+	uint64_t          keyExpiry[AKE_NUM_LABELS];   /* DTCPStatsNow() a unique key expires at; 0 for the shared key. */
+	uint8_t           keys[AKE_NUM_LABELS][DTCP_EXCHANGE_KEY_SIZE];
+	uint8_t           sharedLabel;
+	uint8_t           nextLabel;
+} akeSource;
+
+/* Never freed, like the worker pool: the application need not stop the source before exit. */
+static std::atomic<akeSource *> source(NULL);
+static std::mutex controlLock;
+
+static void putBe16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+static uint16_t getBe16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void putBe32(uint8_t *p, uint32_t v)
+{
+	putBe16(p, (uint16_t)(v >> 16));
+	putBe16(p + 2, (uint16_t)v);
+}
+
+static uint32_t getBe32(const uint8_t *p)
+{
+	return ((uint32_t)getBe16(p) << 16) | getBe16(p + 2);
+}
+
+static void putDeviceId(uint8_t *p, uint64_t id)
+{
+	for (int i = DTCP_SRM_DEVICE_ID_SIZE - 1; i >= 0; i--)
+	{
+		p[i] = (uint8_t)id;
+		id >>= 8;
+	}
+}
+
+static uint64_t getDeviceId(const uint8_t *p)
+{
+	uint64_t id = 0;
+	for (int i = 0; i < DTCP_SRM_DEVICE_ID_SIZE; i++)
+	{
+		id = (id << 8) | p[i];
+	}
+	return id;
+}
+
+/* The licensed library takes it from the device certificate; the reference makes one up per process. */
+uint64_t DTCPAkeDeviceId(void)
+{
+	static std::atomic<uint64_t> deviceId(0);
+	static std::mutex idLock;
+	uint64_t id = deviceId.load(std::memory_order_acquire);
+	if (id == 0)
+	{
+		std::lock_guard<std::mutex> lock(idLock);
+		uint8_t bytes[DTCP_SRM_DEVICE_ID_SIZE];
+		id = deviceId.load();
+		if (id == 0 && DTCPPcpRandom(bytes, sizeof(bytes)))
+		{
+			id = getDeviceId(bytes);
+			deviceId.store(id, std::memory_order_release);
+		}
+	}
+	return id;
+}
+
+static uint32_t buildMessage(uint8_t *out, uint8_t subfunction, const uint8_t *body, uint16_t length)
+{
+	out[0] = AKE_TYPE_CONTROL;
+	out[1] = subfunction;
+	putBe16(&out[2], length);
+	if (length > 0)
+	{
+		memcpy(&out[AKE_HEADER_SIZE], body, length);
+	}
+	return AKE_HEADER_SIZE + length;
+}
+
+static void loadAuthKey(DTCPAesKey *auth)
+{
+	uint8_t authKey[DTCP_AES_BLOCK_SIZE];
+	DTCPPcpGetAuthKey(authKey);
+	DTCPAesSetKey(auth, authKey);
+	memset(authKey, 0, sizeof(authKey));
+}
+
+static bool sameBlock(const uint8_t *a, const uint8_t *b)
+{
+	uint8_t diff = 0;
+	for (int i = 0; i < DTCP_AES_BLOCK_SIZE; i++)
+	{
+		diff |= a[i] ^ b[i];
+	}
+	return diff == 0;
+}
+
+/* MAC(purpose): CBC-MAC of the purpose and both device IDs, then both nonces; always three blocks. */
+static void akeMac(const DTCPAesKey *auth, uint8_t purpose, const akeTranscript *transcript, uint8_t *mac)
+{
+	uint8_t block[DTCP_AES_BLOCK_SIZE];
+	memset(block, 0, sizeof(block));
+	block[0] = purpose;
+	putDeviceId(&block[1], transcript->sinkId);
+	putDeviceId(&block[1 + DTCP_SRM_DEVICE_ID_SIZE], transcript->sourceId);
+	DTCPAesEncryptBlock(auth, block, block);
+	for (int i = 0; i < DTCP_AES_BLOCK_SIZE; i++)
+	{
+		block[i] ^= transcript->sinkNonce[i];
+	}
+	DTCPAesEncryptBlock(auth, block, block);
+	for (int i = 0; i < DTCP_AES_BLOCK_SIZE; i++)
+	{
+		block[i] ^= transcript->sourceNonce[i];
+	}
+	DTCPAesEncryptBlock(auth, block, mac);
+}
+
+/* Wraps or unwraps an exchange key with MAC(key). */
+static void wrapKey(const DTCPAesKey *auth, const akeTranscript *transcript, const uint8_t *in, uint8_t *out)
+{
+	uint8_t pad[DTCP_AES_BLOCK_SIZE];
+	akeMac(auth, AKE_MAC_KEY, transcript, pad);
+	for (int i = 0; i < DTCP_EXCHANGE_KEY_SIZE; i++)
+	{
+		out[i] = in[i] ^ pad[i];
+	}
+	memset(pad, 0, sizeof(pad));
+}
+
+/* Source side. */
+
+/* Called with keyLock held. */
+static bool keyValid(const akeSource *src, uint8_t label, uint64_t now)
+{
+	return src->keyIssued[label] && (src->keyExpiry[label] == 0 || now < src->keyExpiry[label]);
+}
+
+static bool issueKey(akeSource *src, bool uniqueKey, uint8_t *label, uint8_t *key)
+{
+	std::lock_guard<std::mutex> lock(src->keyLock);
+	if (!uniqueKey)
+	{
+		*label = src->sharedLabel;
+		memcpy(key, src->keys[*label], DTCP_EXCHANGE_KEY_SIZE);
+		return true;
+	}
+	/* A unique key is valid for DTCP_AKE_KEY_VALIDITY_SEC, after which its label is free again. */
+	uint64_t now = DTCPStatsNow();
+	for (int i = 0; i < AKE_NUM_LABELS; i++)
+	{
+		uint8_t next = src->nextLabel++;
+		if (!keyValid(src, next, now))
+		{
+			if (!DTCPPcpRandom(src->keys[next], DTCP_EXCHANGE_KEY_SIZE))
+			{
+				src->keyIssued[next] = false;
+				return false;
+			}
+			src->keyIssued[next] = true;
+			src->keyExpiry[next] = now + DTCP_AKE_KEY_VALIDITY_SEC * 1000000000ULL;
+			*label = next;
+			memcpy(key, src->keys[next], DTCP_EXCHANGE_KEY_SIZE);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void closeHandshake(akeHandshake *handshake)
+{
+	/* Closing the fd also removes it from the epoll set. */
+	close(handshake->endpoint.fd);
+	handshake->endpoint.fd = -1;
+	handshake->state = akeIdle;
+}
+
+static void queueMessage(akeHandshake *handshake, uint8_t subfunction, const uint8_t *body, uint16_t length)
+{
+	handshake->outLength = buildMessage(handshake->out, subfunction, body, length);
+	handshake->outSent = 0;
+}
+
+static void reject(akeHandshake *handshake, uint8_t reason)
+{
+	DTCP_LOG_DEBUG("AKE: rejecting handshake in state %d, reason %u\n", handshake->state, reason);
+	queueMessage(handshake, AKE_REJECTED, &reason, 1);
+	handshake->state = akeClosing;
+}
+
+static void handleMessage(akeSource *src, akeHandshake *handshake, uint8_t subfunction, const uint8_t *body,
+                          uint32_t length)
+{
+	if (handshake->state == akeWaitChallenge && subfunction == AKE_CHALLENGE && length == AKE_CHALLENGE_SIZE)
+	{
+		uint8_t reply[AKE_SOURCE_CHALLENGE_SIZE];
+		uint64_t sinkId = getDeviceId(&body[1 + DTCP_AES_BLOCK_SIZE]);
+		if (DTCPSrmRevoked(sinkId))
+		{
+			DTCP_LOG_WARN("AKE: sink device 0x%010llx is revoked\n", (unsigned long long)sinkId);
+			reject(handshake, AKE_REJECT_REVOKED);
+			return;
+		}
+		akeTranscript *transcript = &handshake->transcript;
+		handshake->uniqueKey = (body[0] & AKE_FLAG_UNIQUE_KEY) != 0;
+		transcript->sinkId = sinkId;
+		transcript->sourceId = DTCPAkeDeviceId();
+		memcpy(transcript->sinkNonce, &body[1], DTCP_AES_BLOCK_SIZE);
+		if (transcript->sourceId == 0 || !DTCPPcpRandom(transcript->sourceNonce, DTCP_AES_BLOCK_SIZE))
+		{
+			reject(handshake, AKE_REJECT_GENERAL);
+			return;
+		}
+		memcpy(reply, transcript->sourceNonce, DTCP_AES_BLOCK_SIZE);
+		akeMac(&src->auth, AKE_MAC_SOURCE, transcript, &reply[DTCP_AES_BLOCK_SIZE]);
+		putDeviceId(&reply[2 * DTCP_AES_BLOCK_SIZE], transcript->sourceId);
+		queueMessage(handshake, AKE_SOURCE_CHALLENGE, reply, sizeof(reply));
+		handshake->state = akeWaitResponse;
+		return;
+	}
+	if (handshake->state == akeWaitResponse && subfunction == AKE_RESPONSE && length == DTCP_AES_BLOCK_SIZE)
+	{
+		uint8_t expected[DTCP_AES_BLOCK_SIZE];
+		uint8_t reply[AKE_KEY_MESSAGE_SIZE];
+		uint8_t key[DTCP_EXCHANGE_KEY_SIZE];
+		akeMac(&src->auth, AKE_MAC_SINK, &handshake->transcript, expected);
+		if (sameBlock(expected, body) && issueKey(src, handshake->uniqueKey, &reply[0], key))
+		{
+			putBe32(&reply[1], DTCP_AKE_KEY_VALIDITY_SEC);
+			wrapKey(&src->auth, &handshake->transcript, key, &reply[5]);
+			memset(key, 0, sizeof(key));
+			queueMessage(handshake, AKE_EXCHANGE_KEY, reply, sizeof(reply));
+			handshake->state = akeClosing;
+			DTCP_LOG_TRACE("AKE: issued exchange key label %u\n", reply[0]);
+			return;
+		}
+	}
+	reject(handshake, AKE_REJECT_GENERAL);
+}
+
+/* Reads what has arrived; returns false if the connection is to be closed. */
+static bool receive(akeSource *src, akeHandshake *handshake)
+{
+	ssize_t n = recv(handshake->endpoint.fd, handshake->in + handshake->inLength,
+	                 sizeof(handshake->in) - handshake->inLength, 0);
+	if (n < 0)
+	{
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	}
+	if (n == 0)
+	{
+		/* The sink gave up. */
+		return false;
+	}
+	handshake->inLength += (uint32_t)n;
+	if (handshake->inLength < AKE_HEADER_SIZE)
+	{
+		return true;
+	}
+	uint32_t length = getBe16(&handshake->in[2]);
+	if (handshake->in[0] != AKE_TYPE_CONTROL || length > AKE_MAX_BODY)
+	{
+		reject(handshake, AKE_REJECT_GENERAL);
+		return true;
+	}
+	if (handshake->inLength < AKE_HEADER_SIZE + length)
+	{
+		return true;
+	}
+	if (handshake->inLength > AKE_HEADER_SIZE + length)
+	{
+		/* A sink waits for every reply before it sends again. */
+		reject(handshake, AKE_REJECT_GENERAL);
+		return true;
+	}
+	handshake->inLength = 0;
+	handleMessage(src, handshake, handshake->in[1], &handshake->in[AKE_HEADER_SIZE], length);
+	return true;
+}
+
+/* Sends the queued message; returns false on a write error. */
+static bool sendQueued(akeSource *src, akeHandshake *handshake)
+{
+	while (handshake->outSent < handshake->outLength)
+	{
+		ssize_t n = send(handshake->endpoint.fd, handshake->out + handshake->outSent,
+		                 handshake->outLength - handshake->outSent, MSG_NOSIGNAL);
+		if (n >= 0)
+		{
+			handshake->outSent += (uint32_t)n;
+			continue;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			return false;
+		}
+		break;
+	}
+
+	bool wantWrite = handshake->outSent < handshake->outLength;
+	if (wantWrite != handshake->wantWrite)
+	{
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		/* A closing handshake reads no more, so unread input must not keep waking the loop. */
+		event.events = wantWrite ? (handshake->state == akeClosing ? EPOLLOUT : EPOLLIN | EPOLLOUT) : EPOLLIN;
+		event.data.ptr = handshake;
+		if (epoll_ctl(src->epollFd, EPOLL_CTL_MOD, handshake->endpoint.fd, &event) != 0)
+		{
+			return false;
+		}
+		handshake->wantWrite = wantWrite;
+	}
+	return true;
+}
+
+static void handshakeEvent(akeSource *src, akeHandshake *handshake, uint32_t events)
+{
+	if ((events & EPOLLERR) != 0)
+	{
+		closeHandshake(handshake);
+		return;
+	}
+	if (handshake->state != akeClosing && (events & (EPOLLIN | EPOLLHUP)) != 0 && !receive(src, handshake))
+	{
+		closeHandshake(handshake);
+		return;
+	}
+	if (!sendQueued(src, handshake) ||
+	    (handshake->state == akeClosing && handshake->outSent == handshake->outLength))
+	{
+		closeHandshake(handshake);
+	}
+}
+
+static akeHandshake *freeHandshake(akeSource *src)
+{
+	for (uint32_t i = 0; i < DTCP_AKE_MAX_CONNECTIONS; i++)
+	{
+		if (src->handshakes[i].state == akeIdle)
+		{
+			return &src->handshakes[i];
+		}
+	}
+	return NULL;
+}
+
+static void acceptConnections(akeSource *src, int listenFd)
+{
+	for (;;)
+	{
+		int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				DTCP_LOG_WARN("AKE: accept failed: %s\n", strerror(errno));
+			}
+			return;
+		}
+		akeHandshake *handshake = freeHandshake(src);
+		if (handshake == NULL)
+		{
+			DTCP_LOG_WARN("AKE: %d handshakes in progress, dropping a connection\n", DTCP_AKE_MAX_CONNECTIONS);
+			close(fd);
+			continue;
+		}
+		/* Every message is a single small write waiting for a reply. */
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		memset(handshake, 0, sizeof(*handshake));
+		handshake->endpoint.kind = akeConnection;
+		handshake->endpoint.fd = fd;
+		handshake->deadline = DTCPStatsNow() + (uint64_t)DTCP_AKE_TIMEOUT_MS * 1000000;
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = handshake;
+		if (epoll_ctl(src->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			close(fd);
+			continue;
+		}
+		handshake->state = akeWaitChallenge;
+	}
+}
+
+/* Closes handshakes past their deadline and returns the epoll timeout until the next one. */
+static int expireHandshakes(akeSource *src)
+{
+	uint64_t now = DTCPStatsNow();
+	uint64_t next = 0;
+	for (uint32_t i = 0; i < DTCP_AKE_MAX_CONNECTIONS; i++)
+	{
+		akeHandshake *handshake = &src->handshakes[i];
+		if (handshake->state == akeIdle)
+		{
+			continue;
+		}
+		if (handshake->deadline <= now)
+		{
+			DTCP_LOG_DEBUG("AKE: handshake timed out in state %d\n", handshake->state);
+			closeHandshake(handshake);
+		}
+		else if (next == 0 || handshake->deadline < next)
+		{
+			next = handshake->deadline;
+		}
+	}
+	return (next == 0) ? -1 : (int)((next - now + 999999) / 1000000);
+}
+
+static void sourceLoop(akeSource *src)
+{
+	struct epoll_event events[AKE_MAX_EVENTS];
+	int timeoutMs = -1;
+
+	while (!src->stop.load())
+	{
+		int count = epoll_wait(src->epollFd, events, AKE_MAX_EVENTS, timeoutMs);
+		for (int i = 0; i < count; i++)
+		{
+			akeEndpoint *endpoint = (akeEndpoint *)events[i].data.ptr;
+			if (endpoint->kind == akeListener)
+			{
+				acceptConnections(src, endpoint->fd);
+			}
+			else if (endpoint->kind == akeConnection)
+			{
+				handshakeEvent(src, (akeHandshake *)endpoint, events[i].events);
+			}
+			else
+			{
+				uint64_t value;
+				ssize_t got = read(endpoint->fd, &value, sizeof(value));
+				(void)got;
+			}
+		}
+		timeoutMs = expireHandshakes(src);
+	}
+
+	for (uint32_t i = 0; i < DTCP_AKE_MAX_CONNECTIONS; i++)
+	{
+		if (src->handshakes[i].state != akeIdle)
+		{
+			closeHandshake(&src->handshakes[i]);
+		}
+	}
+}
+
+static void closeSourceFds(akeSource *src)
+{
+	for (uint32_t i = 0; i < src->numListeners; i++)
+	{
+		close(src->listeners[i].fd);
+	}
+	src->numListeners = 0;
+	if (src->wakeup.fd >= 0)
+	{
+		close(src->wakeup.fd);
+		src->wakeup.fd = -1;
+	}
+	if (src->epollFd >= 0)
+	{
+		close(src->epollFd);
+		src->epollFd = -1;
+	}
+}
+
+/* Called with controlLock held. */
+static bool startSource(void)
+{
+	akeSource *src = source.load();
+	if (src == NULL)
+	{
+		src = new (std::nothrow) akeSource();
+		if (src == NULL)
+		{
+			return false;
+		}
+		source.store(src);
+	}
+	if (src->running)
+	{
+		return true;
+	}
+
+	src->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	src->wakeup.kind = akeWakeup;
+	src->wakeup.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = &src->wakeup;
+	if (src->epollFd < 0 || src->wakeup.fd < 0 || epoll_ctl(src->epollFd, EPOLL_CTL_ADD, src->wakeup.fd, &event) != 0)
+	{
+		closeSourceFds(src);
+		return false;
+	}
+	loadAuthKey(&src->auth);
+	{
+		/* A restarted source issues new keys, so sinks holding old ones must run the AKE again. */
+		std::lock_guard<std::mutex> lock(src->keyLock);
+		/* A new label lets sinks that cached the old key see the restart in the first PCP. */
+		uint8_t previousLabel = src->sharedLabel;
+		bool keyMade = true;
+		memset(src->keyIssued, 0, sizeof(src->keyIssued));
+		do
+		{
+			keyMade = DTCPPcpRandom(&src->sharedLabel, sizeof(src->sharedLabel));
+		} while (keyMade && src->sharedLabel == previousLabel);
+		keyMade = keyMade && DTCPPcpRandom(src->keys[src->sharedLabel], DTCP_EXCHANGE_KEY_SIZE);
+		if (!keyMade)
+		{
+			closeSourceFds(src);
+			return false;
+		}
+		src->keyIssued[src->sharedLabel] = true;
+		src->keyExpiry[src->sharedLabel] = 0;
+		src->nextLabel = (uint8_t)(src->sharedLabel + 1);
+		src->keysValid = true;
+	}
+
+	src->stop.store(false);
+	try
+	{
+		src->thread = std::thread(sourceLoop, src);
+	}
+	catch (const std::system_error &)
+	{
+		std::lock_guard<std::mutex> lock(src->keyLock);
+		src->keysValid = false;
+		closeSourceFds(src);
+		return false;
+	}
+	src->running = true;
+	return true;
+}
+
+static bool interfaceAddress(const char *ifName, struct in_addr *address)
+{
+	struct ifaddrs *list;
+	bool found = false;
+
+	if (getifaddrs(&list) != 0)
+	{
+		return false;
+	}
+	for (struct ifaddrs *entry = list; entry != NULL && !found; entry = entry->ifa_next)
+	{
+		if (entry->ifa_addr != NULL && entry->ifa_addr->sa_family == AF_INET && strcmp(entry->ifa_name, ifName) == 0)
+		{
+			*address = ((struct sockaddr_in *)entry->ifa_addr)->sin_addr;
+			found = true;
+		}
+	}
+	freeifaddrs(list);
+	return found;
+}
+
+dtcp_result_t DTCPAkeListen(const char *ifName, int port)
+{
+	struct sockaddr_in address;
+	bool anyInterface = (ifName == NULL || ifName[0] == '\0');
+
+	if (port <= 0 || port > 0xFFFF)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)port);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (!anyInterface && !interfaceAddress(ifName, &address.sin_addr))
+	{
+		DTCP_LOG_ERROR("AKE: interface %s has no IPv4 address\n", ifName);
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	std::lock_guard<std::mutex> lock(controlLock);
+	akeSource *src = source.load();
+	if (src != NULL && src->running && src->numListeners == DTCP_AKE_MAX_LISTENERS)
+	{
+		return DTCP_ERR_GENERAL;
+	}
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int one = 1;
+	if (fd < 0 ||
+	    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+	    bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+	    listen(fd, DTCP_AKE_BACKLOG) != 0)
+	{
+		DTCP_LOG_ERROR("AKE: cannot listen on %s port %d: %s\n", anyInterface ? "all interfaces" : ifName, port,
+		               strerror(errno));
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return DTCP_ERR_GENERAL;
+	}
+	if (!startSource())
+	{
+		close(fd);
+		return DTCP_ERR_GENERAL;
+	}
+
+	src = source.load();
+	akeEndpoint *listener = &src->listeners[src->numListeners];
+	listener->kind = akeListener;
+	listener->fd = fd;
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = listener;
+	if (epoll_ctl(src->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+	{
+		close(fd);
+		return DTCP_ERR_GENERAL;
+	}
+	src->numListeners++;
+	DTCP_LOG_INFO("AKE: listening on %s port %d\n", anyInterface ? "all interfaces" : ifName, port);
+	return DTCP_SUCCESS;
+}
+
+void DTCPAkeStop(void)
+{
+	std::lock_guard<std::mutex> lock(controlLock);
+	akeSource *src = source.load();
+	if (src == NULL || !src->running)
+	{
+		return;
+	}
+	src->stop.store(true);
+	uint64_t one = 1;
+	ssize_t written = write(src->wakeup.fd, &one, sizeof(one));
+	(void)written;
+	src->thread.join();
+	closeSourceFds(src);
+	{
+		std::lock_guard<std::mutex> keys(src->keyLock);
+		src->keysValid = false;
+		memset(src->keys, 0, sizeof(src->keys));
+		memset(src->keyIssued, 0, sizeof(src->keyIssued));
+	}
+	src->running = false;
+	DTCP_LOG_INFO("AKE: source stopped\n");
+}
+
+dtcp_result_t DTCPAkeSourceKey(int keyLabel, uint8_t *label, uint8_t *exchangeKey)
+{
+	akeSource *src = source.load();
+	if (src == NULL)
+	{
+		return DTCP_ERR_NOT_INITIALIZED;
+	}
+	std::lock_guard<std::mutex> lock(src->keyLock);
+	if (!src->keysValid)
+	{
+		return DTCP_ERR_NOT_INITIALIZED;
+	}
+	if (keyLabel < 0)
+	{
+		keyLabel = src->sharedLabel;
+	}
+	if (keyLabel >= AKE_NUM_LABELS || !keyValid(src, (uint8_t)keyLabel, DTCPStatsNow()))
+	{
+		return DTCP_ERR_INVALID_KEY_LABEL;
+	}
+	*label = (uint8_t)keyLabel;
+	memcpy(exchangeKey, src->keys[keyLabel], DTCP_EXCHANGE_KEY_SIZE);
+	return DTCP_SUCCESS;
+}
+
+/* Sink side. */
+
+static bool waitFd(int fd, short events, uint64_t deadline)
+{
+	for (;;)
+	{
+		uint64_t now = DTCPStatsNow();
+		if (now >= deadline)
+		{
+			return false;
+		}
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = events;
+		pfd.revents = 0;
+		int ready = poll(&pfd, 1, (int)((deadline - now + 999999) / 1000000));
+		if (ready > 0)
+		{
+			return true;
+		}
+		if (ready == 0 || errno != EINTR)
+		{
+			return false;
+		}
+	}
+}
+
+static bool connectTo(int fd, const struct sockaddr_in *address, uint64_t deadline)
+{
+	if (connect(fd, (const struct sockaddr *)address, sizeof(*address)) == 0)
+	{
+		return true;
+	}
+	if (errno != EINPROGRESS || !waitFd(fd, POLLOUT, deadline))
+	{
+		return false;
+	}
+	int error = 0;
+	socklen_t length = sizeof(error);
+	return getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+}
+
+static bool sendMessage(int fd, uint8_t subfunction, const uint8_t *body, uint16_t length, uint64_t deadline)
+{
+	uint8_t message[AKE_MAX_MESSAGE];
+	uint32_t total = buildMessage(message, subfunction, body, length);
+	uint32_t sent = 0;
+
+	while (sent < total)
+	{
+		ssize_t n = send(fd, message + sent, total - sent, MSG_NOSIGNAL);
+		if (n >= 0)
+		{
+			sent += (uint32_t)n;
+		}
+		else if (errno != EINTR && !((errno == EAGAIN || errno == EWOULDBLOCK) && waitFd(fd, POLLOUT, deadline)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool receiveMessage(int fd, uint8_t *subfunction, uint8_t *body, uint32_t *length, uint64_t deadline)
+{
+	uint8_t message[AKE_MAX_MESSAGE];
+	uint32_t received = 0;
+	uint32_t total = AKE_HEADER_SIZE;
+
+	while (received < total)
+	{
+		ssize_t n = recv(fd, message + received, total - received, 0);
+		if (n > 0)
+		{
+			received += (uint32_t)n;
+			if (received == AKE_HEADER_SIZE)
+			{
+				if (message[0] != AKE_TYPE_CONTROL || getBe16(&message[2]) > AKE_MAX_BODY)
+				{
+					return false;
+				}
+				total += getBe16(&message[2]);
+			}
+		}
+		else if (n == 0 ||
+		         (errno != EINTR && !((errno == EAGAIN || errno == EWOULDBLOCK) && waitFd(fd, POLLIN, deadline))))
+		{
+			return false;
+		}
+	}
+	*subfunction = message[1];
+	*length = total - AKE_HEADER_SIZE;
+	memcpy(body, &message[AKE_HEADER_SIZE], *length);
+	return true;
+}
+
+static dtcp_result_t sinkHandshake(int fd, bool uniqueKey, DTCPAkeKey *key, uint64_t deadline)
+{
+	DTCPAesKey auth;
+	akeTranscript transcript;
+	uint8_t expected[DTCP_AES_BLOCK_SIZE];
+	uint8_t body[AKE_MAX_BODY];
+	uint8_t subfunction;
+	uint32_t length;
+
+	loadAuthKey(&auth);
+	transcript.sinkId = DTCPAkeDeviceId();
+	if (transcript.sinkId == 0 || !DTCPPcpRandom(transcript.sinkNonce, sizeof(transcript.sinkNonce)))
+	{
+		return DTCP_ERR_AKE;
+	}
+	body[0] = uniqueKey ? AKE_FLAG_UNIQUE_KEY : 0;
+	memcpy(&body[1], transcript.sinkNonce, sizeof(transcript.sinkNonce));
+	putDeviceId(&body[1 + DTCP_AES_BLOCK_SIZE], transcript.sinkId);
+	if (!sendMessage(fd, AKE_CHALLENGE, body, AKE_CHALLENGE_SIZE, deadline) ||
+	    !receiveMessage(fd, &subfunction, body, &length, deadline))
+	{
+		return DTCP_ERR_AKE;
+	}
+	if (subfunction == AKE_REJECTED && length == 1 && body[0] == AKE_REJECT_REVOKED)
+	{
+		DTCP_LOG_WARN("AKE: the source found this device on its SRM\n");
+		return DTCP_ERR_INVALID_CERTIFICATE;
+	}
+	if (subfunction != AKE_SOURCE_CHALLENGE || length != AKE_SOURCE_CHALLENGE_SIZE)
+	{
+		return DTCP_ERR_AKE;
+	}
+	key->deviceId = getDeviceId(&body[2 * DTCP_AES_BLOCK_SIZE]);
+	if (DTCPSrmRevoked(key->deviceId))
+	{
+		DTCP_LOG_WARN("AKE: source device 0x%010llx is revoked\n", (unsigned long long)key->deviceId);
+		return DTCP_ERR_INVALID_CERTIFICATE;
+	}
+	transcript.sourceId = key->deviceId;
+	memcpy(transcript.sourceNonce, body, sizeof(transcript.sourceNonce));
+	akeMac(&auth, AKE_MAC_SOURCE, &transcript, expected);
+	if (!sameBlock(expected, &body[DTCP_AES_BLOCK_SIZE]))
+	{
+		DTCP_LOG_DEBUG("AKE: source failed authentication\n");
+		return DTCP_ERR_AKE;
+	}
+
+	akeMac(&auth, AKE_MAC_SINK, &transcript, body);
+	if (!sendMessage(fd, AKE_RESPONSE, body, DTCP_AES_BLOCK_SIZE, deadline) ||
+	    !receiveMessage(fd, &subfunction, body, &length, deadline) ||
+	    subfunction != AKE_EXCHANGE_KEY || length != AKE_KEY_MESSAGE_SIZE)
+	{
+		return DTCP_ERR_AKE;
+	}
+	key->label = body[0];
+	key->validitySec = getBe32(&body[1]);
+	wrapKey(&auth, &transcript, &body[5], key->key);
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPAkeExchange(const char *ipAddress, int port, bool uniqueKey, DTCPAkeKey *key)
+{
+	struct sockaddr_in address;
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	if (ipAddress == NULL || inet_pton(AF_INET, ipAddress, &address.sin_addr) != 1)
+	{
+		return DTCP_ERR_INVALID_IP_ADDRESS;
+	}
+	if (port <= 0 || port > 0xFFFF)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	address.sin_port = htons((uint16_t)port);
+
+	uint64_t deadline = DTCPStatsNow() + (uint64_t)DTCP_AKE_TIMEOUT_MS * 1000000;
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		return DTCP_ERR_GENERAL;
+	}
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	dtcp_result_t result = DTCP_ERR_SERVER_NOT_REACHABLE;
+	if (connectTo(fd, &address, deadline))
+	{
+		result = sinkHandshake(fd, uniqueKey, key, deadline);
+	}
+	close(fd);
+	if (result != DTCP_SUCCESS)
+	{
+		DTCP_LOG_ERROR("AKE with %s port %d failed: %d\n", ipAddress, port, result);
+	}
+	return result;
+}
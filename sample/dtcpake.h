@@ -0,0 +1,125 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpake.h
+ * Authentication and Key Exchange (AKE) of the reference DTCP Manager.
+ *
+ * The source side is a single thread running an epoll loop over every
+ * listener added with DTCPMgrStartSource() and every handshake in progress.
+ * Handshakes are non-blocking state machines, so a slow or stalled sink
+ * only holds its own connection slot and never delays the others.
+ *
+ * The licensed AKE exchanges certificates and signatures; the reference
+ * keeps its message flow on TCP but authenticates with a shared test key:
+ *
+ * Sink                                   Source
+ * CHALLENGE(flags, Nsink, IDsink) ->
+ *                                <-      SOURCE_CHALLENGE(Nsource, MAC(source), IDsource)
+ * RESPONSE(MAC(sink))            ->
+ *                                <-      EXCHANGE_KEY(label, validity, Kx ^ MAC(key))
+ *
+ * Every message is a 4 byte header, type, subfunction and a big endian
+ * body length, followed by the body. MAC(purpose) is the AES CBC-MAC under
+ * the authentication key of three blocks:
+ *
+ *     purpose (1 byte) | IDsink (5) | IDsource (5) | zeros (5),  Nsink,  Nsource
+ *
+ * with purpose 1 for source, 2 for sink and 3 for key. Every MAC covers the
+ * same length, as CBC-MAC needs. The purpose keeps each MAC from
+ * standing in for another: the source computes MAC(source) for whatever
+ * Nsink a client sends, but that reveals nothing about MAC(sink), which
+ * would pass RESPONSE, or MAC(key), the key wrap pad, of this or any other
+ * handshake. The nonces and device IDs bind each MAC to one handshake.
+ * Each side checks the other's device ID, which the licensed AKE takes from
+ * the certificate, against the SRM; a source answers a revoked sink with
+ * REJECTED(revoked).
+ */
+
+#ifndef __DTCPAKE_H_
+#define __DTCPAKE_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+#include "dtcppcp.h"
+
+#define DTCP_AKE_MAX_LISTENERS    16
+#define DTCP_AKE_MAX_CONNECTIONS  256    /**< Handshakes in progress at the source.          */
+#define DTCP_AKE_BACKLOG          128
+#define DTCP_AKE_TIMEOUT_MS       5000   /**< Limit on one handshake, at either end.         */
+#define DTCP_AKE_KEY_VALIDITY_SEC 7200   /**< Validity the source gives its exchange keys;
+                                              a unique key's label is reused after it.     */
+
+/**
+ * @brief Exchange key received by a sink.
+ */
+typedef struct DTCPAkeKey_s
+{
+	uint8_t  label;
+	uint8_t  key[DTCP_EXCHANGE_KEY_SIZE];
+	uint32_t validitySec;   /**< Seconds the source keeps the key valid. */
+	uint64_t deviceId;      /**< Device ID of the source.                */
+} DTCPAkeKey;
+
+/**
+ * @brief Returns the device ID this process presents in the AKE, made up on first use.
+ *
+ * Returns 0 while no random bytes could be had for it; the AKE fails then.
+ */
+uint64_t DTCPAkeDeviceId(void);
+
+/**
+ * @brief Adds a listener on the IPv4 address of @a ifName, or on all addresses if it is NULL or empty.
+ *
+ * The first listener starts the AKE thread and generates the source's exchange key.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a ifName has no IPv4 address or @a port is out of range,
+ * DTCP_ERR_GENERAL if the socket could not be bound or the thread not started.
+ */
+dtcp_result_t DTCPAkeListen(const char *ifName, int port);
+
+/**
+ * @brief Closes all listeners and handshakes and stops the AKE thread.
+ *
+ * Exchange keys issued so far become invalid; the next DTCPAkeListen() generates new ones.
+ */
+void DTCPAkeStop(void);
+
+/**
+ * @brief Looks up an exchange key issued by the running source.
+ *
+ * @param[in] keyLabel Label of the key, or -1 for the source's shared exchange key.
+ *
+ * @return DTCP_ERR_NOT_INITIALIZED if the source is not started, DTCP_ERR_INVALID_KEY_LABEL
+ * if it has issued no key with @a keyLabel, or a unique one that has expired.
+ */
+dtcp_result_t DTCPAkeSourceKey(int keyLabel, uint8_t *label, uint8_t *exchangeKey);
+
+/**
+ * @brief Runs the sink side of the AKE with the source at @a ipAddress and @a port.
+ *
+ * Blocks for at most DTCP_AKE_TIMEOUT_MS.
+ *
+ * @return DTCP_ERR_INVALID_IP_ADDRESS, DTCP_ERR_SERVER_NOT_REACHABLE if no connection could be made,
+ * DTCP_ERR_AKE if the handshake was rejected, malformed or timed out, DTCP_ERR_INVALID_CERTIFICATE
+ * if the source is revoked by the SRM in use or the source found this device on its own.
+ */
+dtcp_result_t DTCPAkeExchange(const char *ipAddress, int port, bool uniqueKey, DTCPAkeKey *key);
+
+#endif //__DTCPAKE_H_
@@ -0,0 +1,376 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <new>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/errqueue.h>
+#include "dtcpfd.h"
+#include "dtcplog.h"
+#include "dtcppool.h"
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define HAVE_ZEROCOPY 1
+#endif
+
+/* A flushed sender whose sends had not all completed, kept until they have. */
+typedef struct retiredSender_s
+{
+	DTCPFdSender            sender;
+	struct retiredSender_s *next;
+} retiredSender;
+
+static std::mutex retiredLock;
+static retiredSender *retired = NULL;
+static std::atomic<uint32_t> numRetired(0);
+
+static inline bool idBefore(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+static int64_t nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void releaseCompleted(DTCPFdSender *sender)
+{
+	while (sender->count > 0)
+	{
+		DTCPFdPending *entry = &sender->pending[sender->head];
+		if (!idBefore(entry->sendId, sender->completedId))
+		{
+			break;
+		}
+		DTCPPoolPut(entry->data);
+		DTCPPoolPut(entry->header);
+		sender->head = (sender->head + 1) % DTCP_FD_MAX_PENDING;
+		sender->count--;
+	}
+}
+
+static void reapCompletions(DTCPFdSender *sender)
+{
+#ifdef HAVE_ZEROCOPY
+	for (;;)
+	{
+		char control[128];
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (sender->notifyFd < 0 || recvmsg(sender->notifyFd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+		{
+			break;
+		}
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+			    !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+			{
+				continue;
+			}
+			const struct sock_extended_err *err = (const struct sock_extended_err *)CMSG_DATA(cmsg);
+			if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+			{
+				continue;
+			}
+			/* ee_info..ee_data is the range of completed send ids. */
+			if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+			{
+				sender->copiedSends += err->ee_data - err->ee_info + 1;
+			}
+			if (!idBefore(err->ee_data, sender->completedId))
+			{
+				sender->completedId = err->ee_data + 1;
+			}
+		}
+	}
+#endif
+	releaseCompleted(sender);
+}
+
+/*
+ * Completions are signalled by POLLERR on the duplicate, which stays valid
+ * when the caller closes its fd. Returns false once the deadline has passed.
+ */
+static bool waitCompletions(DTCPFdSender *sender, int64_t deadline)
+{
+	int64_t remaining = deadline - nowMs();
+	if (remaining <= 0)
+	{
+		return false;
+	}
+	struct pollfd pfd;
+	pfd.fd = sender->notifyFd;
+	pfd.events = 0;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, (int)remaining) < 0 || (pfd.revents & POLLNVAL))
+	{
+		return false;
+	}
+	reapCompletions(sender);
+	return true;
+}
+
+static void enableZeroCopy(DTCPFdSender *sender)
+{
+	sender->zeroCopyTried = true;
+#ifdef HAVE_ZEROCOPY
+	int type = 0;
+	int one = 1;
+	socklen_t length = sizeof(type);
+	if (sender->isSocket && getsockopt(sender->fd, SOL_SOCKET, SO_TYPE, &type, &length) == 0 && type == SOCK_STREAM &&
+	    setsockopt(sender->fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0)
+	{
+		/* Without a socket of its own to reap from, held buffers could outlive the caller's fd. */
+		sender->notifyFd = fcntl(sender->fd, F_DUPFD_CLOEXEC, 0);
+		sender->zeroCopy = (sender->notifyFd >= 0);
+	}
+#endif
+}
+
+/* Reaps the senders retired by DTCPFdFlush(); skipped while another thread does. */
+static void reapRetired(void)
+{
+	if (numRetired.load(std::memory_order_relaxed) == 0)
+	{
+		return;
+	}
+	std::unique_lock<std::mutex> lock(retiredLock, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		return;
+	}
+	retiredSender **link = &retired;
+	while (*link != NULL)
+	{
+		retiredSender *entry = *link;
+		reapCompletions(&entry->sender);
+		if (entry->sender.count > 0)
+		{
+			link = &entry->next;
+			continue;
+		}
+		close(entry->sender.notifyFd);
+		*link = entry->next;
+		delete entry;
+		numRetired.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+/* Hands the buffers of sends still referenced by the kernel to the retired list. */
+static void retire(DTCPFdSender *sender)
+{
+	retiredSender *entry = new (std::nothrow) retiredSender;
+	if (entry == NULL)
+	{
+		/* Leaking them is safe, recycling them is not. */
+		DTCP_LOG_WARN("Could not retire %u zero-copy packets, their buffers are kept\n", sender->count);
+		return;
+	}
+	entry->sender = *sender;
+	std::lock_guard<std::mutex> lock(retiredLock);
+	entry->next = retired;
+	retired = entry;
+	numRetired.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void bindFd(DTCPFdSender *sender, int fd)
+{
+	int type;
+	socklen_t length = sizeof(type);
+	sender->bound = true;
+	sender->fd = fd;
+	sender->notifyFd = -1;
+	sender->isSocket = getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &length) == 0;
+	sender->zeroCopy = false;
+	sender->zeroCopyTried = false;
+	sender->nextSendId = 0;
+	sender->completedId = 0;
+}
+
+dtcp_result_t DTCPFdSend(DTCPFdSender *sender, int fd, bool zeroCopy, const struct iovec *segments, uint32_t numSegments,
+                         uint8_t *data, uint8_t *header)
+{
+	reapRetired();
+	if (sender->bound && sender->fd != fd)
+	{
+		DTCPFdFlush(sender, DTCP_FD_FLUSH_TIMEOUT_MS);
+	}
+	if (!sender->bound)
+	{
+		bindFd(sender, fd);
+	}
+	if (zeroCopy && !sender->zeroCopyTried)
+	{
+		enableZeroCopy(sender);
+	}
+
+	bool useZeroCopy = zeroCopy && sender->zeroCopy;
+	if (useZeroCopy)
+	{
+		int64_t deadline = nowMs() + DTCP_FD_FLUSH_TIMEOUT_MS;
+		reapCompletions(sender);
+		while (sender->count == DTCP_FD_MAX_PENDING && waitCompletions(sender, deadline))
+		{
+		}
+		/* Still full: the kernel holds on to the buffers, so copy this one. */
+		useZeroCopy = sender->count < DTCP_FD_MAX_PENDING;
+	}
+
+	struct iovec iov[DTCPIP_MAX_PACKET_SEGMENTS];
+	struct iovec *cur = iov;
+	uint32_t remaining = (numSegments < DTCPIP_MAX_PACKET_SEGMENTS) ? numSegments : DTCPIP_MAX_PACKET_SEGMENTS;
+	bool zeroCopySent = false;
+	int64_t stallDeadline = 0;
+	int error = 0;
+	memcpy(iov, segments, remaining * sizeof(struct iovec));
+	while (remaining > 0)
+	{
+		ssize_t sent;
+		if (sender->isSocket)
+		{
+			struct msghdr msg;
+			int flags = MSG_NOSIGNAL;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = cur;
+			msg.msg_iovlen = remaining;
+#ifdef HAVE_ZEROCOPY
+			if (useZeroCopy)
+			{
+				flags |= MSG_ZEROCOPY;
+			}
+#endif
+			sent = sendmsg(fd, &msg, flags);
+			if (sent < 0 && errno == ENOBUFS && useZeroCopy)
+			{
+				/* Out of notification memory, send the rest by copy. */
+				useZeroCopy = false;
+				continue;
+			}
+		}
+		else
+		{
+			sent = writev(fd, cur, remaining);
+		}
+		if (sent < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				/* A non-blocking fd is waited on, unless it takes nothing for the whole timeout. */
+				int64_t now = nowMs();
+				if (stallDeadline == 0)
+				{
+					stallDeadline = now + DTCP_FD_SEND_TIMEOUT_MS;
+				}
+				if (now < stallDeadline)
+				{
+					struct pollfd pfd;
+					pfd.fd = fd;
+					pfd.events = POLLOUT;
+					pfd.revents = 0;
+					poll(&pfd, 1, (int)(stallDeadline - now));
+					continue;
+				}
+				errno = EAGAIN;
+			}
+			error = errno;
+			break;
+		}
+		stallDeadline = 0;
+		if (useZeroCopy && sent > 0)
+		{
+			sender->nextSendId++;
+			sender->zeroCopySends++;
+			zeroCopySent = true;
+		}
+		while (remaining > 0 && (size_t)sent >= cur->iov_len)
+		{
+			sent -= cur->iov_len;
+			cur++;
+			remaining--;
+		}
+		if (remaining > 0)
+		{
+			cur->iov_base = (uint8_t *)cur->iov_base + sent;
+			cur->iov_len -= sent;
+		}
+	}
+
+	if (zeroCopySent)
+	{
+		DTCPFdPending *entry = &sender->pending[(sender->head + sender->count) % DTCP_FD_MAX_PENDING];
+		entry->sendId = sender->nextSendId - 1;
+		entry->data = data;
+		entry->header = header;
+		sender->count++;
+	}
+	else
+	{
+		DTCPPoolPut(data);
+		DTCPPoolPut(header);
+	}
+	if (error != 0)
+	{
+		errno = error;
+		return DTCP_ERR_GENERAL;
+	}
+	return DTCP_SUCCESS;
+}
+
+void DTCPFdFlush(DTCPFdSender *sender, int timeoutMs)
+{
+	reapRetired();
+	if (!sender->bound)
+	{
+		return;
+	}
+	int64_t deadline = nowMs() + timeoutMs;
+	reapCompletions(sender);
+	while (sender->count > 0 && waitCompletions(sender, deadline))
+	{
+	}
+	if (sender->count > 0)
+	{
+		/* The kernel may still read these buffers; they go back to the pool once it reports it no longer does. */
+		retire(sender);
+		sender->count = 0;
+	}
+	else if (sender->notifyFd >= 0)
+	{
+		close(sender->notifyFd);
+	}
+	sender->bound = false;
+}
@@ -0,0 +1,95 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpfd.h
+ * File descriptor output of the reference DTCP Manager.
+ *
+ * Writes the segments of a processed packet to a socket or pipe. On a
+ * socket that accepts SO_ZEROCOPY the segments are sent with MSG_ZEROCOPY,
+ * and the pool buffers behind them are held in a per-session ring until the
+ * kernel reports on the socket error queue that it no longer references
+ * them. Completions of a TCP socket arrive in send order, so the ring only
+ * tracks the highest completed send.
+ *
+ * The error queue is read through a dup() of the socket, so the socket lives
+ * on, and its completions keep arriving, after the caller closes its fd.
+ * Buffers still referenced when a sender is flushed move to a module-wide
+ * retired list with that duplicate and go back to their pool only once their
+ * sends complete; later sends and flushes of any session reap the list.
+ */
+
+#ifndef __DTCPFD_H_
+#define __DTCPFD_H_
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include "dtcpmgr.h"
+
+#define DTCP_FD_MAX_PENDING       64    /**< Packets held for zero-copy completion per session. */
+#define DTCP_FD_FLUSH_TIMEOUT_MS  1000  /**< Wait for outstanding completions at session delete. */
+#define DTCP_FD_SEND_TIMEOUT_MS   5000  /**< Wait for a non-blocking fd that accepts no data.   */
+
+typedef struct
+{
+	uint32_t sendId;       /**< Id of the last MSG_ZEROCOPY send that referenced the buffers. */
+	uint8_t *data;
+	uint8_t *header;
+} DTCPFdPending;
+
+/**
+ * @brief Output state of one session, zero-initialized when idle.
+ */
+typedef struct DTCPFdSender_s
+{
+	bool          bound;                         /**< fd below is in use.                          */
+	int           fd;
+	int           notifyFd;                      /**< dup() of fd completions are read from, or -1. */
+	bool          isSocket;
+	bool          zeroCopy;                      /**< SO_ZEROCOPY is enabled on fd.                */
+	bool          zeroCopyTried;
+	uint32_t      nextSendId;                    /**< Id the kernel gives the next zero-copy send. */
+	uint32_t      completedId;                   /**< Sends below this id have completed.          */
+	uint32_t      head;
+	uint32_t      count;
+	DTCPFdPending pending[DTCP_FD_MAX_PENDING];
+	uint64_t      zeroCopySends;
+	uint64_t      copiedSends;                   /**< Zero-copy sends the kernel had to copy.      */
+} DTCPFdSender;
+
+/**
+ * @brief Writes @a numSegments segments to @a fd.
+ *
+ * Takes ownership of the pool buffers @a data and @a header (either may be NULL); they are returned
+ * to their pool once the kernel has released them. A sender used with a new @a fd first flushes the
+ * previous one. A non-blocking @a fd that accepts nothing for DTCP_FD_SEND_TIMEOUT_MS fails the write.
+ *
+ * @return DTCP_ERR_GENERAL if the write failed, with errno set (EAGAIN on timeout).
+ */
+dtcp_result_t DTCPFdSend(DTCPFdSender *sender, int fd, bool zeroCopy, const struct iovec *segments, uint32_t numSegments,
+                         uint8_t *data, uint8_t *header);
+
+/**
+ * @brief Waits up to @a timeoutMs for outstanding completions, then unbinds the sender.
+ *
+ * Buffers whose sends have not completed by then are retired rather than returned to their pool.
+ */
+void DTCPFdFlush(DTCPFdSender *sender, int timeoutMs);
+
+#endif //__DTCPFD_H_
@@ -0,0 +1,190 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <errno.h>
+#include <new>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include "dtcpfd.h"
+#include "dtcpfile.h"
+#include "dtcppcp.h"
+#include "dtcpstats.h"
+#include "dtcpworker.h"
+
+/*
+ * Returns the end of the last whole PCP that fits in [start, start + chunkSize), walking the
+ * headers from @a nextHeader on, or start + chunkSize if none does (a PCP larger than a chunk
+ * is then cut, and its chunks follow each other through the strand).
+ */
+static size_t sinkChunkEnd(const uint8_t *data, size_t size, size_t start, size_t chunkSize, size_t *nextHeader)
+{
+	size_t limit = (size - start > chunkSize) ? start + chunkSize : size;
+	size_t end = start;
+	while (*nextHeader < size && size - *nextHeader >= DTCP_PCP_HEADER_SIZE)
+	{
+		DTCPPcpHeader header;
+		if (!DTCPPcpParseHeader(data + *nextHeader, &header))
+		{
+			/* Not a PCP stream from here; the sink reports the error on the chunk. */
+			*nextHeader = size;
+			break;
+		}
+		size_t pcpEnd = *nextHeader + DTCP_PCP_HEADER_SIZE +
+		                ((header.contentLength + DTCP_AES_BLOCK_SIZE - 1) & ~(size_t)(DTCP_AES_BLOCK_SIZE - 1));
+		if (pcpEnd > limit)
+		{
+			break;
+		}
+		end = pcpEnd;
+		*nextHeader = pcpEnd;
+	}
+	return (end > start) ? end : limit;
+}
+
+/* Hands the output of @a packet to @a sender, which returns its buffers to the pools. */
+static dtcp_result_t writePacket(DTCPFdSender *sender, int fd, DTCPIP_Packet *packet, uint64_t *bytesOut)
+{
+	struct iovec segments[DTCPIP_MAX_PACKET_SEGMENTS];
+	uint32_t numSegments = 0;
+	dtcp_result_t ret = DTCPMgrGetPacketSegments(packet, segments, DTCPIP_MAX_PACKET_SEGMENTS, &numSegments);
+	if (ret != DTCP_SUCCESS)
+	{
+		DTCPMgrReleasePacket(packet);
+		return ret;
+	}
+	for (uint32_t i = 0; i < numSegments; i++)
+	{
+		*bytesOut += segments[i].iov_len;
+	}
+	ret = DTCPFdSend(sender, fd, false, segments, numSegments, packet->dataOutPtr, packet->pcpHeader);
+	packet->dataOutPtr = NULL;
+	packet->pcpHeader = NULL;
+	return ret;
+}
+
+dtcp_result_t DTCPFileProcess(DTCP_SESSION_HANDLE session, bool isSource, int inFd, int outFd, uint32_t chunkSize,
+                              DTCPIP_FileStats *stats)
+{
+	struct stat st;
+	if (outFd < 0 || fstat(inFd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	uint64_t start = DTCPStatsNow();
+	size_t size = (size_t)st.st_size;
+	const uint8_t *data = NULL;
+	if (size > 0)
+	{
+		void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, inFd, 0);
+		if (map == MAP_FAILED)
+		{
+			return DTCP_ERR_GENERAL;
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+		data = (const uint8_t *)map;
+	}
+
+	uint32_t window = DTCP_FILE_CHUNKS_PER_WORKER * (DTCPWorkerCount() + 1);
+	if (window > DTCPIP_MAX_IN_FLIGHT)
+	{
+		window = DTCPIP_MAX_IN_FLIGHT;
+	}
+	/* Submitted packets stay where they are until completed, which is in submit order. */
+	std::vector<DTCPIP_Packet> packets(window);
+	DTCPFdSender *sender = new (std::nothrow) DTCPFdSender();
+	if (sender == NULL)
+	{
+		if (data != NULL)
+		{
+			munmap((void *)data, size);
+		}
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	uint32_t head = 0;
+	uint32_t count = 0;
+	size_t offset = 0;
+	size_t nextHeader = 0;
+	uint64_t bytesOut = 0;
+	dtcp_result_t ret = DTCP_SUCCESS;
+	while (ret == DTCP_SUCCESS && (offset < size || count > 0))
+	{
+		if (offset < size && count < window)
+		{
+			size_t end = isSource ? ((size - offset > chunkSize) ? offset + chunkSize : size)
+			                      : sinkChunkEnd(data, size, offset, chunkSize, &nextHeader);
+			DTCPIP_Packet *packet = &packets[(head + count) % window];
+			memset(packet, 0, sizeof(*packet));
+			packet->session = session;
+			packet->dataInPtr = (uint8_t *)data + offset;
+			packet->dataLength = (uint32_t)(end - offset);
+			packet->isEOF = (isSource && end == size) ? 1 : 0;
+			ret = DTCPMgrSubmitPacket(session, packet);
+			if (ret == DTCP_SUCCESS)
+			{
+				count++;
+				offset = end;
+			}
+			continue;
+		}
+
+		DTCPIP_Packet *packet;
+		dtcp_result_t result;
+		ret = DTCPMgrCompletePacket(session, -1, &packet, &result);
+		if (ret != DTCP_SUCCESS)
+		{
+			break;
+		}
+		head = (head + 1) % window;
+		count--;
+		ret = (result == DTCP_SUCCESS) ? writePacket(sender, outFd, packet, &bytesOut) : result;
+	}
+
+	/* After an error, drop what is still in flight. */
+	int error = errno;
+	while (count > 0)
+	{
+		DTCPIP_Packet *packet;
+		dtcp_result_t result;
+		if (DTCPMgrCompletePacket(session, -1, &packet, &result) != DTCP_SUCCESS)
+		{
+			break;
+		}
+		if (result == DTCP_SUCCESS)
+		{
+			DTCPMgrReleasePacket(packet);
+		}
+		count--;
+	}
+	DTCPFdFlush(sender, 0);
+	delete sender;
+	if (data != NULL)
+	{
+		munmap((void *)data, size);
+	}
+	errno = error;
+
+	if (stats != NULL)
+	{
+		stats->bytesIn = offset;
+		stats->bytesOut = bytesOut;
+		stats->elapsedNs = DTCPStatsNow() - start;
+	}
+	return ret;
+}
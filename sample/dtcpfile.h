@@ -0,0 +1,49 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpfile.h
+ * Whole-file processing of the reference DTCP Manager.
+ *
+ * The input file is mapped rather than read, so each chunk is handed to the
+ * session straight from the page cache. Chunks go through the session's
+ * submission queue and are written out as they complete, in order; a sliding
+ * window of a few chunks per worker keeps every core busy while bounding the
+ * output held in the pools. A sink cuts the file where PCP headers start, so
+ * its chunks can be decrypted in parallel.
+ */
+
+#ifndef __DTCPFILE_H_
+#define __DTCPFILE_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+
+#define DTCP_FILE_CHUNK_SIZE        (1024 * 1024)  /**< Default bytes per submitted chunk.  */
+#define DTCP_FILE_CHUNKS_PER_WORKER 2              /**< Chunks in flight per worker thread. */
+
+/**
+ * @brief Processes the regular file @a inFd on @a session and writes the output to @a outFd.
+ *
+ * @a session must not be deleted meanwhile. See DTCPMgrProcessFile() for the results.
+ */
+dtcp_result_t DTCPFileProcess(DTCP_SESSION_HANDLE session, bool isSource, int inFd, int outFd, uint32_t chunkSize,
+                              DTCPIP_FileStats *stats);
+
+#endif //__DTCPFILE_H_
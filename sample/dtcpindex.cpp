@@ -0,0 +1,141 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <mutex>
+#include <new>
+#include <string.h>
+#include <vector>
+#include "dtcpindex.h"
+
+struct DTCPIndex_s
+{
+	std::mutex           lock;
+	std::vector<uint8_t> entries;     /* Serialized as in the sidecar. */
+	bool                 incomplete;
+};
+
+static void putBe64(uint8_t *out, uint64_t value)
+{
+	for (int i = 7; i >= 0; i--)
+	{
+		out[i] = (uint8_t)value;
+		value >>= 8;
+	}
+}
+
+static uint64_t getBe64(const uint8_t *in)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		value = (value << 8) | in[i];
+	}
+	return value;
+}
+
+DTCPIndex *DTCPIndexCreate(void)
+{
+	return new (std::nothrow) DTCPIndex();
+}
+
+void DTCPIndexDestroy(DTCPIndex *index)
+{
+	delete index;
+}
+
+void DTCPIndexAdd(DTCPIndex *index, uint64_t offset, const uint8_t *header)
+{
+	uint8_t entry[DTCP_INDEX_ENTRY_SIZE];
+	putBe64(entry, offset);
+	memcpy(entry + 8, header, DTCPIP_PCP_HEADER_SIZE);
+
+	std::lock_guard<std::mutex> lock(index->lock);
+	try
+	{
+		index->entries.insert(index->entries.end(), entry, entry + sizeof(entry));
+	}
+	catch (const std::bad_alloc &)
+	{
+		index->incomplete = true;
+	}
+}
+
+dtcp_result_t DTCPIndexWrite(DTCPIndex *index, uint8_t *out, uint32_t size, uint32_t *length)
+{
+	std::lock_guard<std::mutex> lock(index->lock);
+	uint64_t needed = DTCP_INDEX_HEADER_SIZE + (uint64_t)index->entries.size();
+	if (index->incomplete || needed > UINT32_MAX)
+	{
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	*length = (uint32_t)needed;
+	if (out == NULL)
+	{
+		return DTCP_SUCCESS;
+	}
+	if (size < needed)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	uint32_t count = (uint32_t)(index->entries.size() / DTCP_INDEX_ENTRY_SIZE);
+	memcpy(out, DTCP_INDEX_MAGIC, 4);
+	out[4] = (uint8_t)(count >> 24);
+	out[5] = (uint8_t)(count >> 16);
+	out[6] = (uint8_t)(count >> 8);
+	out[7] = (uint8_t)count;
+	if (count > 0)
+	{
+		memcpy(out + DTCP_INDEX_HEADER_SIZE, &index->entries[0], index->entries.size());
+	}
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPIndexFind(const uint8_t *sidecar, uint32_t length, uint64_t offset, uint64_t *pcpOffset,
+                            const uint8_t **header)
+{
+	if (sidecar == NULL || length < DTCP_INDEX_HEADER_SIZE || memcmp(sidecar, DTCP_INDEX_MAGIC, 4) != 0)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	uint32_t count = ((uint32_t)sidecar[4] << 24) | ((uint32_t)sidecar[5] << 16) | ((uint32_t)sidecar[6] << 8) | sidecar[7];
+	const uint8_t *entries = sidecar + DTCP_INDEX_HEADER_SIZE;
+	if ((uint64_t)count * DTCP_INDEX_ENTRY_SIZE != length - DTCP_INDEX_HEADER_SIZE ||
+	    count == 0 || getBe64(entries) > offset)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	/* The last entry at or before offset. */
+	uint32_t low = 0;
+	uint32_t high = count;
+	while (high - low > 1)
+	{
+		uint32_t mid = low + (high - low) / 2;
+		if (getBe64(entries + (uint64_t)mid * DTCP_INDEX_ENTRY_SIZE) <= offset)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	*pcpOffset = getBe64(entries + (uint64_t)low * DTCP_INDEX_ENTRY_SIZE);
+	*header = entries + (uint64_t)low * DTCP_INDEX_ENTRY_SIZE + 8;
+	return DTCP_SUCCESS;
+}
@@ -0,0 +1,86 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpindex.h
+ * PCP index of the reference DTCP Manager.
+ *
+ * A PCP index lists where each PCP of a stream starts, so that a recording
+ * can be decrypted from any byte without reading it from the beginning. The
+ * index is a sidecar of fixed size entries, sorted by offset:
+ *
+ * Offset | Size | Field
+ * -------| -----| -----
+ * 0      | 4    | "DTPI"
+ * 4      | 4    | Number of entries, big endian
+ * 8      | 22   | Entry: offset of the PCP header in the stream (8, big endian), the PCP header (14)
+ *
+ * Carrying the header lets a sink start inside a PCP with a single read, and
+ * the fixed entry size lets a lookup bisect the sidecar as it is, so the time
+ * to a seek does not depend on the length of the recording.
+ */
+
+#ifndef __DTCPINDEX_H_
+#define __DTCPINDEX_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+
+#define DTCP_INDEX_MAGIC       "DTPI"
+#define DTCP_INDEX_HEADER_SIZE 8
+#define DTCP_INDEX_ENTRY_SIZE  (8 + DTCPIP_PCP_HEADER_SIZE)
+
+typedef struct DTCPIndex_s DTCPIndex;
+
+/**
+ * @brief Allocates an empty index.
+ *
+ * @return The index, or NULL on allocation failure.
+ */
+DTCPIndex *DTCPIndexCreate(void);
+
+void DTCPIndexDestroy(DTCPIndex *index);
+
+/**
+ * @brief Appends the PCP whose @a header starts at @a offset of the stream.
+ *
+ * Offsets must be increasing. If the entry cannot be stored the index is marked incomplete.
+ */
+void DTCPIndexAdd(DTCPIndex *index, uint64_t offset, const uint8_t *header);
+
+/**
+ * @brief Writes the sidecar of @a index to @a out, which holds @a size bytes.
+ *
+ * @a length receives the size of the sidecar; with @a out NULL nothing else is done.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a out is too small, DTCP_ERR_MEMORY_ALLOC if entries were lost.
+ */
+dtcp_result_t DTCPIndexWrite(DTCPIndex *index, uint8_t *out, uint32_t size, uint32_t *length);
+
+/**
+ * @brief Finds the PCP containing stream byte @a offset in the sidecar @a sidecar of @a length bytes.
+ *
+ * @a pcpOffset receives the offset of its header and @a header points to the header in the sidecar.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if the sidecar is malformed or @a offset comes before its first PCP.
+ */
+dtcp_result_t DTCPIndexFind(const uint8_t *sidecar, uint32_t length, uint64_t offset, uint64_t *pcpOffset,
+                            const uint8_t **header);
+
+#endif //__DTCPINDEX_H_
@@ -0,0 +1,228 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "dtcpake.h"
+#include "dtcpinit.h"
+#include "dtcplog.h"
+#include "dtcpsrm.h"
+#include "dtcpstats.h"
+
+typedef struct
+{
+	std::mutex              lock;
+	std::condition_variable doneCond;
+	std::atomic<bool>       done;
+	bool                    started;
+	dtcp_result_t           result;
+	std::vector<uint8_t>    srm;
+	std::string             cachePath;
+	uint64_t                deferredNs;
+	bool                    cacheHit;
+	std::atomic<uint64_t>   waitedNs;
+} initState;
+
+/* Never freed, like the worker pool: the thread may still be deriving tables while the process exits. */
+static initState *state = NULL;
+static std::once_flag stateOnce;
+
+static initState *getState(void)
+{
+	std::call_once(stateOnce, []()
+	{
+		state = new (std::nothrow) initState();
+		if (state != NULL)
+		{
+			state->done.store(true);
+			state->result = DTCP_SUCCESS;
+		}
+	});
+	return state;
+}
+
+/* Maps the index of @a srm from the cache file, or builds it and writes the file, and puts it in use. */
+static dtcp_result_t loadSrm(const uint8_t *srm, uint32_t length, const std::string &cachePath, bool *cacheHit)
+{
+	DTCPSrmIndex *index;
+	*cacheHit = false;
+	if (!cachePath.empty() && DTCPSrmIndexLoad(cachePath.c_str(), srm, length, &index) == DTCP_SUCCESS)
+	{
+		*cacheHit = true;
+		return DTCPSrmInstall(index);
+	}
+	dtcp_result_t ret = DTCPSrmIndexCreate(srm, length, true, &index);
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+	if (!cachePath.empty() && !DTCPSrmIndexSave(index, srm, length, cachePath.c_str()))
+	{
+		DTCP_LOG_WARN("Could not write the cache file %s\n", cachePath.c_str());
+	}
+	return DTCPSrmInstall(index);
+}
+
+static void deferredMain(void)
+{
+	uint64_t start = DTCPStatsNow();
+	bool cacheHit = false;
+	dtcp_result_t ret = DTCP_SUCCESS;
+
+	DTCPAkeDeviceId();
+	if (!state->srm.empty())
+	{
+		ret = loadSrm(&state->srm[0], (uint32_t)state->srm.size(), state->cachePath, &cacheHit);
+		if (ret != DTCP_SUCCESS)
+		{
+			DTCP_LOG_ERROR("Could not load the SRM: %d\n", ret);
+		}
+		std::vector<uint8_t>().swap(state->srm);
+	}
+
+	std::lock_guard<std::mutex> lock(state->lock);
+	state->result = ret;
+	state->cacheHit = cacheHit;
+	state->deferredNs = DTCPStatsNow() - start;
+	state->done.store(true, std::memory_order_release);
+	state->doneCond.notify_all();
+	DTCP_LOG_INFO("deferred initialization done in %llu us%s\n", (unsigned long long)(state->deferredNs / 1000),
+	              cacheHit ? ", tables mapped from the cache" : "");
+}
+
+/* Applies the settings of a re-initialization once the deferred part, started by the first, is done. */
+static dtcp_result_t reconfigure(const DTCPIP_Config *config)
+{
+	DTCPInitWait();
+	std::string cachePath;
+	{
+		std::lock_guard<std::mutex> lock(state->lock);
+		if (config != NULL && config->cachePath != NULL)
+		{
+			state->cachePath = config->cachePath;
+		}
+		cachePath = state->cachePath;
+	}
+	if (config == NULL || config->srm == NULL)
+	{
+		return DTCP_SUCCESS;
+	}
+	/* The same SRM again, the usual case, stays in use; see dtcpsrm.h for the version field. */
+	uint16_t inUse;
+	uint16_t version = (uint16_t)((config->srm[2] << 8) | config->srm[3]);
+	if (DTCPSrmVersion(&inUse) && inUse == version)
+	{
+		return DTCP_SUCCESS;
+	}
+	bool cacheHit;
+	dtcp_result_t ret = loadSrm(config->srm, config->srmLength, cachePath, &cacheHit);
+	if (ret == DTCP_SUCCESS)
+	{
+		/* An SRM is in use now, even if the one of the first initialization was malformed. */
+		std::lock_guard<std::mutex> lock(state->lock);
+		state->result = DTCP_SUCCESS;
+	}
+	return ret;
+}
+
+dtcp_result_t DTCPInitStart(const DTCPIP_Config *config)
+{
+	if (getState() == NULL)
+	{
+		return DTCP_ERR_GENERAL;
+	}
+	{
+		std::lock_guard<std::mutex> lock(state->lock);
+		if (!state->started)
+		{
+			try
+			{
+				if (config != NULL && config->srm != NULL)
+				{
+					state->srm.assign(config->srm, config->srm + config->srmLength);
+				}
+				if (config != NULL && config->cachePath != NULL)
+				{
+					state->cachePath = config->cachePath;
+				}
+				state->done.store(false);
+				std::thread(deferredMain).detach();
+			}
+			catch (const std::exception &)
+			{
+				state->done.store(true);
+				std::vector<uint8_t>().swap(state->srm);
+				return DTCP_ERR_GENERAL;
+			}
+			state->started = true;
+			return DTCP_SUCCESS;
+		}
+	}
+	return reconfigure(config);
+}
+
+dtcp_result_t DTCPInitWait(void)
+{
+	if (getState() == NULL)
+	{
+		return DTCP_SUCCESS;
+	}
+	if (!state->done.load(std::memory_order_acquire))
+	{
+		uint64_t start = DTCPStatsNow();
+		std::unique_lock<std::mutex> lock(state->lock);
+		state->doneCond.wait(lock, []() { return state->done.load(); });
+		state->waitedNs += DTCPStatsNow() - start;
+	}
+	return state->result;
+}
+
+dtcp_result_t DTCPInitUpdateSrm(const uint8_t *srm, uint32_t length)
+{
+	DTCPInitWait();
+	if (!DTCPSrmHeaderValid(srm, length))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	std::string cachePath;
+	if (state != NULL)
+	{
+		std::lock_guard<std::mutex> lock(state->lock);
+		cachePath = state->cachePath;
+	}
+	bool cacheHit;
+	return loadSrm(srm, length, cachePath, &cacheHit);
+}
+
+void DTCPInitGetStats(DTCPIP_InitStats *stats)
+{
+	if (getState() == NULL)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(state->lock);
+	stats->deferredNs = state->deferredNs;
+	stats->waitedNs = state->waitedNs.load();
+	stats->cacheHit = state->cacheHit ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpinit.h
+ * Deferred initialization of the reference DTCP Manager.
+ *
+ * DTCPMgrInitialize() runs during platform boot, on the path to first video,
+ * so it only does what cannot wait: checking the configuration and starting
+ * threads. Deriving the tables the AKE works from is left to a thread of its
+ * own, started from there once per process. The functions that need those
+ * tables wait for it on first use; once it is done they only test a flag.
+ *
+ * The derived tables are kept in a cache file (see dtcpsrm.h), so that a
+ * warm start maps them instead of deriving them again. In the reference the
+ * SRM index and the device ID are all there is; a licensed library would
+ * verify its certificate and precompute its elliptic curve tables here.
+ */
+
+#ifndef __DTCPINIT_H_
+#define __DTCPINIT_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+
+/**
+ * @brief Starts the deferred part of the initialization with the settings of @a config (may be NULL).
+ *
+ * Only the first call starts it. A later call, re-initializing after DTCPMgrStopSource(), waits for it
+ * and then takes the cache path of @a config and installs its SRM, unless that version is in use already.
+ * The SRM and the cache path are copied.
+ *
+ * @return DTCP_ERR_GENERAL if the thread or its state could not be allocated; on re-initialization,
+ * as DTCPSrmUpdate().
+ */
+dtcp_result_t DTCPInitStart(const DTCPIP_Config *config);
+
+/**
+ * @brief Waits for the deferred part, if started, and returns its result.
+ */
+dtcp_result_t DTCPInitWait(void);
+
+/**
+ * @brief Waits for the deferred part, then makes the SRM @a srm the one in use, updating the cache file.
+ *
+ * @return As DTCPSrmUpdate().
+ */
+dtcp_result_t DTCPInitUpdateSrm(const uint8_t *srm, uint32_t length);
+
+/**
+ * @brief Fills the deferred part's fields of @a stats; those of a part not done yet are 0.
+ */
+void DTCPInitGetStats(DTCPIP_InitStats *stats);
+
+#endif //__DTCPINIT_H_
@@ -0,0 +1,196 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string.h>
+#include <system_error>
+#include <thread>
+#include "dtcpkeyahead.h"
+#include "dtcplog.h"
+
+struct DTCPKeyAhead_s
+{
+	std::mutex     lock;
+	int            refs;                                   /* The session, and the queue while queued. */
+	bool           queued;
+	bool           ready;                                  /* key holds the requested key.          */
+	uint8_t        exchangeKey[DTCP_EXCHANGE_KEY_SIZE];    /* Requested key.                        */
+	uint8_t        emi;
+	uint64_t       nc;
+	DTCPContentKey key;
+};
+
+/* Never freed, so that the thread may outlive static destructors at exit. */
+typedef struct
+{
+	std::mutex                lock;
+	std::condition_variable   cond;
+	std::deque<DTCPKeyAhead*> pending;
+} keyQueue;
+
+static keyQueue *queue = NULL;
+
+static void unref(DTCPKeyAhead *ahead, std::unique_lock<std::mutex> &lock)
+{
+	bool last = (--ahead->refs == 0);
+	lock.unlock();
+	if (last)
+	{
+		memset(&ahead->key, 0, sizeof(ahead->key));
+		memset(ahead->exchangeKey, 0, sizeof(ahead->exchangeKey));
+		delete ahead;
+	}
+}
+
+/* Derives the requested key of @a ahead, again if the request changed meanwhile. */
+static void derive(DTCPKeyAhead *ahead)
+{
+	std::unique_lock<std::mutex> lock(ahead->lock);
+	while (ahead->refs > 1 && !ahead->ready)
+	{
+		uint8_t exchangeKey[DTCP_EXCHANGE_KEY_SIZE];
+		uint8_t emi = ahead->emi;
+		uint64_t nc = ahead->nc;
+		DTCPContentKey key;
+		memcpy(exchangeKey, ahead->exchangeKey, sizeof(exchangeKey));
+		lock.unlock();
+
+		key.valid = false;
+		DTCPPcpSelectContentKey(&key, exchangeKey, emi, nc);
+
+		lock.lock();
+		if (ahead->emi == emi && ahead->nc == nc && memcmp(ahead->exchangeKey, exchangeKey, sizeof(exchangeKey)) == 0)
+		{
+			ahead->key = key;
+			ahead->ready = true;
+		}
+		memset(&key, 0, sizeof(key));
+		memset(exchangeKey, 0, sizeof(exchangeKey));
+	}
+	ahead->queued = false;
+	unref(ahead, lock);
+}
+
+static void queueMain(void)
+{
+	std::unique_lock<std::mutex> lock(queue->lock);
+	for (;;)
+	{
+		queue->cond.wait(lock, []() { return !queue->pending.empty(); });
+		DTCPKeyAhead *ahead = queue->pending.front();
+		queue->pending.pop_front();
+		lock.unlock();
+		derive(ahead);
+		lock.lock();
+	}
+}
+
+/* Starts the thread on first use; returns false if it cannot run. */
+static bool startQueue(void)
+{
+	static std::mutex startLock;
+	static bool failed = false;
+	std::lock_guard<std::mutex> lock(startLock);
+	if (queue != NULL || failed)
+	{
+		return !failed;
+	}
+	keyQueue *created = new (std::nothrow) keyQueue();
+	if (created == NULL)
+	{
+		failed = true;
+		return false;
+	}
+	queue = created;
+	try
+	{
+		std::thread(queueMain).detach();
+	}
+	catch (const std::system_error &)
+	{
+		DTCP_LOG_WARN("DTCP Manager: no content key thread, Nc updates derive their key inline\n");
+		failed = true;
+		return false;
+	}
+	return true;
+}
+
+DTCPKeyAhead *DTCPKeyAheadCreate(void)
+{
+	if (!startQueue())
+	{
+		return NULL;
+	}
+	DTCPKeyAhead *ahead = new (std::nothrow) DTCPKeyAhead();
+	if (ahead != NULL)
+	{
+		ahead->refs = 1;
+	}
+	return ahead;
+}
+
+void DTCPKeyAheadDestroy(DTCPKeyAhead *ahead)
+{
+	if (ahead != NULL)
+	{
+		std::unique_lock<std::mutex> lock(ahead->lock);
+		unref(ahead, lock);
+	}
+}
+
+void DTCPKeyAheadRequest(DTCPKeyAhead *ahead, const uint8_t *exchangeKey, uint8_t emi, uint64_t nc)
+{
+	{
+		std::lock_guard<std::mutex> lock(ahead->lock);
+		bool same = ahead->emi == emi && ahead->nc == nc &&
+		            memcmp(ahead->exchangeKey, exchangeKey, DTCP_EXCHANGE_KEY_SIZE) == 0;
+		if (same && (ahead->ready || ahead->queued))
+		{
+			return;
+		}
+		memcpy(ahead->exchangeKey, exchangeKey, DTCP_EXCHANGE_KEY_SIZE);
+		ahead->emi = emi;
+		ahead->nc = nc;
+		ahead->ready = false;
+		if (ahead->queued)
+		{
+			/* The thread picks up the new request. */
+			return;
+		}
+		ahead->queued = true;
+		ahead->refs++;
+	}
+	std::lock_guard<std::mutex> lock(queue->lock);
+	queue->pending.push_back(ahead);
+	queue->cond.notify_one();
+}
+
+bool DTCPKeyAheadTake(DTCPKeyAhead *ahead, const uint8_t *exchangeKey, uint8_t emi, uint64_t nc, DTCPContentKey *key)
+{
+	std::lock_guard<std::mutex> lock(ahead->lock);
+	if (!ahead->ready || ahead->emi != emi || ahead->nc != nc ||
+	    memcmp(ahead->exchangeKey, exchangeKey, DTCP_EXCHANGE_KEY_SIZE) != 0)
+	{
+		return false;
+	}
+	*key = ahead->key;
+	return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+/**
+ * @file   dtcpkeyahead.h
+ * Content key precomputation of the reference DTCP Manager.
+ *
+ * A source session's content key changes whenever Nc is updated, and the
+ * derivation (the licensee's key ladder in a product build) would otherwise
+ * run inside the ProcessPacket call that opens the first PCP under the new
+ * Nc. Half way to the update the source asks for the key of the next Nc,
+ * which a background thread derives and expands into its key schedule; at
+ * the update the source copies the finished key instead of deriving it.
+ *
+ * A request only names the key wanted next. A source whose rotation comes
+ * before the key is ready, or whose EMI has changed, derives the key inline
+ * as before.
+ */
+
+#ifndef __DTCPKEYAHEAD_H_
+#define __DTCPKEYAHEAD_H_
+
+#include "dtcppcp.h"
+
+/**
+ * @brief Allocates the precomputed key slot of one source session.
+ *
+ * @return The slot, or NULL on allocation failure.
+ */
+DTCPKeyAhead *DTCPKeyAheadCreate(void);
+
+/**
+ * @brief Releases a slot; a derivation still running for it completes first, unseen.
+ */
+void DTCPKeyAheadDestroy(DTCPKeyAhead *ahead);
+
+/**
+ * @brief Asks for the content key for (@a emi, @a nc) under @a exchangeKey to be derived in the background.
+ *
+ * Replaces an earlier request. Does nothing if that key is already ready or on its way.
+ */
+void DTCPKeyAheadRequest(DTCPKeyAhead *ahead, const uint8_t *exchangeKey, uint8_t emi, uint64_t nc);
+
+/**
+ * @brief Copies the content key for (@a emi, @a nc) under @a exchangeKey to @a key if it is ready.
+ *
+ * @return false if it is not, and @a key is left unchanged.
+ */
+bool DTCPKeyAheadTake(DTCPKeyAhead *ahead, const uint8_t *exchangeKey, uint8_t emi, uint64_t nc, DTCPContentKey *key);
+
+#endif //__DTCPKEYAHEAD_H_
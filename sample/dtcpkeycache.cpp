@@ -0,0 +1,127 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <mutex>
+#include <string.h>
+#include "dtcpkeycache.h"
+#include "dtcplog.h"
+#include "dtcpsession.h"
+#include "dtcpstats.h"
+
+typedef struct
+{
+	bool       valid;
+	char       address[DTCP_REMOTE_IP_SIZE];
+	int        port;
+	DTCPAkeKey key;
+	uint64_t   expiresNs;
+	uint64_t   lastUsedNs;
+} cacheEntry;
+
+static std::mutex cacheLock;
+static cacheEntry cache[DTCP_KEY_CACHE_SIZE];
+
+static bool sameSource(const cacheEntry *entry, const char *address, int port)
+{
+	return entry->valid && entry->port == port && strcmp(entry->address, address) == 0;
+}
+
+static void dropEntry(cacheEntry *entry)
+{
+	memset(entry, 0, sizeof(*entry));
+}
+
+bool DTCPKeyCacheGet(const char *address, int port, DTCPAkeKey *key)
+{
+	if (address == NULL)
+	{
+		return false;
+	}
+	uint64_t now = DTCPStatsNow();
+	std::lock_guard<std::mutex> lock(cacheLock);
+	for (int i = 0; i < DTCP_KEY_CACHE_SIZE; i++)
+	{
+		cacheEntry *entry = &cache[i];
+		if (!sameSource(entry, address, port))
+		{
+			continue;
+		}
+		if (entry->expiresNs <= now)
+		{
+			DTCP_LOG_DEBUG("Exchange key %u of %s:%d expired\n", entry->key.label, address, port);
+			dropEntry(entry);
+			continue;
+		}
+		entry->lastUsedNs = now;
+		*key = entry->key;
+		return true;
+	}
+	return false;
+}
+
+void DTCPKeyCachePut(const char *address, int port, const DTCPAkeKey *key)
+{
+	if (address == NULL || strlen(address) >= DTCP_REMOTE_IP_SIZE || key->validitySec == 0)
+	{
+		return;
+	}
+	uint64_t now = DTCPStatsNow();
+	std::lock_guard<std::mutex> lock(cacheLock);
+	cacheEntry *slot = NULL;
+	for (int i = 0; i < DTCP_KEY_CACHE_SIZE; i++)
+	{
+		cacheEntry *entry = &cache[i];
+		if (sameSource(entry, address, port))
+		{
+			/* A source has one shared key at a time; another label means it has restarted. */
+			dropEntry(entry);
+		}
+		if (!entry->valid)
+		{
+			if (slot == NULL || slot->valid)
+			{
+				slot = entry;
+			}
+		}
+		else if (slot == NULL || (slot->valid && entry->lastUsedNs < slot->lastUsedNs))
+		{
+			slot = entry;
+		}
+	}
+	dropEntry(slot);
+	slot->valid = true;
+	strcpy(slot->address, address);
+	slot->port = port;
+	slot->key = *key;
+	slot->expiresNs = now + (uint64_t)key->validitySec * 1000000000;
+	slot->lastUsedNs = now;
+}
+
+void DTCPKeyCacheInvalidate(const char *address, int port, uint8_t label)
+{
+	std::lock_guard<std::mutex> lock(cacheLock);
+	for (int i = 0; i < DTCP_KEY_CACHE_SIZE; i++)
+	{
+		cacheEntry *entry = &cache[i];
+		if (sameSource(entry, address, port) && entry->key.label == label)
+		{
+			DTCP_LOG_DEBUG("Dropping exchange key %u of %s:%d\n", label, address, port);
+			dropEntry(entry);
+		}
+	}
+}
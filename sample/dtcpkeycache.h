@@ -0,0 +1,59 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpkeycache.h
+ * Sink exchange key cache of the reference DTCP Manager.
+ *
+ * Keeps the shared exchange key a sink obtained from each source, keyed by
+ * source address, port and key label, so that tuning to another stream of
+ * the same source skips the AKE. An entry is used until the validity the
+ * source gave the key runs out. It is dropped when a session decrypting with
+ * it meets another key label, which is how a restarted source shows itself,
+ * and replaced when an AKE with the same source returns a new label. Unique
+ * exchange keys belong to one session and are never cached.
+ */
+
+#ifndef __DTCPKEYCACHE_H_
+#define __DTCPKEYCACHE_H_
+
+#include "dtcpake.h"
+
+#define DTCP_KEY_CACHE_SIZE 16   /**< Sources remembered, least recently used is evicted. */
+
+/**
+ * @brief Looks up an unexpired exchange key for the source at @a address and @a port.
+ *
+ * @return false on a miss; @a address may be NULL.
+ */
+bool DTCPKeyCacheGet(const char *address, int port, DTCPAkeKey *key);
+
+/**
+ * @brief Stores the exchange key an AKE with the source at @a address and @a port returned.
+ *
+ * Entries of the same source with other labels are dropped.
+ */
+void DTCPKeyCachePut(const char *address, int port, const DTCPAkeKey *key);
+
+/**
+ * @brief Drops the entry for @a label of the source at @a address and @a port, if any.
+ */
+void DTCPKeyCacheInvalidate(const char *address, int port, uint8_t label);
+
+#endif //__DTCPKEYCACHE_H_
@@ -0,0 +1,217 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include "dtcplog.h"
+
+#define RING_MASK (DTCP_LOG_RING_SIZE - 1)
+
+/*
+ * Bounded multi-producer ring: a slot is free for the producer of ticket t
+ * when its sequence is t, and holds a message for the consumer when it is
+ * t + 1. The consumer hands it back for ticket t + DTCP_LOG_RING_SIZE.
+ */
+typedef struct
+{
+	std::atomic<uint64_t> sequence;
+	char text[DTCP_LOG_MESSAGE_SIZE];
+} logSlot;
+
+std::atomic<int> dtcpLogLevel(DTCP_LOG_INFO);
+
+static logSlot ring[DTCP_LOG_RING_SIZE];
+static std::atomic<uint64_t> enqueuePos(0);
+static std::atomic<uint64_t> dropped(0);
+static std::atomic<bool> asyncSink(false);
+static std::mutex drainLock;    /* Consumer side only. */
+static uint64_t dequeuePos = 0;
+static int wakeFd = -1;
+static std::atomic<bool> drainSleeping(false);   /* The drain thread found the ring empty and waits on wakeFd. */
+
+/* Writes out the queued messages; returns the number written. Called with drainLock held. */
+static uint32_t drainLocked(void)
+{
+	uint32_t written = 0;
+	for (;;)
+	{
+		logSlot *slot = &ring[dequeuePos & RING_MASK];
+		if (slot->sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+		{
+			break;
+		}
+		fputs(slot->text, stdout);
+		slot->sequence.store(dequeuePos + DTCP_LOG_RING_SIZE, std::memory_order_release);
+		dequeuePos++;
+		written++;
+	}
+	uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+	if (lost > 0)
+	{
+		printf("DTCP Manager: %llu log messages dropped\n", (unsigned long long)lost);
+	}
+	if (written > 0 || lost > 0)
+	{
+		fflush(stdout);
+	}
+	return written;
+}
+
+static uint32_t drain(void)
+{
+	std::lock_guard<std::mutex> lock(drainLock);
+	return drainLocked();
+}
+
+/*
+ * Sleeps while the ring is empty. The thread announces it is about to sleep
+ * and looks at the ring once more; a producer publishes its message and then
+ * looks at the announcement, so one of the two always sees the other.
+ */
+static void drainMain(void)
+{
+	for (;;)
+	{
+		if (drain() > 0)
+		{
+			continue;
+		}
+		drainSleeping.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (drain() == 0)
+		{
+			uint64_t count;
+			ssize_t got = read(wakeFd, &count, sizeof(count));
+			(void)got;
+		}
+		drainSleeping.store(false);
+	}
+}
+
+/* Wakes the drain thread if it sleeps, i.e. once each time the ring turns non-empty. */
+static void wakeDrain(void)
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (drainSleeping.load(std::memory_order_relaxed) && drainSleeping.exchange(false))
+	{
+		uint64_t one = 1;
+		ssize_t written = write(wakeFd, &one, sizeof(one));
+		(void)written;
+	}
+}
+
+static void drainAtExit(void)
+{
+	drain();
+}
+
+/* Returns false, leaving @a args unused, if the ring is full. */
+static bool enqueue(const char *format, va_list args)
+{
+	uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+	logSlot *slot;
+	for (;;)
+	{
+		slot = &ring[pos & RING_MASK];
+		int64_t diff = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)pos;
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false;
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+	vsnprintf(slot->text, sizeof(slot->text), format, args);
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	wakeDrain();
+	return true;
+}
+
+void DTCPLogWrite(int level, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	if (!asyncSink.load(std::memory_order_acquire))
+	{
+		vprintf(format, args);
+	}
+	else if (!enqueue(format, args))
+	{
+		if (level <= DTCP_LOG_ERROR)
+		{
+			/* Errors are not dropped: they are written directly, behind the messages queued before them. */
+			std::lock_guard<std::mutex> lock(drainLock);
+			drainLocked();
+			vprintf(format, args);
+			fflush(stdout);
+		}
+		else
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	va_end(args);
+}
+
+bool DTCPLogStartAsync(void)
+{
+	static std::mutex startLock;
+	std::lock_guard<std::mutex> lock(startLock);
+	if (asyncSink.load())
+	{
+		return true;
+	}
+	for (uint64_t i = 0; i < DTCP_LOG_RING_SIZE; i++)
+	{
+		ring[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	wakeFd = eventfd(0, EFD_CLOEXEC);
+	if (wakeFd < 0)
+	{
+		return false;
+	}
+	try
+	{
+		std::thread(drainMain).detach();
+	}
+	catch (const std::system_error &)
+	{
+		close(wakeFd);
+		wakeFd = -1;
+		return false;
+	}
+	atexit(drainAtExit);
+	asyncSink.store(true, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcplog.h
+ * Logging of the reference DTCP Manager.
+ *
+ * A message is compiled in only if its level is at most DTCP_LOG_MAX_LEVEL
+ * (configure --with-log-level), and written only if it is at most the
+ * runtime level set by DTCPMgrSetLogLevel(). A message that is compiled in
+ * but disabled costs one relaxed load and one well-predicted branch; its
+ * arguments are not evaluated.
+ *
+ * Messages go to stdout, either directly or, with the asynchronous sink,
+ * through a lock-free ring drained by a background thread, which sleeps on
+ * an eventfd while the ring is empty and is woken by the message that ends
+ * that. A producer never blocks on the ring: when it is full the message is
+ * dropped and counted.
+ * Errors are the exception; they are written directly, behind the queued
+ * messages, rather than lost.
+ */
+
+#ifndef __DTCPLOG_H_
+#define __DTCPLOG_H_
+
+#include <atomic>
+#include "dtcpmgr.h"
+
+#ifndef DTCP_LOG_MAX_LEVEL
+#define DTCP_LOG_MAX_LEVEL DTCP_LOG_TRACE
+#endif
+
+#define DTCP_LOG_RING_SIZE    1024  /**< Messages held by the asynchronous sink, a power of two. */
+#define DTCP_LOG_MESSAGE_SIZE 256   /**< Longer messages are truncated.                         */
+
+extern std::atomic<int> dtcpLogLevel;
+
+static inline bool DTCPLogEnabled(int level)
+{
+	return __builtin_expect(level <= dtcpLogLevel.load(std::memory_order_relaxed), 0);
+}
+
+void DTCPLogWrite(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Routes messages through the ring and starts the thread draining it.
+ *
+ * @return false if the thread could not be started; messages are then still written directly.
+ */
+bool DTCPLogStartAsync(void);
+
+#define DTCP_LOG(level, ...)                                        \
+	do                                                              \
+	{                                                               \
+		if ((level) <= DTCP_LOG_MAX_LEVEL && DTCPLogEnabled(level)) \
+		{                                                           \
+			DTCPLogWrite((level), __VA_ARGS__);                     \
+		}                                                           \
+	} while (0)
+
+#define DTCP_LOG_ERROR(...) DTCP_LOG(DTCP_LOG_ERROR, __VA_ARGS__)
+#define DTCP_LOG_WARN(...)  DTCP_LOG(DTCP_LOG_WARN, __VA_ARGS__)
+#define DTCP_LOG_INFO(...)  DTCP_LOG(DTCP_LOG_INFO, __VA_ARGS__)
+#define DTCP_LOG_DEBUG(...) DTCP_LOG(DTCP_LOG_DEBUG, __VA_ARGS__)
+#define DTCP_LOG_TRACE(...) DTCP_LOG(DTCP_LOG_TRACE, __VA_ARGS__)
+
+/** Traces entry to an API function. */
+#define DTCP_LOG_ENTRY() DTCP_LOG_TRACE("Entered function %s\n", __PRETTY_FUNCTION__)
+
+#endif //__DTCPLOG_H_
@@ -16,51 +16,155 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
 */
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "dtcpmgr.h"
+#include "dtcpake.h"
+#include "dtcpfile.h"
+#include "dtcpindex.h"
+#include "dtcpinit.h"
+#include "dtcpkeyahead.h"
+#include "dtcpkeycache.h"
+#include "dtcplog.h"
+#include "dtcpsession.h"
+#include "dtcpshared.h"
+#include "dtcpsrm.h"
+#include "dtcpstats.h"
+#include "dtcpstrand.h"
+#include "dtcpworker.h"
+
+#define DTCP_BATCH_RUN 64   /* Packets of one session processed per pool reservation in DTCPMgrProcessPacketV(). */
 
 static int started = 0;
-static int initialized = 0;
-typedef struct
+static int initialized = 0;             /* Guarded by initLock. */
+static std::mutex initLock;
+static uint64_t initializeNs = 0;
+
+static dtcp_result_t createSessionPools(sessionHandle* locHandle, int maxPacketSize)
 {
-	int id;
-}sessionHandle;
+	/* Room for the carried tail, and the AES padding a source adds, on top of a full buffer. */
+	uint32_t bufferSize = (maxPacketSize > 0) ? (uint32_t)maxPacketSize : DTCP_POOL_DEFAULT_SIZE;
+	bufferSize += 2 * DTCP_AES_BLOCK_SIZE;
+	locHandle->dataPool = DTCPPoolCreate(bufferSize);
+	locHandle->headerPool = DTCPPoolCreate(DTCP_PCP_HEADER_SIZE);
+	if (locHandle->dataPool == NULL || locHandle->headerPool == NULL)
+	{
+		DTCPPoolDestroy(locHandle->dataPool);
+		DTCPPoolDestroy(locHandle->headerPool);
+		DTCPSessionFree(locHandle);
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	return DTCP_SUCCESS;
+}
+
 
+static void setRemoteIp(sessionHandle* locHandle, const char *ipAddress)
+{
+	if (ipAddress != NULL)
+	{
+		strncpy(locHandle->remoteIp, ipAddress, sizeof(locHandle->remoteIp) - 1);
+	}
+}
 
 dtcp_result_t DTCPMgrInitialize(void)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
+	return DTCPMgrInitializeEx(NULL);
+}
+
+dtcp_result_t DTCPMgrInitializeEx(const DTCPIP_Config *config)
+{
+	DTCP_LOG_ENTRY();
+	if (config != NULL && config->numWorkers > DTCP_MAX_WORKERS)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	std::lock_guard<std::mutex> lock(initLock);
 	if (initialized == 0)
 	{
-		printf("initialized Manager\n");
+		uint64_t start = DTCPStatsNow();
+		if (config != NULL && config->srm != NULL && !DTCPSrmHeaderValid(config->srm, config->srmLength))
+		{
+			DTCP_LOG_ERROR("Malformed SRM header\n");
+			return DTCP_ERR_INVALID_PARAM;
+		}
+		if (config != NULL && config->numWorkers > 0 && DTCPWorkerCount() == 0 &&
+		    !DTCPWorkerStart(config->numWorkers))
+		{
+			return DTCP_ERR_GENERAL;
+		}
+		if (config != NULL && config->asyncLog && !DTCPLogStartAsync())
+		{
+			DTCP_LOG_WARN("Could not start the log thread, logging synchronously\n");
+		}
+		/* The SRM index and the other derived tables follow in the background; see dtcpinit.h. */
+		dtcp_result_t ret = DTCPInitStart(config);
+		if (ret != DTCP_SUCCESS)
+		{
+			return ret;
+		}
+		if (initializeNs == 0)
+		{
+			initializeNs = DTCPStatsNow() - start;
+		}
+		DTCP_LOG_INFO("initialized Manager in %llu us, AES engine: %s, workers: %u\n",
+		              (unsigned long long)((DTCPStatsNow() - start) / 1000), DTCPAesEngineName(), DTCPWorkerCount());
 		initialized = 1;
 	}
 	else
 	{
-		printf("Already initialized\n");
+		DTCP_LOG_DEBUG("Already initialized\n");
 	}
 	return DTCP_SUCCESS;
 }
 	
+dtcp_result_t DTCPMgrWaitInitialized(DTCPIP_InitStats *stats)
+{
+	DTCP_LOG_ENTRY();
+	dtcp_result_t ret = DTCPInitWait();
+	if (stats != NULL)
+	{
+		memset(stats, 0, sizeof(*stats));
+		DTCPInitGetStats(stats);
+		stats->initializeNs = initializeNs;
+	}
+	return ret;
+}
+
+dtcp_result_t DTCPMgrUpdateSRM(const uint8_t *srm, uint32_t length)
+{
+	DTCP_LOG_ENTRY();
+	return DTCPInitUpdateSrm(srm, length);
+}
+
 dtcp_result_t DTCPMgrStartSource(char* ifName, int portNum)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	printf("invoked start source with IFNAME: %s , port number: %d\n",ifName,portNum);
-	return DTCP_SUCCESS;
+	DTCP_LOG_ENTRY();
+	DTCP_LOG_INFO("invoked start source with IFNAME: %s , port number: %d\n",ifName,portNum);
+	dtcp_result_t ret = DTCPInitWait();
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+	return DTCPAkeListen(ifName, portNum);
 }
 
 dtcp_result_t DTCPMgrStopSource(void)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
+	DTCP_LOG_ENTRY();
+	DTCPAkeStop();
+	std::lock_guard<std::mutex> lock(initLock);
 	if (initialized == 1)
 	{
-		printf("stopped DTCP Manager\n");
+		DTCP_LOG_INFO("stopped DTCP Manager\n");
 		initialized = 0;
 	}
 	else
 	{
-		printf ("Already stopped\n");
+		DTCP_LOG_DEBUG("Already stopped\n");
 	}
 	return DTCP_SUCCESS;
 }
@@ -72,15 +176,59 @@ dtcp_result_t DTCPMgrCreateSourceSession(char *sinkIpAddress,
                                          int maxPacketSize, 
                                          DTCP_SESSION_HANDLE *handle) 
 { 
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	printf("invoked create source session with sinkIP: %s ; key label: %d,PCPPacketSize = %d, MaxPAcketSize = %d\n", 
+	DTCP_LOG_ENTRY();
+	DTCP_LOG_INFO("invoked create source session with sinkIP: %s ; key label: %d,PCPPacketSize = %d, MaxPAcketSize = %d\n", 
 		sinkIpAddress,
 		key_label,
 		PCPPacketSize,
 		maxPacketSize);
-	sessionHandle* lochandle = new sessionHandle;
-	lochandle->id = 1;
-	handle = (DTCP_SESSION_HANDLE*)(lochandle);
+	if (handle == NULL || (PCPPacketSize < 0 && PCPPacketSize != DTCPIP_PCP_SIZE_ADAPTIVE) ||
+	    PCPPacketSize > DTCP_PCP_MAX_CONTENT)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	if (key_label > 0xFF)
+	{
+		return DTCP_ERR_INVALID_KEY_LABEL;
+	}
+	uint64_t start = DTCPStatsNow();
+	uint8_t akeLabel;
+	uint8_t exchangeKey[DTCP_EXCHANGE_KEY_SIZE];
+	/* Without a started source there is no AKE, and the session uses the reference key of its label. */
+	dtcp_result_t keyResult = DTCPAkeSourceKey(key_label, &akeLabel, exchangeKey);
+	if (keyResult == DTCP_ERR_INVALID_KEY_LABEL)
+	{
+		return keyResult;
+	}
+	sessionHandle* lochandle = DTCPSessionAlloc();
+	if (lochandle == NULL)
+	{
+		return DTCP_ERR_OUT_OF_SESSIONS;
+	}
+	lochandle->type = DTCP_SOURCE;
+	setRemoteIp(lochandle, sinkIpAddress);
+	lochandle->maxPacketSize = maxPacketSize;
+	if (createSessionPools(lochandle, maxPacketSize) != DTCP_SUCCESS)
+	{
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	/* Without a slot, NULL if allocation fails, Nc updates derive the content key inline. */
+	if (!DTCPPcpSourceInit(&lochandle->source, (key_label < 0) ? DTCP_DEFAULT_KEY_LABEL : (uint8_t)key_label,
+	                       PCPPacketSize, DTCPKeyAheadCreate()))
+	{
+		DTCPKeyAheadDestroy(lochandle->source.ahead);
+		DTCPPoolDestroy(lochandle->dataPool);
+		DTCPPoolDestroy(lochandle->headerPool);
+		DTCPSessionFree(lochandle);
+		return DTCP_ERR_GENERAL;
+	}
+	if (keyResult == DTCP_SUCCESS)
+	{
+		DTCPPcpSourceSetExchangeKey(&lochandle->source, akeLabel, exchangeKey);
+	}
+	memset(exchangeKey, 0, sizeof(exchangeKey));
+	DTCPStatsRecordAke(lochandle->stats, DTCPStatsNow() - start);
+	*handle = DTCPSessionPublish(lochandle);
 	return DTCP_SUCCESS;
 }
 
@@ -90,61 +238,901 @@ dtcp_result_t DTCPMgrCreateSinkSession(char *srcIpAddress,
                                        int maxPacketSize, 
                                        DTCP_SESSION_HANDLE *handle)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	printf("invoked create sink session with srcIP: %s ; srcIpPort: %d,uniqueKey = %c, MaxPAcketSize = %d\n", 
+	DTCP_LOG_ENTRY();
+	DTCP_LOG_INFO("invoked create sink session with srcIP: %s ; srcIpPort: %d,uniqueKey = %c, MaxPAcketSize = %d\n", 
 		srcIpAddress,
 		srcIpPort,
 		uniqueKey,
 		maxPacketSize);
-	sessionHandle* lochandle = new sessionHandle;
-	lochandle->id = 2;
-	handle = (DTCP_SESSION_HANDLE*)lochandle;
+	if (handle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCPInitWait();
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+	uint64_t start = DTCPStatsNow();
+	DTCPAkeKey akeKey;
+	bool cached = srcIpPort > 0 && !uniqueKey && DTCPKeyCacheGet(srcIpAddress, srcIpPort, &akeKey);
+	if (cached && DTCPSrmRevoked(akeKey.deviceId))
+	{
+		/* Revoked by an SRM update since the key was cached; the AKE refuses the source. */
+		DTCPKeyCacheInvalidate(srcIpAddress, srcIpPort, akeKey.label);
+		cached = false;
+	}
+	if (srcIpPort > 0 && !cached)
+	{
+		dtcp_result_t result = DTCPAkeExchange(srcIpAddress, srcIpPort, uniqueKey != 0, &akeKey);
+		if (result != DTCP_SUCCESS)
+		{
+			return result;
+		}
+		if (!uniqueKey)
+		{
+			DTCPKeyCachePut(srcIpAddress, srcIpPort, &akeKey);
+		}
+	}
+	sessionHandle* lochandle = DTCPSessionAlloc();
+	if (lochandle == NULL)
+	{
+		return DTCP_ERR_OUT_OF_SESSIONS;
+	}
+	lochandle->type = DTCP_SINK;
+	lochandle->uniqueKey = uniqueKey;
+	lochandle->remotePort = srcIpPort;
+	setRemoteIp(lochandle, srcIpAddress);
+	lochandle->maxPacketSize = maxPacketSize;
+	if (createSessionPools(lochandle, maxPacketSize) != DTCP_SUCCESS)
+	{
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	DTCPPcpSinkInit(&lochandle->sink);
+	if (srcIpPort > 0)
+	{
+		DTCPPcpSinkSetExchangeKey(&lochandle->sink, akeKey.label, akeKey.key);
+		memset(&akeKey, 0, sizeof(akeKey));
+	}
+	DTCPStatsRecordAke(lochandle->stats, DTCPStatsNow() - start);
+	*handle = DTCPSessionPublish(lochandle);
+	return DTCP_SUCCESS;
+}
+
+
+static uint32_t outputSize(sessionHandle* locHandle, const DTCPPcpSource *source, const DTCPPcpSink *sink,
+                           uint32_t dataLength, BOOLEAN isEOF)
+{
+	if (locHandle->type == DTCP_SOURCE)
+	{
+		return DTCPPcpSourceMaxOutput(source, dataLength, isEOF);
+	}
+	return DTCPPcpSinkMaxOutput(sink, dataLength);
+}
+
+/* Processes a packet on the given source or sink state: the session's own, or that of a submitted packet. */
+static dtcp_result_t processState(sessionHandle* locHandle, DTCPPcpSource *source, DTCPPcpSink *sink,
+                                 DTCPIP_Packet *packet, const DTCPIP_OutputBuffer *output, uint8_t **reserved)
+{
+	if (packet == NULL || (packet->dataInPtr == NULL && packet->dataLength > 0) || DTCPSharedRefuses(locHandle))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	if (locHandle->maxPacketSize > 0 && packet->dataLength > (uint32_t)locHandle->maxPacketSize)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	DTCPOutputMode mode = (output != NULL) ? output->mode : DTCP_OUTPUT_ALLOCATED;
+	uint32_t needed = outputSize(locHandle, source, sink, packet->dataLength, packet->isEOF);
+	uint8_t *out = NULL;
+	uint8_t *outPhy = NULL;
+	switch (mode)
+	{
+		case DTCP_OUTPUT_ALLOCATED:
+			break;
+		case DTCP_OUTPUT_IN_PLACE:
+			out = packet->dataInPtr;
+			outPhy = packet->dataInPhyPtr;
+			break;
+		case DTCP_OUTPUT_CALLER:
+			out = output->dataPtr;
+			outPhy = output->dataPhyPtr;
+			break;
+		default:
+			return DTCP_ERR_INVALID_PARAM;
+	}
+	if (mode != DTCP_OUTPUT_ALLOCATED)
+	{
+		if ((out == NULL && needed > 0) || output->capacity < needed ||
+		    (locHandle->type == DTCP_SOURCE && output->headerPtr == NULL))
+		{
+			return DTCP_ERR_INVALID_PARAM;
+		}
+	}
+	else if (reserved != NULL && *reserved != NULL && needed <= DTCPPoolBufferSize(locHandle->dataPool))
+	{
+		/* A buffer the batch took from the pool beforehand. */
+		out = *reserved;
+		*reserved = NULL;
+	}
+	else
+	{
+		out = DTCPPoolGet(locHandle->dataPool, needed);
+		if (out == NULL)
+		{
+			return DTCP_ERR_MEMORY_ALLOC;
+		}
+	}
+	packet->dataOutPtr = out;
+	packet->dataOutPhyPtr = outPhy;
+	packet->pcpHeader = NULL;
+	packet->pcpHeaderLength = 0;
+	packet->pcpHeaderOffset = -1;
+
+	dtcp_result_t ret;
+	uint32_t outLength = 0;
+	if (locHandle->type == DTCP_SOURCE)
+	{
+		uint8_t localHeader[DTCP_PCP_HEADER_SIZE];
+		uint8_t *header = (mode == DTCP_OUTPUT_ALLOCATED) ? localHeader : output->headerPtr;
+		int headerOffset = -1;
+		ret = DTCPPcpSourceProcess(source, (uint8_t)packet->emi, packet->dataInPtr, packet->dataLength,
+		                           packet->isEOF, out, &outLength, header, &headerOffset);
+		if (ret == DTCP_SUCCESS && headerOffset >= 0)
+		{
+			if (mode == DTCP_OUTPUT_ALLOCATED)
+			{
+				header = DTCPPoolGet(locHandle->headerPool, DTCP_PCP_HEADER_SIZE);
+				if (header == NULL)
+				{
+					ret = DTCP_ERR_MEMORY_ALLOC;
+				}
+				else
+				{
+					memcpy(header, localHeader, DTCP_PCP_HEADER_SIZE);
+				}
+			}
+			if (ret == DTCP_SUCCESS)
+			{
+				packet->pcpHeader = header;
+				packet->pcpHeaderLength = DTCP_PCP_HEADER_SIZE;
+				packet->pcpHeaderOffset = headerOffset;
+			}
+		}
+	}
+	else
+	{
+		ret = DTCPPcpSinkProcess(sink, packet->dataInPtr, packet->dataLength,
+		                         out, &outLength, &packet->emi);
+	}
+	if (ret != DTCP_SUCCESS)
+	{
+		if (mode == DTCP_OUTPUT_ALLOCATED)
+		{
+			DTCPMgrReleasePacket(packet);
+		}
+		packet->dataOutPtr = NULL;
+		packet->dataOutPhyPtr = NULL;
+		packet->pcpHeader = NULL;
+		packet->pcpHeaderLength = 0;
+		packet->pcpHeaderOffset = -1;
+		return ret;
+	}
+	packet->dataLength = outLength;
 	return DTCP_SUCCESS;
 }
 
+static void checkKeyLabel(sessionHandle* locHandle, const DTCPPcpSink *sink, dtcp_result_t ret)
+{
+	if (ret == DTCP_ERR_INVALID_KEY_LABEL && locHandle->type == DTCP_SINK && locHandle->remotePort > 0 &&
+	    !locHandle->uniqueKey)
+	{
+		/* The source no longer uses the key this session got, most likely it restarted. */
+		DTCPKeyCacheInvalidate(locHandle->remoteIp, locHandle->remotePort, sink->keyLabel);
+	}
+}
+
+/* Processes @a packet on the given state and records it in the session's statistics. */
+static dtcp_result_t processPacketOn(sessionHandle* locHandle, DTCPPcpSource *source, DTCPPcpSink *sink,
+                                    DTCPIP_Packet *packet, const DTCPIP_OutputBuffer *output)
+{
+	bool isSource = (locHandle->type == DTCP_SOURCE);
+	uint64_t pcps = isSource ? source->pcps : sink->pcps;
+	uint64_t ncRotations = isSource ? source->ncRotations : sink->ncRotations;
+	uint32_t bytesIn = (packet != NULL) ? packet->dataLength : 0;
+	uint64_t start = DTCPStatsNow();
+
+	dtcp_result_t ret = processState(locHandle, source, sink, packet, output, NULL);
+	uint64_t elapsed = DTCPStatsNow() - start;
+	checkKeyLabel(locHandle, sink, ret);
+	pcps = (isSource ? source->pcps : sink->pcps) - pcps;
+	ncRotations = (isSource ? source->ncRotations : sink->ncRotations) - ncRotations;
+	DTCPStatsRecordPacket(locHandle->stats, ret == DTCP_SUCCESS, bytesIn,
+	                      (ret == DTCP_SUCCESS) ? packet->dataLength + packet->pcpHeaderLength : 0,
+	                      pcps, ncRotations, elapsed);
+	return ret;
+}
+
+static dtcp_result_t processSubmitted(sessionHandle* locHandle, DTCPPcpSource *source, DTCPPcpSink *sink, DTCPIP_Packet *packet)
+{
+	return processPacketOn(locHandle, source, sink, packet, NULL);
+}
+
+/* Synchronous processing first waits for packets submitted to the worker pool. */
+static void syncSession(sessionHandle* locHandle)
+{
+	DTCPStrand *strand = __atomic_load_n(&locHandle->strand, __ATOMIC_ACQUIRE);
+	if (strand != NULL)
+	{
+		DTCPStrandSync(strand);
+	}
+}
+
+static dtcp_result_t processPacket(sessionHandle* locHandle, DTCPIP_Packet *packet, const DTCPIP_OutputBuffer *output)
+{
+	syncSession(locHandle);
+	return processPacketOn(locHandle, &locHandle->source, &locHandle->sink, packet, output);
+}
 
 dtcp_result_t DTCPMgrProcessPacket(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	sessionHandle* locHandle = (sessionHandle*)&session;
-	printf("Enetered with sessionId = %d\n",locHandle->id);
+	DTCP_LOG_ENTRY();
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	DTCP_LOG_TRACE("Enetered with sessionId = %d\n",locHandle->id);
+	dtcp_result_t ret = processPacket(locHandle, packet, NULL);
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrGetOutputSize(DTCP_SESSION_HANDLE session, uint32_t dataLength, BOOLEAN isEOF, uint32_t *outputSize)
+{
+	DTCP_LOG_ENTRY();
+	if (outputSize == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	syncSession(locHandle);
+	*outputSize = ::outputSize(locHandle, &locHandle->source, &locHandle->sink, dataLength, isEOF);
+	DTCPSessionRelease(locHandle);
 	return DTCP_SUCCESS;
 }
 
+dtcp_result_t DTCPMgrProcessPacketEx(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet, const DTCPIP_OutputBuffer *output)
+{
+	DTCP_LOG_ENTRY();
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = processPacket(locHandle, packet, output);
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+/*
+ * The strand is created on first use, by the submitting thread or by one waiting for completions,
+ * whichever comes first; a thread losing the race destroys its own and takes the published one.
+ */
+static DTCPStrand *sessionStrand(sessionHandle* locHandle)
+{
+	DTCPStrand *strand = __atomic_load_n(&locHandle->strand, __ATOMIC_ACQUIRE);
+	if (strand != NULL)
+	{
+		return strand;
+	}
+	DTCPStrand *created = DTCPStrandCreate(locHandle, processSubmitted);
+	if (created == NULL)
+	{
+		return NULL;
+	}
+	if (!__atomic_compare_exchange_n(&locHandle->strand, &strand, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		DTCPStrandDestroy(created);
+		return strand;
+	}
+	return created;
+}
+
+static dtcp_result_t submitPacket(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet, DTCPIP_CompletionCallback callback,
+                                  void *userData, bool wait)
+{
+	if (packet == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_ERR_MEMORY_ALLOC;
+	DTCPStrand *strand = sessionStrand(locHandle);
+	if (strand != NULL)
+	{
+		ret = DTCPStrandSubmit(strand, packet, callback, userData, wait);
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrSubmitPacket(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet)
+{
+	DTCP_LOG_ENTRY();
+	return submitPacket(session, packet, NULL, NULL, true);
+}
+
+dtcp_result_t DTCPMgrProcessPacketAsync(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet,
+                                        DTCPIP_CompletionCallback callback, void *userData)
+{
+	DTCP_LOG_ENTRY();
+	return submitPacket(session, packet, callback, userData, false);
+}
+
+dtcp_result_t DTCPMgrGetCompletionFd(DTCP_SESSION_HANDLE session, int *fd)
+{
+	DTCP_LOG_ENTRY();
+	if (fd == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_ERR_MEMORY_ALLOC;
+	DTCPStrand *strand = sessionStrand(locHandle);
+	if (strand != NULL)
+	{
+		*fd = DTCPStrandEventFd(strand);
+		ret = DTCP_SUCCESS;
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrCompletePacket(DTCP_SESSION_HANDLE session, int timeoutMs, DTCPIP_Packet **packet, dtcp_result_t *result)
+{
+	DTCP_LOG_ENTRY();
+	if (packet == NULL || result == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	/* Nothing is outstanding without a strand, but a waiting thread may see the first submission. */
+	dtcp_result_t ret = DTCP_ERR_TIMEOUT;
+	DTCPStrand *strand = sessionStrand(locHandle);
+	if (strand != NULL)
+	{
+		ret = DTCPStrandComplete(strand, timeoutMs, packet, result);
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+/*
+ * Processes a run of packets of one session with the per-call work done once for the run: one wait for
+ * submitted packets, one pair of clock reads, one pool lock for the output buffers and one statistics update.
+ */
+static void processRun(sessionHandle* locHandle, DTCPIP_Packet *packets, uint32_t count, dtcp_result_t *results)
+{
+	bool isSource = (locHandle->type == DTCP_SOURCE);
+	DTCPPcpSource *source = &locHandle->source;
+	DTCPPcpSink *sink = &locHandle->sink;
+	uint8_t *reserved[DTCP_BATCH_RUN];
+	uint64_t bytesIn = 0;
+	uint64_t bytesOut = 0;
+	uint32_t done = 0;
+
+	syncSession(locHandle);
+	uint64_t pcps = isSource ? source->pcps : sink->pcps;
+	uint64_t ncRotations = isSource ? source->ncRotations : sink->ncRotations;
+	uint64_t start = DTCPStatsNow();
+	uint32_t numReserved = DTCPPoolGetBatch(locHandle->dataPool, reserved, count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint8_t *buffer = (i < numReserved) ? reserved[i] : NULL;
+		uint32_t length = packets[i].dataLength;
+		results[i] = processState(locHandle, source, sink, &packets[i], NULL, &buffer);
+		if (buffer != NULL)
+		{
+			DTCPPoolPut(buffer);
+		}
+		if (results[i] == DTCP_SUCCESS)
+		{
+			done++;
+			bytesIn += length;
+			bytesOut += packets[i].dataLength + packets[i].pcpHeaderLength;
+		}
+		checkKeyLabel(locHandle, sink, results[i]);
+	}
+	uint64_t elapsed = DTCPStatsNow() - start;
+	pcps = (isSource ? source->pcps : sink->pcps) - pcps;
+	ncRotations = (isSource ? source->ncRotations : sink->ncRotations) - ncRotations;
+	DTCPStatsRecordBatch(locHandle->stats, done, count - done, bytesIn, bytesOut, pcps, ncRotations, elapsed);
+}
+
+dtcp_result_t DTCPMgrProcessPacketV(DTCPIP_Packet *packets, uint32_t numPackets, dtcp_result_t *results)
+{
+	DTCP_LOG_ENTRY();
+	if (packets == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_SUCCESS;
+	uint32_t i = 0;
+	while (i < numPackets)
+	{
+		/* Resolve the session once for each run of packets belonging to it. */
+		DTCP_SESSION_HANDLE session = packets[i].session;
+		sessionHandle* locHandle = DTCPSessionAcquire(session);
+		uint32_t end = i + 1;
+		while (end < numPackets && packets[end].session == session)
+		{
+			end++;
+		}
+		while (i < end)
+		{
+			dtcp_result_t runResults[DTCP_BATCH_RUN];
+			uint32_t count = std::min(end - i, (uint32_t)DTCP_BATCH_RUN);
+			if (locHandle != NULL)
+			{
+				processRun(locHandle, &packets[i], count, runResults);
+			}
+			for (uint32_t j = 0; j < count; j++, i++)
+			{
+				dtcp_result_t result = (locHandle == NULL) ? DTCP_ERR_INVALID_PARAM : runResults[j];
+				if (results != NULL)
+				{
+					results[i] = result;
+				}
+				if (result != DTCP_SUCCESS && ret == DTCP_SUCCESS)
+				{
+					ret = result;
+				}
+			}
+		}
+		if (locHandle != NULL)
+		{
+			DTCPSessionRelease(locHandle);
+		}
+	}
+	DTCP_LOG_TRACE("Processed %u packets, result = %d\n", numPackets, ret);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrCreateSharedStream(int key_label, int PCPPacketSize, int maxPacketSize, DTCP_SESSION_HANDLE *handle)
+{
+	DTCP_LOG_ENTRY();
+	if (handle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	DTCP_SESSION_HANDLE stream;
+	dtcp_result_t ret = DTCPMgrCreateSourceSession((char *)"", key_label, PCPPacketSize, maxPacketSize, &stream);
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(stream);
+	if (locHandle == NULL)
+	{
+		DTCPSessionDelete(stream);
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	locHandle->shared = DTCPSharedCreate();
+	ret = (locHandle->shared != NULL) ? DTCP_SUCCESS : DTCP_ERR_MEMORY_ALLOC;
+	DTCPSessionRelease(locHandle);
+	if (ret != DTCP_SUCCESS)
+	{
+		DTCPSessionDelete(stream);
+		return ret;
+	}
+	*handle = stream;
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPMgrJoinSharedStream(DTCP_SESSION_HANDLE stream, DTCP_SESSION_HANDLE session)
+{
+	DTCP_LOG_ENTRY();
+	sessionHandle* streamHandle = DTCPSessionAcquire(stream);
+	sessionHandle* locHandle = (stream != session) ? DTCPSessionAcquire(session) : NULL;
+	dtcp_result_t ret = DTCP_ERR_INVALID_PARAM;
+	if (streamHandle != NULL && locHandle != NULL)
+	{
+		ret = DTCPSharedJoin(streamHandle, stream, locHandle, session);
+	}
+	if (locHandle != NULL)
+	{
+		DTCPSessionRelease(locHandle);
+	}
+	if (streamHandle != NULL)
+	{
+		DTCPSessionRelease(streamHandle);
+	}
+	return ret;
+}
+
+dtcp_result_t DTCPMgrLeaveSharedStream(DTCP_SESSION_HANDLE session)
+{
+	DTCP_LOG_ENTRY();
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCPSharedLeave(locHandle, session);
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+static dtcp_result_t encryptShared(sessionHandle* locHandle, DTCPIP_Packet *packet)
+{
+	return processPacket(locHandle, packet, NULL);
+}
+
+dtcp_result_t DTCPMgrProcessSharedPacket(DTCP_SESSION_HANDLE stream, DTCPIP_Packet *packet,
+                                         DTCPIP_Packet *memberPackets, uint32_t maxMembers, uint32_t *numMembers)
+{
+	DTCP_LOG_ENTRY();
+	if (packet == NULL || numMembers == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	*numMembers = 0;
+	sessionHandle* locHandle = DTCPSessionAcquire(stream);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_ERR_INVALID_PARAM;
+	if (locHandle->shared != NULL)
+	{
+		ret = DTCPSharedProcess(locHandle, stream, packet, encryptShared, memberPackets, maxMembers, numMembers);
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrStartPcpIndex(DTCP_SESSION_HANDLE session)
+{
+	DTCP_LOG_ENTRY();
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_SUCCESS;
+	syncSession(locHandle);
+	if (locHandle->index == NULL)
+	{
+		locHandle->index = DTCPIndexCreate();
+		if (locHandle->index == NULL)
+		{
+			ret = DTCP_ERR_MEMORY_ALLOC;
+		}
+		else if (locHandle->type == DTCP_SOURCE)
+		{
+			locHandle->source.index = locHandle->index;
+		}
+		else
+		{
+			locHandle->sink.index = locHandle->index;
+		}
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrGetPcpIndex(DTCP_SESSION_HANDLE session, uint8_t *index, uint32_t size, uint32_t *length)
+{
+	DTCP_LOG_ENTRY();
+	if (length == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_ERR_INVALID_PARAM;
+	if (locHandle->index != NULL)
+	{
+		ret = DTCPIndexWrite(locHandle->index, index, size, length);
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrSeekSinkSession(DTCP_SESSION_HANDLE session, const uint8_t *index, uint32_t indexLength,
+                                     uint64_t offset, uint64_t *readOffset)
+{
+	DTCP_LOG_ENTRY();
+	uint64_t pcpOffset;
+	const uint8_t *header;
+	if (readOffset == NULL || DTCPIndexFind(index, indexLength, offset, &pcpOffset, &header) != DTCP_SUCCESS)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = DTCP_ERR_INVALID_PARAM;
+	if (locHandle->type == DTCP_SINK)
+	{
+		syncSession(locHandle);
+		ret = DTCPPcpSinkSeek(&locHandle->sink, header, pcpOffset, offset, readOffset);
+	}
+	DTCPSessionRelease(locHandle);
+	DTCP_LOG_DEBUG("Seek to %llu: PCP at %llu, result = %d\n", (unsigned long long)offset,
+	               (unsigned long long)pcpOffset, ret);
+	return ret;
+}
+
+
+dtcp_result_t DTCPMgrGetPacketSegments(const DTCPIP_Packet *packet, struct iovec *segments, uint32_t maxSegments, uint32_t *numSegments)
+{
+	DTCP_LOG_ENTRY();
+	if (packet == NULL || segments == NULL || numSegments == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	bool haveHeader = packet->pcpHeader != NULL && packet->pcpHeaderLength > 0 && packet->pcpHeaderOffset >= 0;
+	uint32_t split = haveHeader ? (uint32_t)packet->pcpHeaderOffset : packet->dataLength;
+	if (split > packet->dataLength)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	struct iovec list[DTCPIP_MAX_PACKET_SEGMENTS];
+	uint32_t count = 0;
+	if (split > 0)
+	{
+		list[count].iov_base = packet->dataOutPtr;
+		list[count].iov_len = split;
+		count++;
+	}
+	if (haveHeader)
+	{
+		list[count].iov_base = packet->pcpHeader;
+		list[count].iov_len = packet->pcpHeaderLength;
+		count++;
+	}
+	if (packet->dataLength > split)
+	{
+		list[count].iov_base = packet->dataOutPtr + split;
+		list[count].iov_len = packet->dataLength - split;
+		count++;
+	}
+	if (count > maxSegments)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	memcpy(segments, list, count * sizeof(struct iovec));
+	*numSegments = count;
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPMgrProcessToFd(DTCP_SESSION_HANDLE session, DTCPIP_Packet *packet, int fd, uint32_t flags)
+{
+	DTCP_LOG_ENTRY();
+	if (packet == NULL || fd < 0)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = processPacket(locHandle, packet, NULL);
+	if (ret == DTCP_SUCCESS)
+	{
+		struct iovec segments[DTCPIP_MAX_PACKET_SEGMENTS];
+		uint32_t numSegments = 0;
+		uint32_t written = 0;
+		ret = DTCPMgrGetPacketSegments(packet, segments, DTCPIP_MAX_PACKET_SEGMENTS, &numSegments);
+		if (ret == DTCP_SUCCESS)
+		{
+			for (uint32_t i = 0; i < numSegments; i++)
+			{
+				written += segments[i].iov_len;
+			}
+			/* The sender owns the buffers from here on. */
+			ret = DTCPFdSend(&locHandle->fdSender, fd, (flags & DTCPIP_FD_ZEROCOPY) != 0, segments, numSegments,
+			                 (packet->dataOutPtr != packet->dataInPtr) ? packet->dataOutPtr : NULL, packet->pcpHeader);
+			packet->dataOutPtr = NULL;
+			packet->dataOutPhyPtr = NULL;
+			packet->pcpHeader = NULL;
+			packet->pcpHeaderLength = 0;
+			packet->pcpHeaderOffset = -1;
+			packet->dataLength = (ret == DTCP_SUCCESS) ? written : 0;
+		}
+		else
+		{
+			DTCPMgrReleasePacket(packet);
+		}
+	}
+	DTCPSessionRelease(locHandle);
+	return ret;
+}
+
+dtcp_result_t DTCPMgrProcessFile(DTCP_SESSION_HANDLE session, int inFd, int outFd, uint32_t chunkSize,
+                                 DTCPIP_FileStats *stats)
+{
+	DTCP_LOG_ENTRY();
+	sessionHandle* locHandle = DTCPSessionAcquire(session);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	bool isSource = (locHandle->type == DTCP_SOURCE);
+	if (chunkSize == 0)
+	{
+		chunkSize = DTCP_FILE_CHUNK_SIZE;
+	}
+	if (locHandle->maxPacketSize > 0 && chunkSize > (uint32_t)locHandle->maxPacketSize)
+	{
+		chunkSize = (uint32_t)locHandle->maxPacketSize;
+	}
+	DTCPSessionRelease(locHandle);
+
+	DTCPIP_FileStats result;
+	memset(&result, 0, sizeof(result));
+	dtcp_result_t ret = DTCPFileProcess(session, isSource, inFd, outFd, chunkSize, &result);
+	DTCP_LOG_DEBUG("Processed %llu bytes of file in %llu us, result = %d\n", (unsigned long long)result.bytesIn,
+	               (unsigned long long)(result.elapsedNs / 1000), ret);
+	if (stats != NULL)
+	{
+		*stats = result;
+	}
+	return ret;
+}
 
 dtcp_result_t DTCPMgrReleasePacket(DTCPIP_Packet *packet)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
+	DTCP_LOG_ENTRY();
+	if (packet == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	if (packet->dataOutPtr != packet->dataInPtr)
+	{
+		DTCPPoolPut(packet->dataOutPtr);
+	}
+	DTCPPoolPut(packet->pcpHeader);
+	packet->dataOutPtr = NULL;
+	packet->dataOutPhyPtr = NULL;
+	packet->pcpHeader = NULL;
+	packet->pcpHeaderLength = 0;
+	packet->pcpHeaderOffset = -1;
 	return DTCP_SUCCESS;
 }
 
 dtcp_result_t DTCPMgrDeleteDTCPSession(DTCP_SESSION_HANDLE session)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	sessionHandle* locHandle = (sessionHandle*) &session;
-	delete locHandle;
-	return DTCP_SUCCESS;
+	DTCP_LOG_ENTRY();
+	return DTCPSessionDelete(session);
 }
 
 
 int DTCPMgrGetNumSessions(DTCPDeviceType deviceType)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	return 1;
+	DTCP_LOG_ENTRY();
+	return DTCPSessionCount(deviceType);
 }
 
 
 dtcp_result_t DTCPMgrGetSessionInfo(DTCP_SESSION_HANDLE handle, DTCPIP_Session *session)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
-	sessionHandle* locHandle = new sessionHandle;
-	session = new DTCPIP_Session;
+	DTCP_LOG_ENTRY();
+	if (session == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(handle);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
 	session->session_handle = handle;
+	session->device_type = locHandle->type;
+	session->remote_ip = locHandle->remoteIp;
+	session->uniqueKey = locHandle->uniqueKey;
+	session->PCPPacketSize = (locHandle->type == DTCP_SOURCE) ? (int)DTCPPcpSourcePacketSize(&locHandle->source) : 0;
+	DTCPSessionRelease(locHandle);
+	return DTCP_SUCCESS;
+}
+
+static void addPoolInfo(DTCPIP_BufferPoolInfo *total, const DTCPIP_BufferPoolInfo *info)
+{
+	total->buffersAllocated += info->buffersAllocated;
+	total->buffersInUse += info->buffersInUse;
+	total->highWaterMark += info->highWaterMark;
+	total->heapAllocations += info->heapAllocations;
+}
+
+static void addSessionPools(sessionHandle* locHandle, void *arg)
+{
+	DTCPIP_SessionStats *stats = (DTCPIP_SessionStats *)arg;
+	DTCPIP_BufferPoolInfo info;
+	DTCPPoolGetInfo(locHandle->dataPool, &info);
+	addPoolInfo(&stats->dataPool, &info);
+	DTCPPoolGetInfo(locHandle->headerPool, &info);
+	addPoolInfo(&stats->headerPool, &info);
+}
+
+dtcp_result_t DTCPMgrGetSessionStats(DTCP_SESSION_HANDLE handle, DTCPIP_SessionStats *stats)
+{
+	DTCP_LOG_ENTRY();
+	if (stats == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	if (handle == DTCPIP_ALL_SESSIONS)
+	{
+		memset(stats, 0, sizeof(*stats));
+		DTCPSessionGetTotals(stats);
+		DTCPSessionForEach(addSessionPools, stats);
+		return DTCP_SUCCESS;
+	}
+	sessionHandle* locHandle = DTCPSessionAcquire(handle);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	DTCPStatsGet(locHandle->stats, &locHandle->statsBase, stats);
+	DTCPPoolGetInfo(locHandle->dataPool, &stats->dataPool);
+	DTCPPoolGetInfo(locHandle->headerPool, &stats->headerPool);
+	DTCPSessionRelease(locHandle);
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPMgrGetBufferPoolInfo(DTCP_SESSION_HANDLE handle, DTCPIP_BufferPoolInfo *dataPool, DTCPIP_BufferPoolInfo *headerPool)
+{
+	DTCP_LOG_ENTRY();
+	sessionHandle* locHandle = DTCPSessionAcquire(handle);
+	if (locHandle == NULL)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	if (dataPool != NULL)
+	{
+		DTCPPoolGetInfo(locHandle->dataPool, dataPool);
+	}
+	if (headerPool != NULL)
+	{
+		DTCPPoolGetInfo(locHandle->headerPool, headerPool);
+	}
+	DTCPSessionRelease(locHandle);
 	return DTCP_SUCCESS;
 }
 
 dtcp_result_t DTCPMgrSetLogLevel(int level)
 {
-	printf("Entered fucntion %s\n",__PRETTY_FUNCTION__);
+	DTCP_LOG_ENTRY();
+	if (level < DTCP_LOG_NONE || level > DTCP_LOG_TRACE)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcpLogLevel.store(level, std::memory_order_relaxed);
 	return DTCP_SUCCESS;
 } 
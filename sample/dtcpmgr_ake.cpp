@@ -0,0 +1,183 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * AKE burst benchmark for the DTCP Manager.
+ *
+ * Starts a source on the loopback interface and measures the time from a
+ * burst of sinks tuning in at once (DTCPMgrCreateSinkSession() from one
+ * thread each) to each of them holding its exchange key. The burst runs
+ * once on an idle source and once while a few sinks hold connections open
+ * without ever sending, which a source that serves one handshake at a time
+ * would wait on until they time out. Results in milliseconds go to stderr.
+ */
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define AKE_BURST_SINKS   50
+#define AKE_STALLED_SINKS 4
+#define AKE_SERIAL_RUNS   20
+#define AKE_BASE_PORT     20000
+#define AKE_UNIQUE_KEY    1       /* Not cached by the sink, so every sink runs the AKE. */
+
+static double nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int startSource(void)
+{
+	for (int i = 0; i < 100; i++)
+	{
+		int port = AKE_BASE_PORT + (int)((getpid() + i * 97) % 20000);
+		if (DTCPMgrStartSource((char *)"lo", port) == DTCP_SUCCESS)
+		{
+			return port;
+		}
+	}
+	return -1;
+}
+
+/* Returns the time to the exchange key in ms, or a negative value on failure. */
+static double tuneIn(int port)
+{
+	DTCP_SESSION_HANDLE session;
+	double start = nowMs();
+	if (DTCPMgrCreateSinkSession((char *)"127.0.0.1", port, AKE_UNIQUE_KEY, 0, &session) != DTCP_SUCCESS)
+	{
+		return -1;
+	}
+	double elapsed = nowMs() - start;
+	DTCPMgrDeleteDTCPSession(session);
+	return elapsed;
+}
+
+static bool runBurst(const char *name, int port)
+{
+	std::vector<double> latency(AKE_BURST_SINKS);
+	std::vector<std::thread> sinks;
+	std::atomic<bool> go(false);
+	double start = 0;
+
+	for (int i = 0; i < AKE_BURST_SINKS; i++)
+	{
+		sinks.push_back(std::thread([&, i]()
+		{
+			while (!go.load())
+			{
+				std::this_thread::yield();
+			}
+			DTCP_SESSION_HANDLE session;
+			latency[i] = -1;
+			if (DTCPMgrCreateSinkSession((char *)"127.0.0.1", port, AKE_UNIQUE_KEY, 0, &session) == DTCP_SUCCESS)
+			{
+				/* Measured from the start of the burst, so time queued behind other sinks counts. */
+				latency[i] = nowMs() - start;
+				DTCPMgrDeleteDTCPSession(session);
+			}
+		}));
+	}
+	start = nowMs();
+	go.store(true);
+	for (size_t i = 0; i < sinks.size(); i++)
+	{
+		sinks[i].join();
+	}
+
+	std::sort(latency.begin(), latency.end());
+	if (latency[0] < 0)
+	{
+		fprintf(stderr, "%-24s failed\n", name);
+		return false;
+	}
+	fprintf(stderr, "%-24s %10.2f %10.2f %10.2f %10.2f\n", name, latency[0], latency[AKE_BURST_SINKS / 2],
+	        latency[AKE_BURST_SINKS * 9 / 10], latency[AKE_BURST_SINKS - 1]);
+	return true;
+}
+
+int main(void)
+{
+	int stalled[AKE_STALLED_SINKS];
+	std::vector<double> serial;
+	bool ok = true;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	int port = startSource();
+	if (port < 0)
+	{
+		fprintf(stderr, "could not start the source\n");
+		return 1;
+	}
+
+	for (int i = 0; i < AKE_SERIAL_RUNS; i++)
+	{
+		double elapsed = tuneIn(port);
+		if (elapsed < 0)
+		{
+			fprintf(stderr, "AKE with the source failed\n");
+			return 1;
+		}
+		serial.push_back(elapsed);
+	}
+	std::sort(serial.begin(), serial.end());
+	fprintf(stderr, "single sink: median %.2f ms\n", serial[AKE_SERIAL_RUNS / 2]);
+
+	fprintf(stderr, "time to first key of %d sinks tuning in at once, ms\n", AKE_BURST_SINKS);
+	fprintf(stderr, "%-24s %10s %10s %10s %10s\n", "", "min", "p50", "p90", "max");
+	ok = runBurst("idle source", port) && ok;
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	for (int i = 0; i < AKE_STALLED_SINKS; i++)
+	{
+		stalled[i] = socket(AF_INET, SOCK_STREAM, 0);
+		if (stalled[i] < 0 || connect(stalled[i], (struct sockaddr *)&address, sizeof(address)) != 0)
+		{
+			fprintf(stderr, "could not connect a stalled sink\n");
+			return 1;
+		}
+	}
+	ok = runBurst("with stalled sinks", port) && ok;
+	for (int i = 0; i < AKE_STALLED_SINKS; i++)
+	{
+		close(stalled[i]);
+	}
+
+	DTCPMgrStopSource();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Micro-benchmark for the DTCP Manager API.
+ *
+ * Compares the per-byte cost of DTCPMgrProcessPacket() against the batched
+ * DTCPMgrProcessPacketV() entry point and in-place DTCPMgrProcessPacketEx()
+ * for a set of typical buffer sizes.
+ * It also checks that steady-state processing makes no heap allocations at
+ * all, and fails if it does: the allocator entry points are wrapped below,
+ * so anything the library allocates is counted, not just pool slabs.
+ * Results are written to stderr so that they stay readable next to the
+ * library's own console output.
+ */
+#include <atomic>
+#include <errno.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define BENCH_BATCH       32
+#define BENCH_TOTAL_BYTES (64 * 1024 * 1024)
+
+static uint64_t errors = 0;   /* Packets that failed, which would also make the allocation check pass. */
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> heapAllocations(0);
+
+static inline void countAllocation(void)
+{
+	if (counting.load(std::memory_order_relaxed))
+	{
+		heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+#ifdef __GLIBC__
+/* With glibc the malloc family is wrapped around its __libc_ entry points; operator new calls malloc. */
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *memory, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size)
+{
+	countAllocation();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	countAllocation();
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, size_t size)
+{
+	countAllocation();
+	return __libc_realloc(memory, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	countAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	countAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memory, size_t alignment, size_t size)
+{
+	countAllocation();
+	*memory = __libc_memalign(alignment, size);
+	return (*memory != NULL) ? 0 : ENOMEM;
+}
+}
+#else
+/* Elsewhere only C++ allocations are seen. */
+void *operator new(size_t size)
+{
+	countAllocation();
+	void *memory = malloc(size != 0 ? size : 1);
+	if (memory == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	countAllocation();
+	return malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void *memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+	free(memory);
+}
+#endif
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void initPacket(DTCPIP_Packet *packet, DTCP_SESSION_HANDLE session, uint8_t *data, uint32_t size)
+{
+	memset(packet, 0, sizeof(*packet));
+	packet->session = session;
+	packet->emi = 0;
+	packet->dataInPtr = data;
+	packet->dataLength = size;
+	packet->pcpHeaderOffset = -1;
+}
+
+static double benchSingle(DTCP_SESSION_HANDLE session, std::vector<uint8_t> &data, uint32_t size, uint32_t count)
+{
+	DTCPIP_Packet packet;
+	double start = nowNs();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		initPacket(&packet, session, &data[(i % BENCH_BATCH) * size], size);
+		if (DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS)
+		{
+			DTCPMgrReleasePacket(&packet);
+		}
+		else
+		{
+			errors++;
+		}
+	}
+	return nowNs() - start;
+}
+
+static double benchBatched(DTCP_SESSION_HANDLE session, std::vector<uint8_t> &data, uint32_t size, uint32_t count)
+{
+	DTCPIP_Packet packets[BENCH_BATCH];
+	dtcp_result_t results[BENCH_BATCH];
+	double start = nowNs();
+	for (uint32_t i = 0; i < count; i += BENCH_BATCH)
+	{
+		uint32_t n = (count - i < BENCH_BATCH) ? count - i : BENCH_BATCH;
+		for (uint32_t j = 0; j < n; j++)
+		{
+			initPacket(&packets[j], session, &data[j * size], size);
+		}
+		DTCPMgrProcessPacketV(packets, n, results);
+		for (uint32_t j = 0; j < n; j++)
+		{
+			if (results[j] == DTCP_SUCCESS)
+			{
+				DTCPMgrReleasePacket(&packets[j]);
+			}
+			else
+			{
+				errors++;
+			}
+		}
+	}
+	return nowNs() - start;
+}
+
+/* @a buffers holds BENCH_BATCH buffers with room for the AES padding after each packet. */
+static double benchInPlace(DTCP_SESSION_HANDLE session, std::vector<uint8_t> &buffers, uint32_t size, uint32_t count)
+{
+	DTCPIP_Packet packet;
+	DTCPIP_OutputBuffer output;
+	uint8_t header[DTCPIP_PCP_HEADER_SIZE];
+	uint32_t stride = (uint32_t)(buffers.size() / BENCH_BATCH);
+
+	memset(&output, 0, sizeof(output));
+	output.mode = DTCP_OUTPUT_IN_PLACE;
+	output.headerPtr = header;
+	double start = nowNs();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint8_t *buffer = &buffers[(i % BENCH_BATCH) * stride];
+		initPacket(&packet, session, buffer, size);
+		DTCPMgrGetOutputSize(session, size, 0, &output.capacity);
+		if (DTCPMgrProcessPacketEx(session, &packet, &output) != DTCP_SUCCESS)
+		{
+			errors++;
+		}
+	}
+	return nowNs() - start;
+}
+
+int main(void)
+{
+	static const uint32_t sizes[] = { 1024, 16 * 1024, 188 * 7, 188 * 348 };
+	DTCP_SESSION_HANDLE session = 0;
+	int failed = 0;
+
+	DTCPMgrInitialize();
+	if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", 0, 0, 128 * 1024, &session) != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create source session\n");
+		return 1;
+	}
+
+	fprintf(stderr, "%10s %12s %14s %14s %14s %12s\n", "size", "packets", "single ns/B", "batched ns/B",
+	        "in-place ns/B", "heap allocs");
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		uint32_t size = sizes[s];
+		uint32_t count = BENCH_TOTAL_BYTES / size;
+		std::vector<uint8_t> data((size_t)size * BENCH_BATCH, 0x47);
+		std::vector<uint8_t> inPlaceBuffers((size_t)(size + 32) * BENCH_BATCH, 0x47);
+
+		/* Warm the pool up to a full batch, then count what the measured runs allocate. */
+		benchBatched(session, data, size, BENCH_BATCH);
+		heapAllocations.store(0);
+		counting.store(true);
+		double single = benchSingle(session, data, size, count);
+		double batched = benchBatched(session, data, size, count);
+		double inPlace = benchInPlace(session, inPlaceBuffers, size, count);
+		counting.store(false);
+		uint64_t allocations = heapAllocations.load();
+		double bytes = (double)count * size;
+		fprintf(stderr, "%10u %12u %14.4f %14.4f %14.4f %12llu\n", size, count, single / bytes, batched / bytes,
+		        inPlace / bytes, (unsigned long long)allocations);
+		if (allocations != 0)
+		{
+			fprintf(stderr, "%u byte packets allocated from the heap in steady state\n", size);
+			failed = 1;
+		}
+	}
+
+	if (errors != 0)
+	{
+		fprintf(stderr, "%llu packets failed\n", (unsigned long long)errors);
+		failed = 1;
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	return failed;
+}
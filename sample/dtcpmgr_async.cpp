@@ -0,0 +1,346 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Latency benchmark for DTCPMgrProcessPacketAsync().
+ *
+ * Encrypts packets and sends each to a simulated peer that takes as long
+ * to receive it as the measured encryption and then acknowledges it, so
+ * that the sending thread blocks on I/O for as long as it encrypts. The
+ * synchronous loop pays for both in turn; the asynchronous loops,
+ * completed through the session's eventfd or through a callback, send one
+ * packet while the worker pool encrypts the next. Wall time, throughput
+ * and the per-packet latency from submit to acknowledged are written to
+ * stderr.
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <mutex>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define ASYNC_PACKET_SIZE (188 * 348)
+#define ASYNC_PACKETS     2048
+#define ASYNC_WINDOW      2
+
+typedef struct
+{
+	int                 fd;
+	double              nsPerByte;
+	std::atomic<double> sentAt;    /**< When the sender started writing the current packet. */
+} linkArgs;
+
+typedef struct
+{
+	std::mutex                  lock;
+	std::condition_variable     cond;
+	std::deque<DTCPIP_Packet *> done;
+} completionQueue;
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Receives packets at the link rate and acknowledges each with one byte.
+ * The transfer time counts from the moment the packet was sent, so that a
+ * late wakeup of this thread on a busy CPU does not stretch the link.
+ */
+static void *drainLink(void *arg)
+{
+	linkArgs *link = (linkArgs *)arg;
+	/* Every packet of a PCPPacketSize 0 session carries one PCP header. */
+	const size_t packetBytes = ASYNC_PACKET_SIZE + DTCPIP_PCP_HEADER_SIZE;
+	std::vector<uint8_t> buffer(packetBytes);
+	size_t received = 0;
+	for (;;)
+	{
+		ssize_t n = read(link->fd, &buffer[0], packetBytes - received);
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+		received += n;
+		if (received == packetBytes)
+		{
+			double deadline = link->sentAt.load() + packetBytes * link->nsPerByte;
+			struct timespec ts;
+			ts.tv_sec = (time_t)(deadline / 1e9);
+			ts.tv_nsec = (long)(deadline - ts.tv_sec * 1e9);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			{
+			}
+			uint8_t ack = 1;
+			if (write(link->fd, &ack, 1) != 1)
+			{
+				break;
+			}
+			received = 0;
+		}
+	}
+	return NULL;
+}
+
+/* Sends @a packet and waits for the peer to acknowledge it. */
+static bool sendPacket(linkArgs *link, int fd, DTCPIP_Packet *packet)
+{
+	struct iovec segments[DTCPIP_MAX_PACKET_SEGMENTS];
+	uint32_t numSegments = 0;
+	if (DTCPMgrGetPacketSegments(packet, segments, DTCPIP_MAX_PACKET_SEGMENTS, &numSegments) != DTCP_SUCCESS)
+	{
+		return false;
+	}
+	struct iovec *next = segments;
+	link->sentAt.store(nowNs());
+	while (numSegments > 0)
+	{
+		ssize_t sent = writev(fd, next, numSegments);
+		if (sent < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		while (numSegments > 0 && (size_t)sent >= next->iov_len)
+		{
+			sent -= next->iov_len;
+			next++;
+			numSegments--;
+		}
+		if (numSegments > 0)
+		{
+			next->iov_base = (uint8_t *)next->iov_base + sent;
+			next->iov_len -= sent;
+		}
+	}
+	uint8_t ack;
+	return read(fd, &ack, 1) == 1;
+}
+
+static void initPacket(DTCPIP_Packet *packet, DTCP_SESSION_HANDLE session, uint8_t *data)
+{
+	memset(packet, 0, sizeof(*packet));
+	packet->session = session;
+	packet->dataInPtr = data;
+	packet->dataLength = ASYNC_PACKET_SIZE;
+	packet->pcpHeaderOffset = -1;
+}
+
+static void onComplete(DTCPIP_Packet *packet, dtcp_result_t result, void *userData)
+{
+	completionQueue *queue = (completionQueue *)userData;
+	if (result != DTCP_SUCCESS)
+	{
+		/* dataLength 0 tells the writer that the packet failed. */
+		packet->dataLength = 0;
+	}
+	{
+		std::lock_guard<std::mutex> lock(queue->lock);
+		queue->done.push_back(packet);
+	}
+	queue->cond.notify_one();
+}
+
+typedef enum
+{
+	MODE_SYNC,
+	MODE_EVENTFD,
+	MODE_CALLBACK
+} benchMode;
+
+/* Encrypts and writes ASYNC_PACKETS packets; fills @a latencies in ns and returns the wall time, or -1. */
+static double runMode(benchMode mode, DTCP_SESSION_HANDLE session, std::vector<uint8_t> &data, double nsPerByte,
+                      std::vector<double> &latencies)
+{
+	int fds[2];
+	DTCPIP_Packet packets[ASYNC_WINDOW];
+	double submitted[ASYNC_WINDOW];
+	completionQueue queue;
+	linkArgs link;
+	pthread_t drain;
+	bool ok = true;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+	{
+		return -1;
+	}
+	link.fd = fds[1];
+	link.nsPerByte = nsPerByte;
+	latencies.clear();
+
+	double start = nowNs();
+	pthread_create(&drain, NULL, drainLink, &link);
+	if (mode == MODE_SYNC)
+	{
+		for (uint32_t i = 0; i < ASYNC_PACKETS && ok; i++)
+		{
+			double t0 = nowNs();
+			initPacket(&packets[0], session, &data[(i % ASYNC_WINDOW) * ASYNC_PACKET_SIZE]);
+			ok = (DTCPMgrProcessPacket(session, &packets[0]) == DTCP_SUCCESS) && sendPacket(&link, fds[0], &packets[0]);
+			DTCPMgrReleasePacket(&packets[0]);
+			latencies.push_back(nowNs() - t0);
+		}
+	}
+	else
+	{
+		int eventFd = -1;
+		uint32_t next = 0, written = 0;
+		if (mode == MODE_EVENTFD && DTCPMgrGetCompletionFd(session, &eventFd) != DTCP_SUCCESS)
+		{
+			ok = false;
+		}
+		while (written < ASYNC_PACKETS && ok)
+		{
+			/* Keeps the window full, so the workers encrypt while this thread writes. */
+			while (next < ASYNC_PACKETS && next - written < ASYNC_WINDOW)
+			{
+				uint32_t slot = next % ASYNC_WINDOW;
+				initPacket(&packets[slot], session, &data[slot * ASYNC_PACKET_SIZE]);
+				submitted[slot] = nowNs();
+				dtcp_result_t ret = DTCPMgrProcessPacketAsync(session, &packets[slot],
+				                                              (mode == MODE_CALLBACK) ? onComplete : NULL, &queue);
+				if (ret == DTCP_ERR_BUSY)
+				{
+					break;
+				}
+				ok = ok && (ret == DTCP_SUCCESS);
+				next++;
+			}
+			DTCPIP_Packet *packet = NULL;
+			dtcp_result_t result = DTCP_SUCCESS;
+			if (mode == MODE_EVENTFD)
+			{
+				if (DTCPMgrCompletePacket(session, 0, &packet, &result) == DTCP_ERR_TIMEOUT)
+				{
+					struct pollfd pfd = { eventFd, POLLIN, 0 };
+					uint64_t counter;
+					poll(&pfd, 1, -1);
+					ssize_t n = read(eventFd, &counter, sizeof(counter));
+					(void)n;
+					continue;
+				}
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock(queue.lock);
+				queue.cond.wait(lock, [&queue] { return !queue.done.empty(); });
+				packet = queue.done.front();
+				queue.done.pop_front();
+				result = (packet->dataLength > 0) ? DTCP_SUCCESS : DTCP_ERR_GENERAL;
+			}
+			ok = ok && (result == DTCP_SUCCESS) && sendPacket(&link, fds[0], packet);
+			if (result == DTCP_SUCCESS)
+			{
+				DTCPMgrReleasePacket(packet);
+			}
+			latencies.push_back(nowNs() - submitted[written % ASYNC_WINDOW]);
+			written++;
+		}
+	}
+	shutdown(fds[0], SHUT_WR);
+	pthread_join(drain, NULL);
+	double elapsed = nowNs() - start;
+	close(fds[0]);
+	close(fds[1]);
+	return ok ? elapsed : -1;
+}
+
+static double percentile(std::vector<double> &values, double p)
+{
+	std::sort(values.begin(), values.end());
+	return values[(size_t)(p * (values.size() - 1))];
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *names[] = { "sync", "eventfd", "callback" };
+	DTCPIP_Config config;
+	DTCP_SESSION_HANDLE session = 0;
+	std::vector<uint8_t> data((size_t)ASYNC_PACKET_SIZE * ASYNC_WINDOW, 0x47);
+	std::vector<double> latencies;
+
+	if (freopen("/dev/null", "w", stdout) == NULL)
+	{
+		return 1;
+	}
+	memset(&config, 0, sizeof(config));
+	config.numWorkers = (argc > 1) ? atoi(argv[1]) : 1;
+	if (DTCPMgrInitializeEx(&config) != DTCP_SUCCESS ||
+	    DTCPMgrCreateSourceSession((char *)"127.0.0.1", 0, 0, ASYNC_PACKET_SIZE, &session) != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create source session\n");
+		return 1;
+	}
+
+	/* Calibrates the link to the cost of encryption alone. */
+	DTCPIP_Packet packet;
+	double t0 = nowNs();
+	for (uint32_t i = 0; i < ASYNC_PACKETS / 4; i++)
+	{
+		initPacket(&packet, session, &data[0]);
+		if (DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS)
+		{
+			DTCPMgrReleasePacket(&packet);
+		}
+	}
+	double cryptoNs = (nowNs() - t0) / (ASYNC_PACKETS / 4);
+	double nsPerByte = cryptoNs / ASYNC_PACKET_SIZE;
+
+	fprintf(stderr, "%u workers, %u x %u byte packets, crypto and link %.1f us per packet\n", config.numWorkers,
+	        ASYNC_PACKETS, ASYNC_PACKET_SIZE, cryptoNs / 1e3);
+	fprintf(stderr, "%10s %10s %10s %12s %12s\n", "mode", "wall ms", "MB/s", "p50 us", "p99 us");
+	int failed = 0;
+	for (int mode = MODE_SYNC; mode <= MODE_CALLBACK; mode++)
+	{
+		double elapsed = runMode((benchMode)mode, session, data, nsPerByte, latencies);
+		if (elapsed < 0)
+		{
+			fprintf(stderr, "%10s failed\n", names[mode]);
+			failed = 1;
+			continue;
+		}
+		fprintf(stderr, "%10s %10.1f %10.1f %12.1f %12.1f\n", names[mode], elapsed / 1e6,
+		        (double)ASYNC_PACKETS * ASYNC_PACKET_SIZE / (elapsed / 1e9) / (1024 * 1024),
+		        percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.99) / 1e3);
+	}
+
+	DTCPMgrDeleteDTCPSession(session);
+	return failed;
+}
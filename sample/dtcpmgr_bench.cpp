@@ -0,0 +1,459 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Throughput and latency benchmark suite for implementations of dtcpmgr.h.
+ *
+ * Sweeps packet size, PCPPacketSize, session count, thread count and source
+ * versus sink, and writes one JSON document with MB/s, ns per packet and
+ * p50/p99/p999 latency of each run to stdout, so results of different boards
+ * and DTCP libraries can be compared by a script. Progress goes to stderr.
+ *
+ * Only the calls every DTCP library provides are used: sessions, the source
+ * and DTCPMgrProcessPacket(). Each thread drives its share of the sessions
+ * in turn, one packet each, the way a media server drives its streams. Sink
+ * sessions get their exchange key from a source started on the loopback
+ * interface in this process and decrypt a stream encrypted beforehand. Every
+ * run moves the same number of bytes in total, and the first packet of each
+ * session, which sets up its buffers, is not timed. Configure with
+ * --with-bench-library to link another library than the reference one.
+ */
+#include <algorithm>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define BENCH_MAX_SESSIONS 256
+#define BENCH_MAX_THREADS  64
+#define BENCH_BASE_PORT    27000
+#define BENCH_TS_PACKET    188
+
+typedef struct
+{
+	bool     sink;
+	uint32_t packetSize;
+	uint32_t pcpSize;
+	uint32_t sessions;
+	uint32_t threads;
+} benchRun;
+
+typedef struct
+{
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t errors;
+	double   wallNs;
+	double   meanNs;
+	uint32_t p50Ns;
+	uint32_t p99Ns;
+	uint32_t p999Ns;
+} benchResult;
+
+typedef struct
+{
+	DTCP_SESSION_HANDLE     handle;
+	const uint8_t          *stream;     /* Input, packetSize bytes per packet. */
+	uint64_t                length;
+} benchSession;
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool parseList(const char *text, std::vector<uint32_t> *list)
+{
+	list->clear();
+	while (*text != '\0')
+	{
+		char *end;
+		unsigned long value = strtoul(text, &end, 0);
+		if (end == text || (*end != ',' && *end != '\0'))
+		{
+			return false;
+		}
+		list->push_back((uint32_t)value);
+		text = (*end == ',') ? end + 1 : end;
+	}
+	return !list->empty();
+}
+
+/* Transport stream packets with a running counter, so no two buffers are alike. */
+static void fillContent(std::vector<uint8_t> *content, uint64_t length)
+{
+	content->resize(length);
+	for (uint64_t i = 0; i < length; i++)
+	{
+		(*content)[i] = (i % BENCH_TS_PACKET == 0) ? 0x47 : (uint8_t)(i * 31 + (i >> 12));
+	}
+}
+
+/* Encrypts @a content into the PCP stream a sink session of @a run is to decrypt. */
+static bool encryptStream(const benchRun *run, const std::vector<uint8_t> &content, std::vector<uint8_t> *stream)
+{
+	DTCP_SESSION_HANDLE session;
+	if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, (int)run->pcpSize, (int)run->packetSize, &session) !=
+	    DTCP_SUCCESS)
+	{
+		return false;
+	}
+	bool ok = true;
+	stream->clear();
+	for (uint64_t offset = 0; ok && offset < content.size(); offset += run->packetSize)
+	{
+		DTCPIP_Packet packet;
+		memset(&packet, 0, sizeof(packet));
+		packet.session = session;
+		packet.dataInPtr = (uint8_t *)&content[offset];
+		packet.dataLength = (uint32_t)std::min<uint64_t>(run->packetSize, content.size() - offset);
+		packet.isEOF = (offset + packet.dataLength == content.size()) ? 1 : 0;
+		packet.pcpHeaderOffset = -1;
+		ok = DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS;
+		if (!ok)
+		{
+			break;
+		}
+		/* The header goes in front of the payload byte at pcpHeaderOffset. */
+		uint32_t split = (packet.pcpHeader != NULL && packet.pcpHeaderOffset >= 0) ?
+		                 (uint32_t)packet.pcpHeaderOffset : packet.dataLength;
+		stream->insert(stream->end(), packet.dataOutPtr, packet.dataOutPtr + split);
+		if (split < packet.dataLength || packet.pcpHeader != NULL)
+		{
+			if (packet.pcpHeader != NULL)
+			{
+				stream->insert(stream->end(), packet.pcpHeader, packet.pcpHeader + packet.pcpHeaderLength);
+			}
+			stream->insert(stream->end(), packet.dataOutPtr + split, packet.dataOutPtr + packet.dataLength);
+		}
+		DTCPMgrReleasePacket(&packet);
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	return ok;
+}
+
+static bool processPacket(benchSession *session, uint32_t packetSize, uint64_t offset)
+{
+	DTCPIP_Packet packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.session = session->handle;
+	packet.dataInPtr = (uint8_t *)session->stream + offset;
+	packet.dataLength = (uint32_t)std::min<uint64_t>(packetSize, session->length - offset);
+	packet.pcpHeaderOffset = -1;
+	if (DTCPMgrProcessPacket(session->handle, &packet) != DTCP_SUCCESS)
+	{
+		return false;
+	}
+	DTCPMgrReleasePacket(&packet);
+	return true;
+}
+
+/* Drives sessions @a first, @a first + step, ... from their second packet on, recording each call's latency. */
+static void driveSessions(benchSession *sessions, uint32_t count, uint32_t first, uint32_t step, uint32_t packetSize,
+                          std::vector<uint32_t> *latency, uint64_t *errors)
+{
+	uint64_t length = sessions[0].length;
+	for (uint64_t offset = packetSize; offset < length; offset += packetSize)
+	{
+		for (uint32_t s = first; s < count; s += step)
+		{
+			double start = nowNs();
+			bool ok = processPacket(&sessions[s], packetSize, offset);
+			latency->push_back((uint32_t)std::min(nowNs() - start, 4e9));
+			*errors += ok ? 0 : 1;
+		}
+	}
+}
+
+static bool runOnce(const benchRun *run, uint64_t totalBytes, int sourcePort, benchResult *result)
+{
+	std::vector<uint8_t> content;
+	std::vector<uint8_t> stream;
+	benchSession sessions[BENCH_MAX_SESSIONS];
+	uint32_t created = 0;
+	bool ok = true;
+
+	fillContent(&content, std::max<uint64_t>(totalBytes / run->sessions, run->packetSize));
+	if (run->sink && !encryptStream(run, content, &stream))
+	{
+		return false;
+	}
+	const std::vector<uint8_t> &input = run->sink ? stream : content;
+	for (; ok && created < run->sessions; created++)
+	{
+		benchSession *session = &sessions[created];
+		session->stream = &input[0];
+		session->length = input.size();
+		ok = (run->sink ?
+		      DTCPMgrCreateSinkSession((char *)"127.0.0.1", sourcePort, 0, (int)run->packetSize, &session->handle) :
+		      DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, (int)run->pcpSize, (int)run->packetSize,
+		                                 &session->handle)) == DTCP_SUCCESS;
+		/* Sets up the session's buffers outside the measurement. */
+		ok = ok && processPacket(session, run->packetSize, 0);
+	}
+
+	std::vector<std::vector<uint32_t> > latency(run->threads);
+	std::vector<uint64_t> errors(run->threads, 0);
+	double start = nowNs();
+	if (ok)
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < run->threads; t++)
+		{
+			latency[t].reserve((input.size() / run->packetSize + 1) * (run->sessions / run->threads + 1));
+			threads.push_back(std::thread(driveSessions, sessions, run->sessions, t, run->threads, run->packetSize,
+			                              &latency[t], &errors[t]));
+		}
+		for (size_t t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+	}
+	result->wallNs = nowNs() - start;
+	for (uint32_t s = 0; s < created; s++)
+	{
+		DTCPMgrDeleteDTCPSession(sessions[s].handle);
+	}
+	if (!ok)
+	{
+		return false;
+	}
+
+	std::vector<uint32_t> all;
+	result->errors = 0;
+	for (uint32_t t = 0; t < run->threads; t++)
+	{
+		all.insert(all.end(), latency[t].begin(), latency[t].end());
+		result->errors += errors[t];
+	}
+	result->packets = all.size();
+	result->bytes = (input.size() - std::min<uint64_t>(run->packetSize, input.size())) * run->sessions;
+	double sum = 0;
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		sum += all[i];
+	}
+	result->meanNs = all.empty() ? 0 : sum / all.size();
+	std::sort(all.begin(), all.end());
+	result->p50Ns = all.empty() ? 0 : all[all.size() / 2];
+	result->p99Ns = all.empty() ? 0 : all[all.size() * 99 / 100];
+	result->p999Ns = all.empty() ? 0 : all[all.size() * 999 / 1000];
+	return true;
+}
+
+static int startSource(void)
+{
+	for (int i = 0; i < 100; i++)
+	{
+		int port = BENCH_BASE_PORT + (int)((getpid() + i * 97) % 20000);
+		if (DTCPMgrStartSource((char *)"lo", port) == DTCP_SUCCESS)
+		{
+			return port;
+		}
+	}
+	return -1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [options] > results.json\n"
+	        "  --sizes=LIST       packet sizes in bytes (default 1316,16384,65424,262144)\n"
+	        "  --pcp-sizes=LIST   PCPPacketSize of the source sessions (default 0,1048576)\n"
+	        "  --sessions=LIST    concurrent sessions (default 1,4,16)\n"
+	        "  --threads=LIST     threads driving the sessions (default 1,2,4)\n"
+	        "  --modes=LIST       source, sink or both (default source,sink)\n"
+	        "  --bytes=N          bytes moved per run (default 33554432)\n"
+	        "  --label=TEXT       name of the board or library, copied to the output\n"
+	        "Runs with more threads than sessions are skipped.\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "sizes", required_argument, NULL, 'z' },
+		{ "pcp-sizes", required_argument, NULL, 'p' },
+		{ "sessions", required_argument, NULL, 's' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "modes", required_argument, NULL, 'm' },
+		{ "bytes", required_argument, NULL, 'b' },
+		{ "label", required_argument, NULL, 'l' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	std::vector<uint32_t> sizes = { 188 * 7, 16 * 1024, 188 * 348, 256 * 1024 };
+	std::vector<uint32_t> pcpSizes = { 0, 1024 * 1024 };
+	std::vector<uint32_t> sessionCounts = { 1, 4, 16 };
+	std::vector<uint32_t> threadCounts = { 1, 2, 4 };
+	bool modes[2] = { true, true };
+	uint64_t totalBytes = 32 * 1024 * 1024;
+	const char *label = "";
+	bool ok = true;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+			case 'z':
+				ok = parseList(optarg, &sizes) && std::find(sizes.begin(), sizes.end(), 0u) == sizes.end();
+				break;
+			case 'p':
+				ok = parseList(optarg, &pcpSizes);
+				break;
+			case 's':
+				ok = parseList(optarg, &sessionCounts);
+				break;
+			case 't':
+				ok = parseList(optarg, &threadCounts);
+				break;
+			case 'm':
+				modes[0] = strstr(optarg, "source") != NULL;
+				modes[1] = strstr(optarg, "sink") != NULL;
+				ok = modes[0] || modes[1];
+				break;
+			case 'b':
+				totalBytes = strtoull(optarg, NULL, 0);
+				ok = totalBytes > 0;
+				break;
+			case 'l':
+				label = optarg;
+				break;
+			default:
+				ok = false;
+				break;
+		}
+		if (!ok)
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	for (size_t i = 0; i < sessionCounts.size(); i++)
+	{
+		if (sessionCounts[i] == 0 || sessionCounts[i] > BENCH_MAX_SESSIONS)
+		{
+			fprintf(stderr, "session counts must be 1 to %d\n", BENCH_MAX_SESSIONS);
+			return 2;
+		}
+	}
+	for (size_t i = 0; i < threadCounts.size(); i++)
+	{
+		if (threadCounts[i] == 0 || threadCounts[i] > BENCH_MAX_THREADS)
+		{
+			fprintf(stderr, "thread counts must be 1 to %d\n", BENCH_MAX_THREADS);
+			return 2;
+		}
+	}
+
+	/* Libraries that print to stdout would corrupt the JSON, so their output goes to stderr. */
+	int jsonFd = dup(STDOUT_FILENO);
+	FILE *json = (jsonFd >= 0) ? fdopen(jsonFd, "w") : NULL;
+	if (json == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+	{
+		perror("stdout");
+		return 1;
+	}
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "could not initialize the DTCP Manager\n");
+		return 1;
+	}
+	int sourcePort = modes[1] ? startSource() : 0;
+	if (sourcePort < 0)
+	{
+		fprintf(stderr, "could not start the source the sinks authenticate with\n");
+		return 1;
+	}
+
+	struct utsname host;
+	if (uname(&host) != 0)
+	{
+		memset(&host, 0, sizeof(host));
+	}
+	fprintf(json, "{\n  \"benchmark\": \"dtcpmgr_bench\",\n  \"format\": 1,\n  \"label\": \"");
+	for (const char *c = label; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', json);
+		}
+		fputc(((uint8_t)*c < 0x20) ? '?' : *c, json);
+	}
+	fprintf(json, "\",\n  \"machine\": \"%s\",\n  \"cpus\": %ld,\n  \"bytes_per_run\": %llu,\n  \"runs\": [",
+	       host.machine, sysconf(_SC_NPROCESSORS_ONLN), (unsigned long long)totalBytes);
+
+	bool first = true;
+	for (int mode = 0; mode < 2; mode++)
+	{
+		for (size_t z = 0; modes[mode] && z < sizes.size(); z++)
+		{
+			for (size_t p = 0; p < pcpSizes.size(); p++)
+			{
+				for (size_t s = 0; s < sessionCounts.size(); s++)
+				{
+					for (size_t t = 0; t < threadCounts.size(); t++)
+					{
+						benchRun run = { mode == 1, sizes[z], pcpSizes[p], sessionCounts[s], threadCounts[t] };
+						benchResult result;
+						if (run.threads > run.sessions)
+						{
+							continue;
+						}
+						fprintf(stderr, "%-6s size %7u pcp %8u sessions %3u threads %2u: ", run.sink ? "sink" : "source",
+						        run.packetSize, run.pcpSize, run.sessions, run.threads);
+						if (!runOnce(&run, totalBytes, sourcePort, &result))
+						{
+							fprintf(stderr, "failed\n");
+							ok = false;
+							continue;
+						}
+						double mbPerSec = (result.wallNs > 0) ? result.bytes / result.wallNs * 1e3 : 0;
+						fprintf(stderr, "%9.1f MB/s, p99 %u ns%s\n", mbPerSec, result.p99Ns,
+						        (result.errors > 0) ? ", with errors" : "");
+						ok = ok && result.errors == 0;
+						fprintf(json, "%s\n    { \"mode\": \"%s\", \"packet_size\": %u, \"pcp_size\": %u, \"sessions\": %u, "
+						       "\"threads\": %u, \"packets\": %llu, \"errors\": %llu, \"mb_per_s\": %.2f, "
+						       "\"ns_per_packet\": %.1f, \"p50_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u }",
+						       first ? "" : ",", run.sink ? "sink" : "source", run.packetSize, run.pcpSize,
+						       run.sessions, run.threads, (unsigned long long)result.packets,
+						       (unsigned long long)result.errors, mbPerSec, result.meanNs, result.p50Ns,
+						       result.p99Ns, result.p999Ns);
+						first = false;
+					}
+				}
+			}
+		}
+	}
+	fprintf(json, "\n  ]\n}\n");
+	fclose(json);
+	if (modes[1])
+	{
+		DTCPMgrStopSource();
+	}
+	return ok ? 0 : 1;
+}
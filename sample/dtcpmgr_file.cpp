@@ -0,0 +1,182 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Bulk file tool of the DTCP Manager.
+ *
+ * Encrypts a recording into a PCP stream, or decrypts one, with
+ * DTCPMgrProcessFile(): the input is mapped, cut into chunks and processed
+ * on a pool of worker threads, one per online CPU by default. The sink uses
+ * the exchange key of the source at -s, or the local one if none is given.
+ * With -i the PCP index of the stream is written next to the output. The
+ * throughput in MB/s goes to stderr.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-d] [-w workers] [-c chunk] [-p pcpsize] [-k label] [-s host:port] [-i index] in out\n"
+	        "  -d  decrypt a PCP stream (default: encrypt)\n"
+	        "  -w  worker threads (default: online CPUs)\n"
+	        "  -c  bytes per chunk (default: 1 MiB)\n"
+	        "  -p  PCPPacketSize of the source session (default: 0, a PCP per chunk)\n"
+	        "  -k  exchange key label of the source session (default: -1)\n"
+	        "  -s  source to get the exchange key from when decrypting (default: local key)\n"
+	        "  -i  write the PCP index of the stream to this file\n"
+	        "  out may be - for stdout\n", name);
+}
+
+static bool writeIndex(DTCP_SESSION_HANDLE session, const char *path)
+{
+	uint32_t length = 0;
+	if (DTCPMgrGetPcpIndex(session, NULL, 0, &length) != DTCP_SUCCESS)
+	{
+		return false;
+	}
+	std::vector<uint8_t> index(length);
+	FILE *file = fopen(path, "wb");
+	bool ok = file != NULL && DTCPMgrGetPcpIndex(session, &index[0], length, &length) == DTCP_SUCCESS &&
+	          fwrite(&index[0], 1, length, file) == length;
+	if (file != NULL)
+	{
+		ok = fclose(file) == 0 && ok;
+	}
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	DTCPIP_Config config;
+	bool decrypt = false;
+	uint32_t chunkSize = 0;
+	int pcpSize = 0;
+	int keyLabel = -1;
+	char *source = NULL;
+	int sourcePort = 0;
+	const char *indexPath = NULL;
+	int opt;
+
+	memset(&config, 0, sizeof(config));
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	config.numWorkers = (cpus > 1) ? (uint32_t)cpus : 0;
+	while ((opt = getopt(argc, argv, "dw:c:p:k:s:i:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd':
+				decrypt = true;
+				break;
+			case 'w':
+				config.numWorkers = (uint32_t)strtoul(optarg, NULL, 0);
+				break;
+			case 'c':
+				chunkSize = (uint32_t)strtoul(optarg, NULL, 0);
+				break;
+			case 'p':
+				pcpSize = atoi(optarg);
+				break;
+			case 'k':
+				keyLabel = atoi(optarg);
+				break;
+			case 's':
+				source = optarg;
+				if (strchr(source, ':') != NULL)
+				{
+					sourcePort = atoi(strchr(source, ':') + 1);
+					*strchr(source, ':') = '\0';
+				}
+				break;
+			case 'i':
+				indexPath = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+	if (argc - optind != 2)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	int inFd = open(argv[optind], O_RDONLY);
+	int outFd = (strcmp(argv[optind + 1], "-") == 0) ? STDOUT_FILENO :
+	            open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (inFd < 0 || outFd < 0)
+	{
+		perror((inFd < 0) ? argv[optind] : argv[optind + 1]);
+		return 1;
+	}
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitializeEx(&config) != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "could not initialize the DTCP Manager with %u workers\n", config.numWorkers);
+		return 1;
+	}
+	DTCP_SESSION_HANDLE session;
+	dtcp_result_t ret = decrypt ?
+	                    DTCPMgrCreateSinkSession((char *)((source != NULL) ? source : "127.0.0.1"), sourcePort, 0, 0, &session) :
+	                    DTCPMgrCreateSourceSession((char *)"127.0.0.1", keyLabel, pcpSize, 0, &session);
+	if (ret != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "could not create the %s session: %d\n", decrypt ? "sink" : "source", ret);
+		return 1;
+	}
+	if (indexPath != NULL && DTCPMgrStartPcpIndex(session) != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "could not start the PCP index\n");
+		return 1;
+	}
+
+	DTCPIP_FileStats stats;
+	ret = DTCPMgrProcessFile(session, inFd, outFd, chunkSize, &stats);
+	if (ret != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "%s failed after %llu bytes: %d\n", decrypt ? "decryption" : "encryption",
+		        (unsigned long long)stats.bytesIn, ret);
+		return 1;
+	}
+	if (indexPath != NULL && !writeIndex(session, indexPath))
+	{
+		fprintf(stderr, "could not write the PCP index to %s\n", indexPath);
+		return 1;
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	if (outFd != STDOUT_FILENO && close(outFd) != 0)
+	{
+		perror(argv[optind + 1]);
+		return 1;
+	}
+	close(inFd);
+
+	double seconds = stats.elapsedNs / 1e9;
+	fprintf(stderr, "%s %llu bytes to %llu bytes in %.3f s, %.1f MB/s with %u workers\n",
+	        decrypt ? "decrypted" : "encrypted", (unsigned long long)stats.bytesIn,
+	        (unsigned long long)stats.bytesOut, seconds, (seconds > 0) ? stats.bytesIn / seconds / 1e6 : 0.0,
+	        config.numWorkers);
+	return 0;
+}
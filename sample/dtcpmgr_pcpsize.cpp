@@ -0,0 +1,124 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * PCP size benchmark for the DTCP Manager.
+ *
+ * Encrypts ten seconds of a synthetic transport stream, with a PCR every
+ * 40 ms, at several bitrates and in buffers of seven TS packets as they
+ * come off a UDP socket. Compares one PCP per buffer, a fixed 64 KiB
+ * PCPPacketSize and DTCPIP_PCP_SIZE_ADAPTIVE by the stream time a PCP
+ * spans, which a sink that checks whole PCPs waits for, and the bytes added
+ * by headers and padding. The stream is left open, so the padding that
+ * completes the last PCP at the end of a stream is not counted. Results go
+ * to stderr.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define PCPSIZE_TS_PACKET   188
+#define PCPSIZE_BUFFER      (7 * PCPSIZE_TS_PACKET)
+#define PCPSIZE_SECONDS     10
+#define PCPSIZE_PCR_PERIOD  0.04
+#define PCPSIZE_PCR_PID     0x100
+
+/* Builds @a seconds of TS at @a bitsPerSecond, PCRs on PCPSIZE_PCR_PID. */
+static void buildStream(uint32_t bitsPerSecond, std::vector<uint8_t> &stream)
+{
+	uint64_t packets = (uint64_t)bitsPerSecond / 8 * PCPSIZE_SECONDS / PCPSIZE_TS_PACKET;
+	uint64_t packetsPerPcr = (uint64_t)(bitsPerSecond / 8 * PCPSIZE_PCR_PERIOD / PCPSIZE_TS_PACKET);
+	stream.assign(packets * PCPSIZE_TS_PACKET, 0xFF);
+	for (uint64_t i = 0; i < packets; i++)
+	{
+		uint8_t *ts = &stream[i * PCPSIZE_TS_PACKET];
+		bool pcr = packetsPerPcr == 0 || i % packetsPerPcr == 0;
+		ts[0] = 0x47;
+		ts[1] = pcr ? (PCPSIZE_PCR_PID >> 8) : 0x01;
+		ts[2] = pcr ? (PCPSIZE_PCR_PID & 0xFF) : 0x01;
+		ts[3] = pcr ? 0x30 : 0x10;
+		if (pcr)
+		{
+			/* PCR of the packet's position at the nominal bitrate. */
+			uint64_t value = i * PCPSIZE_TS_PACKET * 8ULL * 27000000ULL / bitsPerSecond;
+			uint64_t base = value / 300;
+			uint32_t ext = (uint32_t)(value % 300);
+			ts[4] = 7;
+			ts[5] = 0x10;
+			ts[6] = (uint8_t)(base >> 25);
+			ts[7] = (uint8_t)(base >> 17);
+			ts[8] = (uint8_t)(base >> 9);
+			ts[9] = (uint8_t)(base >> 1);
+			ts[10] = (uint8_t)(((base & 1) << 7) | 0x7E | (ext >> 8));
+			ts[11] = (uint8_t)ext;
+		}
+	}
+}
+
+static bool run(const char *name, int pcpPacketSize, uint32_t bitsPerSecond, const std::vector<uint8_t> &stream)
+{
+	DTCP_SESSION_HANDLE session;
+	DTCPIP_SessionStats stats;
+	DTCPIP_Session info;
+	bool ok = DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, pcpPacketSize, PCPSIZE_BUFFER, &session) == DTCP_SUCCESS;
+	for (size_t offset = 0; ok && offset < stream.size(); offset += PCPSIZE_BUFFER)
+	{
+		DTCPIP_Packet packet;
+		memset(&packet, 0, sizeof(packet));
+		packet.session = session;
+		packet.dataInPtr = (uint8_t *)&stream[offset];
+		packet.dataLength = (uint32_t)((stream.size() - offset < PCPSIZE_BUFFER) ? stream.size() - offset : PCPSIZE_BUFFER);
+		ok = DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS;
+		DTCPMgrReleasePacket(&packet);
+	}
+	ok = ok && DTCPMgrGetSessionStats(session, &stats) == DTCP_SUCCESS &&
+	     DTCPMgrGetSessionInfo(session, &info) == DTCP_SUCCESS;
+	DTCPMgrDeleteDTCPSession(session);
+	if (!ok || stats.pcps == 0)
+	{
+		fprintf(stderr, "%8.1f %-16s failed\n", bitsPerSecond / 1e6, name);
+		return false;
+	}
+	fprintf(stderr, "%8.1f %-16s %10d %10.1f %10.3f\n", bitsPerSecond / 1e6, name, info.PCPPacketSize,
+	        PCPSIZE_SECONDS * 1e3 / stats.pcps, 100.0 * (stats.bytesOut - stats.bytesIn) / stats.bytesIn);
+	return true;
+}
+
+int main(void)
+{
+	static const uint32_t bitrates[] = { 256000, 2000000, 8000000, 20000000, 80000000 };
+	std::vector<uint8_t> stream;
+	bool ok = true;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	fprintf(stderr, "%8s %-16s %10s %10s %10s\n", "Mbit/s", "PCPPacketSize", "final", "PCP ms", "overhead %");
+	for (size_t i = 0; i < sizeof(bitrates) / sizeof(bitrates[0]); i++)
+	{
+		buildStream(bitrates[i], stream);
+		ok = run("0", 0, bitrates[i], stream) && ok;
+		ok = run("65536", 65536, bitrates[i], stream) && ok;
+		ok = run("adaptive", DTCPIP_PCP_SIZE_ADAPTIVE, bitrates[i], stream) && ok;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Nc rotation benchmark for the DTCP Manager.
+ *
+ * Encrypts a stream of 64 KiB buffers, one PCP each, so that Nc changes
+ * every DTCP_NC_UPDATE_BYTES, and times every DTCPMgrProcessPacket() call.
+ * Calls whose PCP carries a new Nc are reported apart from the others. The
+ * content key derivation is replaced with one that waits ROTATE_LADDER_US
+ * per key, standing in for a key ladder in a secure processor; that hook is
+ * internal, so this program includes dtcppcp.h. Latencies in microseconds
+ * go to stderr.
+ */
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+#include "dtcppcp.h"
+
+#define ROTATE_PACKET_SIZE (64 * 1024)
+#define ROTATE_ROTATIONS   16
+
+static uint32_t ladderUs = 0;
+
+static double nowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void ladderContentKey(const uint8_t *exchangeKey, uint8_t emi, uint64_t nc, uint8_t *contentKey, uint8_t *iv)
+{
+	if (ladderUs > 0)
+	{
+		usleep(ladderUs);
+	}
+	for (int i = 0; i < DTCP_AES_BLOCK_SIZE; i++)
+	{
+		contentKey[i] = exchangeKey[i] ^ (uint8_t)(nc >> ((i % 8) * 8)) ^ emi;
+		iv[i] = contentKey[i] ^ 0x5A;
+	}
+}
+
+static uint64_t headerNc(const uint8_t *header)
+{
+	uint64_t nc = 0;
+	for (int i = 2; i < 10; i++)
+	{
+		nc = (nc << 8) | header[i];
+	}
+	return nc;
+}
+
+static void printRow(const char *name, std::vector<double> &latency)
+{
+	std::sort(latency.begin(), latency.end());
+	size_t n = latency.size();
+	fprintf(stderr, "  %-22s %8zu %10.1f %10.1f %10.1f\n", name, n, latency[n / 2], latency[n * 99 / 100], latency[n - 1]);
+}
+
+static bool run(uint32_t ladder, std::vector<uint8_t> &data)
+{
+	std::vector<double> rotating;
+	std::vector<double> others;
+	DTCP_SESSION_HANDLE session;
+	uint32_t count = (uint32_t)((uint64_t)DTCP_NC_UPDATE_BYTES * ROTATE_ROTATIONS / ROTATE_PACKET_SIZE) + 1;
+	uint64_t lastNc = 0;
+
+	ladderUs = ladder;
+	if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, 0, ROTATE_PACKET_SIZE, &session) != DTCP_SUCCESS)
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		DTCPIP_Packet packet;
+		memset(&packet, 0, sizeof(packet));
+		packet.session = session;
+		packet.dataInPtr = &data[0];
+		packet.dataLength = ROTATE_PACKET_SIZE;
+		double start = nowUs();
+		if (DTCPMgrProcessPacket(session, &packet) != DTCP_SUCCESS || packet.pcpHeader == NULL)
+		{
+			DTCPMgrDeleteDTCPSession(session);
+			return false;
+		}
+		double elapsed = nowUs() - start;
+		uint64_t nc = headerNc(packet.pcpHeader);
+		if (i > 0)
+		{
+			/* The first packet derives the session's first key, which nothing could have prepared. */
+			(nc != lastNc ? rotating : others).push_back(elapsed);
+		}
+		lastNc = nc;
+		DTCPMgrReleasePacket(&packet);
+	}
+	DTCPMgrDeleteDTCPSession(session);
+
+	fprintf(stderr, "key ladder %u us\n", ladder);
+	printRow("Nc changed", rotating);
+	printRow("same Nc", others);
+	return !rotating.empty();
+}
+
+int main(void)
+{
+	static const uint32_t ladders[] = { 0, 500, 2000 };
+	std::vector<uint8_t> data(ROTATE_PACKET_SIZE, 0x47);
+	bool ok = true;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	DTCPPcpSetContentKeyFunc(ladderContentKey);
+	fprintf(stderr, "DTCPMgrProcessPacket() latency, us\n");
+	fprintf(stderr, "  %-22s %8s %10s %10s %10s\n", "", "calls", "p50", "p99", "max");
+	for (size_t i = 0; i < sizeof(ladders) / sizeof(ladders[0]); i++)
+	{
+		ok = run(ladders[i], data) && ok;
+	}
+	DTCPPcpSetContentKeyFunc(NULL);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Scaling benchmark for the DTCP Manager worker pool.
+ *
+ * Encrypts the same amount of data with 1 to N workers (N defaults to the
+ * number of online CPUs, or the first argument) over 1 to 16 concurrent
+ * source sessions, submitting with DTCPMgrSubmitPacket() and completing
+ * with DTCPMgrCompletePacket() from a single thread. The worker pool is
+ * fixed for the life of the process, so every worker count runs in a
+ * child process of its own. Throughput in MB/s is written to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define SCALE_PACKET_SIZE  (188 * 348)
+#define SCALE_PCP_SIZE     (SCALE_PACKET_SIZE * 4)
+#define SCALE_WINDOW       32
+#define SCALE_TOTAL_BYTES  (256 * 1024 * 1024)
+#define SCALE_MAX_SESSIONS 16
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Completes the oldest packet of @a session; returns false on error. */
+static bool completeOne(DTCP_SESSION_HANDLE session)
+{
+	DTCPIP_Packet *packet;
+	dtcp_result_t result;
+	if (DTCPMgrCompletePacket(session, -1, &packet, &result) != DTCP_SUCCESS || result != DTCP_SUCCESS)
+	{
+		return false;
+	}
+	DTCPMgrReleasePacket(packet);
+	return true;
+}
+
+static double runSessions(uint32_t numSessions, std::vector<uint8_t> &data)
+{
+	DTCP_SESSION_HANDLE sessions[SCALE_MAX_SESSIONS];
+	std::vector<DTCPIP_Packet> packets((size_t)numSessions * SCALE_WINDOW);
+	uint32_t count = SCALE_TOTAL_BYTES / SCALE_PACKET_SIZE;
+
+	for (uint32_t s = 0; s < numSessions; s++)
+	{
+		if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", 0, SCALE_PCP_SIZE, SCALE_PACKET_SIZE, &sessions[s]) !=
+		    DTCP_SUCCESS)
+		{
+			return -1;
+		}
+	}
+
+	double start = nowNs();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t s = i % numSessions;
+		uint32_t n = i / numSessions;
+		DTCPIP_Packet *packet = &packets[s * SCALE_WINDOW + n % SCALE_WINDOW];
+		if (n >= SCALE_WINDOW && !completeOne(sessions[s]))
+		{
+			return -1;
+		}
+		memset(packet, 0, sizeof(*packet));
+		packet->session = sessions[s];
+		packet->dataInPtr = &data[(n % SCALE_WINDOW) * SCALE_PACKET_SIZE];
+		packet->dataLength = SCALE_PACKET_SIZE;
+		packet->pcpHeaderOffset = -1;
+		if (DTCPMgrSubmitPacket(sessions[s], packet) != DTCP_SUCCESS)
+		{
+			return -1;
+		}
+	}
+	for (uint32_t s = 0; s < numSessions; s++)
+	{
+		uint32_t outstanding = count / numSessions + (s < count % numSessions ? 1 : 0);
+		for (uint32_t n = 0; n < outstanding && n < SCALE_WINDOW; n++)
+		{
+			if (!completeOne(sessions[s]))
+			{
+				return -1;
+			}
+		}
+	}
+	double elapsed = nowNs() - start;
+
+	for (uint32_t s = 0; s < numSessions; s++)
+	{
+		DTCPMgrDeleteDTCPSession(sessions[s]);
+	}
+	return (double)count * SCALE_PACKET_SIZE / (elapsed / 1e9) / (1024 * 1024);
+}
+
+static int runWorkers(uint32_t numWorkers)
+{
+	static const uint32_t sessionCounts[] = { 1, 2, 4, 8, 16 };
+	DTCPIP_Config config;
+	std::vector<uint8_t> data((size_t)SCALE_PACKET_SIZE * SCALE_WINDOW, 0x47);
+
+	/* Keeps the library's console output away from the table on stderr. */
+	if (freopen("/dev/null", "w", stdout) == NULL)
+	{
+		return 1;
+	}
+	memset(&config, 0, sizeof(config));
+	config.numWorkers = numWorkers;
+	if (DTCPMgrInitializeEx(&config) != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "%8u  failed to start the worker pool\n", numWorkers);
+		return 1;
+	}
+	fprintf(stderr, "%8u", numWorkers);
+	for (size_t i = 0; i < sizeof(sessionCounts) / sizeof(sessionCounts[0]); i++)
+	{
+		double rate = runSessions(sessionCounts[i], data);
+		if (rate < 0)
+		{
+			fprintf(stderr, "  failed\n");
+			return 1;
+		}
+		fprintf(stderr, " %10.1f", rate);
+	}
+	fprintf(stderr, "\n");
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	long maxWorkers = (argc > 1) ? atol(argv[1]) : sysconf(_SC_NPROCESSORS_ONLN);
+	int failed = 0;
+
+	if (maxWorkers < 1)
+	{
+		maxWorkers = 1;
+	}
+	fprintf(stderr, "MB/s by workers (rows) and concurrent sessions (columns)\n");
+	fprintf(stderr, "%8s %10s %10s %10s %10s %10s\n", "workers", "1", "2", "4", "8", "16");
+	for (long workers = 1; workers > 0; )
+	{
+		pid_t pid = fork();
+		int status = 0;
+		if (pid == 0)
+		{
+			_exit(runWorkers((uint32_t)workers));
+		}
+		if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			failed = 1;
+		}
+		/* Doubles up to the maximum, which always gets a row of its own. */
+		workers = (workers == maxWorkers) ? 0 : (workers * 2 < maxWorkers ? workers * 2 : maxWorkers);
+	}
+	return failed;
+}
@@ -0,0 +1,250 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Recording seek benchmark for the DTCP Manager.
+ *
+ * Records transport streams of growing size to a temporary file, encrypted
+ * by a source session that builds a PCP index, then seeks to 90% of each
+ * recording and times until the first TS packet there is decrypted: once by
+ * decrypting the file from the start, as a sink without an index has to,
+ * and once with DTCPMgrSeekSinkSession() and the index. The file is read
+ * with pread(), mostly from the page cache. Results in milliseconds go to
+ * stderr.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define SEEK_BUFFER   (188 * 348)
+#define SEEK_READ     (64 * 1024)
+/* Sidecar layout, see DTCPMgrGetPcpIndex(). */
+#define SEEK_INDEX_HEADER 8
+#define SEEK_INDEX_ENTRY  22
+
+static double nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Encrypts @a bytes of TS to @a fd; returns the PCP index, empty on failure. */
+static std::vector<uint8_t> record(int fd, uint64_t bytes)
+{
+	std::vector<uint8_t> content(SEEK_BUFFER, 0xFF);
+	std::vector<uint8_t> index;
+	DTCP_SESSION_HANDLE session;
+	bool ok = DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, 0, SEEK_BUFFER, &session) == DTCP_SUCCESS &&
+	          DTCPMgrStartPcpIndex(session) == DTCP_SUCCESS;
+	for (uint32_t i = 0; i < SEEK_BUFFER; i += 188)
+	{
+		content[i] = 0x47;
+	}
+	for (uint64_t done = 0; ok && done < bytes; done += SEEK_BUFFER)
+	{
+		DTCPIP_Packet packet;
+		struct iovec segments[DTCPIP_MAX_PACKET_SEGMENTS];
+		uint32_t numSegments;
+		memset(&packet, 0, sizeof(packet));
+		packet.session = session;
+		packet.dataInPtr = &content[0];
+		packet.dataLength = SEEK_BUFFER;
+		ok = DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS &&
+		     DTCPMgrGetPacketSegments(&packet, segments, DTCPIP_MAX_PACKET_SEGMENTS, &numSegments) == DTCP_SUCCESS;
+		for (uint32_t s = 0; ok && s < numSegments; s++)
+		{
+			ok = write(fd, segments[s].iov_base, segments[s].iov_len) == (ssize_t)segments[s].iov_len;
+		}
+		DTCPMgrReleasePacket(&packet);
+	}
+	uint32_t length = 0;
+	if (ok && DTCPMgrGetPcpIndex(session, NULL, 0, &length) == DTCP_SUCCESS)
+	{
+		index.resize(length);
+		if (DTCPMgrGetPcpIndex(session, &index[0], length, &length) != DTCP_SUCCESS)
+		{
+			index.clear();
+		}
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	return index;
+}
+
+/* Encrypts with submitted and synchronous calls mixed; returns whether the index has an entry per PCP. */
+static bool checkMixedIndex(void)
+{
+	std::vector<uint8_t> content(188 * 64, 0x47);
+	DTCPIP_Packet packets[4];
+	DTCP_SESSION_HANDLE session;
+	bool ok = DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, 0, (uint32_t)content.size(), &session) == DTCP_SUCCESS &&
+	          DTCPMgrStartPcpIndex(session) == DTCP_SUCCESS;
+	for (int round = 0; ok && round < 16; round++)
+	{
+		uint32_t count = (round % 2 == 0) ? 4 : 1;
+		for (uint32_t i = 0; ok && i < count; i++)
+		{
+			memset(&packets[i], 0, sizeof(packets[i]));
+			packets[i].session = session;
+			packets[i].dataInPtr = &content[0];
+			packets[i].dataLength = (uint32_t)content.size();
+			ok = (round % 2 == 0 ? DTCPMgrSubmitPacket(session, &packets[i]) :
+			      DTCPMgrProcessPacket(session, &packets[i])) == DTCP_SUCCESS;
+		}
+		for (uint32_t i = 0; ok && i < count; i++)
+		{
+			DTCPIP_Packet *packet = &packets[i];
+			dtcp_result_t result = DTCP_SUCCESS;
+			if (round % 2 == 0)
+			{
+				ok = DTCPMgrCompletePacket(session, -1, &packet, &result) == DTCP_SUCCESS && result == DTCP_SUCCESS;
+			}
+			if (ok)
+			{
+				DTCPMgrReleasePacket(packet);
+			}
+		}
+	}
+	DTCPIP_SessionStats stats;
+	uint32_t length = 0;
+	ok = ok && DTCPMgrGetSessionStats(session, &stats) == DTCP_SUCCESS &&
+	     DTCPMgrGetPcpIndex(session, NULL, 0, &length) == DTCP_SUCCESS && length >= SEEK_INDEX_HEADER;
+	if (ok)
+	{
+		uint32_t entries = (length - SEEK_INDEX_HEADER) / SEEK_INDEX_ENTRY;
+		if (entries != stats.pcps)
+		{
+			fprintf(stderr, "index has %u entries for %llu PCPs\n", entries, (unsigned long long)stats.pcps);
+			ok = false;
+		}
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	return ok;
+}
+
+/* Decrypts from @a readOffset until output past @a skip bytes holds a TS packet; returns ms or -1. */
+static double firstPacket(int fd, DTCP_SESSION_HANDLE sink, uint64_t readOffset, uint64_t skip, double start)
+{
+	std::vector<uint8_t> buffer(SEEK_READ);
+	for (;;)
+	{
+		ssize_t n = pread(fd, &buffer[0], SEEK_READ, (off_t)readOffset);
+		if (n <= 0)
+		{
+			return -1;
+		}
+		readOffset += (uint64_t)n;
+		DTCPIP_Packet packet;
+		memset(&packet, 0, sizeof(packet));
+		packet.session = sink;
+		packet.dataInPtr = &buffer[0];
+		packet.dataLength = (uint32_t)n;
+		if (DTCPMgrProcessPacket(sink, &packet) != DTCP_SUCCESS)
+		{
+			return -1;
+		}
+		for (uint32_t i = 0; i < packet.dataLength; i++)
+		{
+			if (skip > 0)
+			{
+				skip--;
+				continue;
+			}
+			if (packet.dataOutPtr[i] == 0x47 && i + 188 < packet.dataLength && packet.dataOutPtr[i + 188] == 0x47)
+			{
+				DTCPMgrReleasePacket(&packet);
+				return nowMs() - start;
+			}
+		}
+		DTCPMgrReleasePacket(&packet);
+	}
+}
+
+static bool run(uint64_t bytes)
+{
+	char path[] = "/tmp/dtcpmgr_seek.XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0)
+	{
+		return false;
+	}
+	unlink(path);
+	std::vector<uint8_t> index = record(fd, bytes);
+	uint64_t size = (uint64_t)lseek(fd, 0, SEEK_END);
+	uint64_t target = size / 10 * 9;
+	DTCP_SESSION_HANDLE sink;
+	double scan = -1;
+	double seek = -1;
+
+	if (!index.empty() && DTCPMgrCreateSinkSession((char *)"127.0.0.1", 0, 0, 0, &sink) == DTCP_SUCCESS)
+	{
+		/* Without an index, the content before the target is decrypted and dropped. */
+		double start = nowMs();
+		scan = firstPacket(fd, sink, 0, target / SEEK_BUFFER * SEEK_BUFFER, start);
+		DTCPMgrDeleteDTCPSession(sink);
+	}
+	if (!index.empty() && DTCPMgrCreateSinkSession((char *)"127.0.0.1", 0, 0, 0, &sink) == DTCP_SUCCESS)
+	{
+		uint64_t readOffset;
+		double start = nowMs();
+		if (DTCPMgrSeekSinkSession(sink, &index[0], (uint32_t)index.size(), target, &readOffset) == DTCP_SUCCESS)
+		{
+			seek = firstPacket(fd, sink, readOffset, 0, start);
+		}
+		DTCPMgrDeleteDTCPSession(sink);
+	}
+	close(fd);
+	if (scan < 0 || seek < 0)
+	{
+		fprintf(stderr, "%10llu failed\n", (unsigned long long)(bytes >> 20));
+		return false;
+	}
+	fprintf(stderr, "%10llu %10u %12.2f %12.3f\n", (unsigned long long)(bytes >> 20), (uint32_t)(index.size() >> 10),
+	        scan, seek);
+	return true;
+}
+
+int main(void)
+{
+	static const uint64_t sizes[] = { 64ULL << 20, 256ULL << 20, 1024ULL << 20, 2048ULL << 20 };
+	bool ok = true;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	if (!checkMixedIndex())
+	{
+		fprintf(stderr, "PCP index incomplete after submitted packets\n");
+		return 1;
+	}
+	fprintf(stderr, "time to the first TS packet at 90%% of a recording, ms\n");
+	fprintf(stderr, "%10s %10s %12s %12s\n", "MiB", "index KiB", "from start", "with index");
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		ok = run(sizes[i]) && ok;
+	}
+	return ok ? 0 : 1;
+}
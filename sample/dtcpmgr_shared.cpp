@@ -0,0 +1,142 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Shared stream benchmark for the DTCP Manager.
+ *
+ * Serves one live channel to 1 to 8 sinks, first with a source session per
+ * sink that encrypts every buffer itself, then with the sinks' sessions
+ * joined to a shared stream that encrypts each buffer once. Source CPU time
+ * in ms per second of a 20 Mbit/s channel goes to stderr.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define SHARED_PACKET_SIZE (188 * 348)
+#define SHARED_PCP_SIZE    (SHARED_PACKET_SIZE * 4)
+#define SHARED_TOTAL_BYTES (128 * 1024 * 1024)
+#define SHARED_MAX_VIEWERS 8
+#define SHARED_CHANNEL_BPS (20 * 1000 * 1000 / 8)
+
+static double cpuMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Returns CPU ms per second of channel, or a negative value on failure. */
+static double runViewers(uint32_t viewers, bool shared, std::vector<uint8_t> &data)
+{
+	DTCP_SESSION_HANDLE sessions[SHARED_MAX_VIEWERS];
+	DTCP_SESSION_HANDLE stream = 0;
+	DTCPIP_Packet memberPackets[DTCPIP_MAX_SHARED_MEMBERS];
+	uint32_t count = SHARED_TOTAL_BYTES / SHARED_PACKET_SIZE;
+	bool ok = true;
+
+	if (shared && DTCPMgrCreateSharedStream(-1, SHARED_PCP_SIZE, SHARED_PACKET_SIZE, &stream) != DTCP_SUCCESS)
+	{
+		return -1;
+	}
+	for (uint32_t v = 0; v < viewers; v++)
+	{
+		if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, SHARED_PCP_SIZE, SHARED_PACKET_SIZE, &sessions[v]) !=
+		    DTCP_SUCCESS || (shared && DTCPMgrJoinSharedStream(stream, sessions[v]) != DTCP_SUCCESS))
+		{
+			return -1;
+		}
+	}
+
+	double start = cpuMs();
+	for (uint32_t i = 0; i < count && ok; i++)
+	{
+		DTCPIP_Packet packet;
+		memset(&packet, 0, sizeof(packet));
+		packet.dataInPtr = &data[0];
+		packet.dataLength = SHARED_PACKET_SIZE;
+		if (shared)
+		{
+			uint32_t numMembers = 0;
+			packet.session = stream;
+			ok = DTCPMgrProcessSharedPacket(stream, &packet, memberPackets, DTCPIP_MAX_SHARED_MEMBERS, &numMembers) ==
+			     DTCP_SUCCESS && numMembers == viewers;
+			for (uint32_t m = 0; m < numMembers; m++)
+			{
+				DTCPMgrReleasePacket(&memberPackets[m]);
+			}
+			DTCPMgrReleasePacket(&packet);
+			continue;
+		}
+		for (uint32_t v = 0; v < viewers && ok; v++)
+		{
+			packet.session = sessions[v];
+			packet.dataInPtr = &data[0];
+			packet.dataLength = SHARED_PACKET_SIZE;
+			ok = DTCPMgrProcessPacket(sessions[v], &packet) == DTCP_SUCCESS;
+			DTCPMgrReleasePacket(&packet);
+		}
+	}
+	double elapsed = cpuMs() - start;
+
+	for (uint32_t v = 0; v < viewers; v++)
+	{
+		DTCPMgrDeleteDTCPSession(sessions[v]);
+	}
+	if (shared)
+	{
+		DTCPMgrDeleteDTCPSession(stream);
+	}
+	return ok ? elapsed / ((double)count * SHARED_PACKET_SIZE / SHARED_CHANNEL_BPS) : -1;
+}
+
+int main(void)
+{
+	static const uint32_t viewerCounts[] = { 1, 2, 4, 8 };
+	std::vector<uint8_t> data(SHARED_PACKET_SIZE, 0x47);
+	int failed = 0;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	if (DTCPMgrCreateSharedStream(-1, SHARED_PCP_SIZE, SHARED_PACKET_SIZE, NULL) != DTCP_ERR_INVALID_PARAM)
+	{
+		fprintf(stderr, "shared stream created without a handle\n");
+		return 1;
+	}
+	fprintf(stderr, "source CPU ms per second of a 20 Mbit/s channel\n");
+	fprintf(stderr, "%8s %14s %14s\n", "viewers", "per session", "shared stream");
+	for (size_t i = 0; i < sizeof(viewerCounts) / sizeof(viewerCounts[0]); i++)
+	{
+		double separate = runViewers(viewerCounts[i], false, data);
+		double shared = runViewers(viewerCounts[i], true, data);
+		if (separate < 0 || shared < 0)
+		{
+			fprintf(stderr, "%8u failed\n", viewerCounts[i]);
+			failed = 1;
+			continue;
+		}
+		fprintf(stderr, "%8u %14.3f %14.3f\n", viewerCounts[i], separate, shared);
+	}
+	return failed;
+}
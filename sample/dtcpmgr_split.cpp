@@ -0,0 +1,167 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Split input check for the DTCP Manager sink.
+ *
+ * Encrypts random content with source sessions of several PCP sizes, then
+ * decrypts each PCP stream with a sink session fed in one buffer, and again
+ * in many runs fed in pieces split at random points: single bytes, points
+ * inside PCP headers and AES blocks, and large pieces. The output of every
+ * run must be byte-identical to the unsplit run and to the content; the
+ * first mismatch is reported with its seed and run, and fails the check.
+ *
+ * Usage: dtcpmgr_split [runs [seed]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define SPLIT_CONTENT_SIZE (512 * 1024)
+#define SPLIT_MAX_BUFFER   (64 * 1024)
+#define SPLIT_RUNS         100
+
+/* Encrypts @a content in buffers of random size; returns the PCP stream, empty on failure. */
+static std::vector<uint8_t> encrypt(const std::vector<uint8_t> &content, int pcpSize)
+{
+	std::vector<uint8_t> stream;
+	DTCP_SESSION_HANDLE session;
+	if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, pcpSize, SPLIT_MAX_BUFFER, &session) != DTCP_SUCCESS)
+	{
+		return stream;
+	}
+	bool ok = true;
+	for (size_t done = 0; ok && done < content.size(); )
+	{
+		DTCPIP_Packet packet;
+		struct iovec segments[DTCPIP_MAX_PACKET_SEGMENTS];
+		uint32_t numSegments;
+		uint32_t length = 1 + (uint32_t)(rand() % SPLIT_MAX_BUFFER);
+		if (length > content.size() - done)
+		{
+			length = (uint32_t)(content.size() - done);
+		}
+		memset(&packet, 0, sizeof(packet));
+		packet.session = session;
+		packet.dataInPtr = (uint8_t *)&content[done];
+		packet.dataLength = length;
+		packet.isEOF = (done + length == content.size());
+		ok = DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS &&
+		     DTCPMgrGetPacketSegments(&packet, segments, DTCPIP_MAX_PACKET_SEGMENTS, &numSegments) == DTCP_SUCCESS;
+		for (uint32_t s = 0; ok && s < numSegments; s++)
+		{
+			const uint8_t *base = (const uint8_t *)segments[s].iov_base;
+			stream.insert(stream.end(), base, base + segments[s].iov_len);
+		}
+		DTCPMgrReleasePacket(&packet);
+		done += length;
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	if (!ok)
+	{
+		stream.clear();
+	}
+	return stream;
+}
+
+/* Mostly small pieces, so that headers and AES blocks are split, with some large ones in between. */
+static uint32_t pieceSize(void)
+{
+	static const uint32_t limits[] = { 16, 200, 4096, SPLIT_MAX_BUFFER };
+	return 1 + (uint32_t)(rand() % limits[rand() % 4]);
+}
+
+/* Decrypts @a stream fed in pieces (all of it at once if @a split is false); returns false on an error. */
+static bool decrypt(const std::vector<uint8_t> &stream, bool split, std::vector<uint8_t> *out)
+{
+	DTCP_SESSION_HANDLE session;
+	if (DTCPMgrCreateSinkSession((char *)"127.0.0.1", 0, 0, 0, &session) != DTCP_SUCCESS)
+	{
+		return false;
+	}
+	bool ok = true;
+	out->clear();
+	for (size_t done = 0; ok && done < stream.size(); )
+	{
+		DTCPIP_Packet packet;
+		uint32_t length = split ? pieceSize() : (uint32_t)stream.size();
+		if (length > stream.size() - done)
+		{
+			length = (uint32_t)(stream.size() - done);
+		}
+		memset(&packet, 0, sizeof(packet));
+		packet.session = session;
+		packet.dataInPtr = (uint8_t *)&stream[done];
+		packet.dataLength = length;
+		ok = DTCPMgrProcessPacket(session, &packet) == DTCP_SUCCESS;
+		if (ok)
+		{
+			out->insert(out->end(), packet.dataOutPtr, packet.dataOutPtr + packet.dataLength);
+			DTCPMgrReleasePacket(&packet);
+		}
+		done += length;
+	}
+	DTCPMgrDeleteDTCPSession(session);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	static const int pcpSizes[] = { 0, 4096, 100000 };
+	int runs = (argc > 1) ? atoi(argv[1]) : SPLIT_RUNS;
+	unsigned int seed = (argc > 2) ? (unsigned int)strtoul(argv[2], NULL, 0) : 1;
+	std::vector<uint8_t> content(SPLIT_CONTENT_SIZE);
+	std::vector<uint8_t> whole;
+	std::vector<uint8_t> pieces;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	srand(seed);
+	for (size_t i = 0; i < content.size(); i++)
+	{
+		content[i] = (uint8_t)rand();
+	}
+	for (size_t p = 0; p < sizeof(pcpSizes) / sizeof(pcpSizes[0]); p++)
+	{
+		std::vector<uint8_t> stream = encrypt(content, pcpSizes[p]);
+		if (stream.empty() || !decrypt(stream, false, &whole) || whole != content)
+		{
+			fprintf(stderr, "PCP size %d: the unsplit stream does not decrypt to the content\n", pcpSizes[p]);
+			return 1;
+		}
+		for (int run = 0; run < runs; run++)
+		{
+			if (!decrypt(stream, true, &pieces) || pieces != whole)
+			{
+				fprintf(stderr, "PCP size %d, seed %u, run %d: split input decrypts differently\n", pcpSizes[p], seed,
+				        run);
+				return 1;
+			}
+		}
+		fprintf(stderr, "PCP size %6d: %u byte stream, %d split runs identical\n", pcpSizes[p],
+		        (unsigned)stream.size(), runs);
+	}
+	return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * SRM revocation check benchmark for the DTCP Manager.
+ *
+ * Builds a synthetic SRM of 10000 CRL entries, 9000 device IDs and 1000
+ * ranges of up to 64 IDs spread over the 40 bit ID space, and times a device
+ * ID check three ways: a scan of the SRM as distributed, the sorted range
+ * index, and the index behind its Bloom filter. Checks of devices that are
+ * not revoked, the case of nearly every AKE, and of revoked ones are timed
+ * separately. Results in ns per check go to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "dtcpsrm.h"
+
+#define SRM_IDS     9000
+#define SRM_RANGES  1000
+#define SRM_CHECKS  200000
+#define SRM_SCANS   2000      /* The scan is slow, so it checks fewer IDs. */
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t randomId(void)
+{
+	return (((uint64_t)rand() << 31) ^ (uint64_t)rand()) & ((1ULL << 40) - 1);
+}
+
+static void putId(uint8_t *p, uint64_t id)
+{
+	for (int i = 4; i >= 0; i--)
+	{
+		p[i] = (uint8_t)id;
+		id >>= 8;
+	}
+}
+
+static uint64_t getId(const uint8_t *p)
+{
+	uint64_t id = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		id = (id << 8) | p[i];
+	}
+	return id;
+}
+
+static std::vector<uint8_t> buildSrm(std::vector<uint64_t> *revoked)
+{
+	std::vector<uint8_t> srm(DTCP_SRM_HEADER_SIZE + 3 + SRM_IDS * 5 + 3 + SRM_RANGES * 7 + DTCP_SRM_SIGNATURE_SIZE, 0);
+	uint8_t *p = &srm[0];
+	p[0] = 0x01;
+	p[3] = 1;
+	p[5] = (uint8_t)((srm.size() - 5) >> 8);
+	p[6] = (uint8_t)(srm.size() - 5);
+	p += DTCP_SRM_HEADER_SIZE;
+	p[0] = 0;
+	p[1] = SRM_IDS >> 8;
+	p[2] = SRM_IDS & 0xFF;
+	p += 3;
+	for (int i = 0; i < SRM_IDS; i++, p += 5)
+	{
+		uint64_t id = randomId();
+		putId(p, id);
+		revoked->push_back(id);
+	}
+	p[0] = 1;
+	p[1] = SRM_RANGES >> 8;
+	p[2] = SRM_RANGES & 0xFF;
+	p += 3;
+	for (int i = 0; i < SRM_RANGES; i++, p += 7)
+	{
+		uint64_t id = randomId();
+		putId(p, id);
+		p[5] = 0;
+		p[6] = (uint8_t)(rand() % 64);
+		revoked->push_back(id + p[6]);
+	}
+	return srm;
+}
+
+/* What a check without an index does: walk the CRL entries of the SRM. */
+static bool scanSrm(const std::vector<uint8_t> &srm, uint64_t id)
+{
+	const uint8_t *p = &srm[DTCP_SRM_HEADER_SIZE];
+	const uint8_t *end = &srm[0] + srm.size() - DTCP_SRM_SIGNATURE_SIZE;
+	while (p < end)
+	{
+		uint8_t type = p[0];
+		uint32_t count = (p[1] << 8) | p[2];
+		p += 3;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint64_t first = getId(p);
+			uint64_t last = first + ((type == 1) ? ((p[5] << 8) | p[6]) : 0);
+			if (id >= first && id <= last)
+			{
+				return true;
+			}
+			p += (type == 1) ? 7 : 5;
+		}
+	}
+	return false;
+}
+
+typedef bool (*checkFunc)(const void *arg, uint64_t id);
+
+static bool scanCheck(const void *arg, uint64_t id)
+{
+	return scanSrm(*(const std::vector<uint8_t> *)arg, id);
+}
+
+static bool indexCheck(const void *arg, uint64_t id)
+{
+	return DTCPSrmIndexRevoked((const DTCPSrmIndex *)arg, id);
+}
+
+/* Returns ns per check of @a ids, or a negative value if a result was wrong. */
+static double timeChecks(checkFunc check, const void *arg, const std::vector<uint64_t> &ids, size_t count, bool expected)
+{
+	size_t hits = 0;
+	double start = nowNs();
+	for (size_t i = 0; i < count; i++)
+	{
+		hits += check(arg, ids[(i * 7919) % ids.size()]) ? 1 : 0;
+	}
+	double elapsed = nowNs() - start;
+	/* A random ID is on the SRM with a chance of about 1 in 10^8. */
+	if ((expected && hits != count) || (!expected && hits > count / 1000))
+	{
+		return -1;
+	}
+	return elapsed / count;
+}
+
+int main(void)
+{
+	std::vector<uint64_t> revoked;
+	std::vector<uint64_t> clean;
+	DTCPSrmIndex *plain;
+	DTCPSrmIndex *bloom;
+
+	srand(20);
+	std::vector<uint8_t> srm = buildSrm(&revoked);
+	for (int i = 0; i < 4096; i++)
+	{
+		clean.push_back(randomId());
+	}
+
+	double start = nowNs();
+	dtcp_result_t ret = DTCPSrmIndexCreate(&srm[0], (uint32_t)srm.size(), false, &plain);
+	double plainBuild = nowNs() - start;
+	start = nowNs();
+	ret = (ret == DTCP_SUCCESS) ? DTCPSrmIndexCreate(&srm[0], (uint32_t)srm.size(), true, &bloom) : ret;
+	double bloomBuild = nowNs() - start;
+	if (ret != DTCP_SUCCESS)
+	{
+		fprintf(stderr, "could not index the SRM: %d\n", ret);
+		return 1;
+	}
+
+	double results[3][2] = {
+		{ timeChecks(scanCheck, &srm, clean, SRM_SCANS, false), timeChecks(scanCheck, &srm, revoked, SRM_SCANS, true) },
+		{ timeChecks(indexCheck, plain, clean, SRM_CHECKS, false), timeChecks(indexCheck, plain, revoked, SRM_CHECKS, true) },
+		{ timeChecks(indexCheck, bloom, clean, SRM_CHECKS, false), timeChecks(indexCheck, bloom, revoked, SRM_CHECKS, true) }
+	};
+	static const char *names[3] = { "scan of the SRM", "range index", "Bloom filter + index" };
+	bool ok = true;
+
+	fprintf(stderr, "check of a device ID against an SRM of %d entries, %u bytes, ns per check\n",
+	        SRM_IDS + SRM_RANGES, (uint32_t)srm.size());
+	fprintf(stderr, "%-22s %12s %12s %12s\n", "", "not revoked", "revoked", "build ms");
+	for (int i = 0; i < 3; i++)
+	{
+		if (results[i][0] < 0 || results[i][1] < 0)
+		{
+			fprintf(stderr, "%-22s wrong result\n", names[i]);
+			ok = false;
+			continue;
+		}
+		fprintf(stderr, "%-22s %12.1f %12.1f", names[i], results[i][0], results[i][1]);
+		if (i > 0)
+		{
+			fprintf(stderr, " %12.3f", ((i == 1) ? plainBuild : bloomBuild) / 1e6);
+		}
+		fprintf(stderr, "\n");
+	}
+	DTCPSrmIndexDestroy(plain);
+	DTCPSrmIndexDestroy(bloom);
+	return ok ? 0 : 1;
+}
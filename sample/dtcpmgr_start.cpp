@@ -0,0 +1,233 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Start-up benchmark for the DTCP Manager.
+ *
+ * Starts the Manager in a fresh process with a full size SRM, 11000 device
+ * IDs and 1000 ranges, first with no cache file (cold start) and then with
+ * the cache file the cold start left (warm start). For each it reports the
+ * time spent in DTCPMgrInitializeEx(), the time of the part deferred to the
+ * background, and the time until DTCPMgrWaitInitialized() returns, which is
+ * when the first AKE could start. Medians in microseconds go to stderr.
+ * A damaged cache file must be rebuilt, which is checked as well.
+ */
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define START_IDS    11000
+#define START_RANGES 1000
+#define START_RUNS   21
+
+typedef struct
+{
+	int              result;
+	uint64_t         readyNs;
+	DTCPIP_InitStats stats;
+} startResult;
+
+static uint64_t nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void putId(uint8_t *p, uint64_t id)
+{
+	for (int i = 4; i >= 0; i--)
+	{
+		p[i] = (uint8_t)id;
+		id >>= 8;
+	}
+}
+
+static uint64_t randomId(void)
+{
+	return (((uint64_t)rand() << 31) ^ (uint64_t)rand()) & ((1ULL << 40) - 1);
+}
+
+static std::vector<uint8_t> buildSrm(void)
+{
+	std::vector<uint8_t> srm(7 + 3 + START_IDS * 5 + 3 + START_RANGES * 7 + 40, 0);
+	uint8_t *p = &srm[0];
+	p[0] = 0x01;
+	p[3] = 1;
+	p[5] = (uint8_t)((srm.size() - 5) >> 8);
+	p[6] = (uint8_t)(srm.size() - 5);
+	p += 7;
+	p[1] = START_IDS >> 8;
+	p[2] = START_IDS & 0xFF;
+	p += 3;
+	for (int i = 0; i < START_IDS; i++, p += 5)
+	{
+		putId(p, randomId());
+	}
+	p[0] = 1;
+	p[1] = START_RANGES >> 8;
+	p[2] = START_RANGES & 0xFF;
+	p += 3;
+	for (int i = 0; i < START_RANGES; i++, p += 7)
+	{
+		putId(p, randomId());
+		p[6] = (uint8_t)(rand() % 64);
+	}
+	return srm;
+}
+
+/* Starts the Manager in a child process, as at boot; returns false if that failed. */
+static bool startOnce(const std::vector<uint8_t> &srm, const char *cachePath, startResult *result)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		return false;
+	}
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		DTCPIP_Config config;
+		startResult child;
+		memset(&config, 0, sizeof(config));
+		memset(&child, 0, sizeof(child));
+		config.srm = &srm[0];
+		config.srmLength = (uint32_t)srm.size();
+		config.cachePath = cachePath;
+		DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+		uint64_t start = nowNs();
+		child.result = DTCPMgrInitializeEx(&config);
+		if (child.result == DTCP_SUCCESS)
+		{
+			child.result = DTCPMgrWaitInitialized(&child.stats);
+		}
+		child.readyNs = nowNs() - start;
+		ssize_t written = write(fds[1], &child, sizeof(child));
+		_exit(written == (ssize_t)sizeof(child) ? 0 : 1);
+	}
+	close(fds[1]);
+	bool ok = pid > 0 && read(fds[0], result, sizeof(*result)) == (ssize_t)sizeof(*result);
+	close(fds[0]);
+	int status;
+	ok = pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+	return ok && result->result == DTCP_SUCCESS;
+}
+
+static uint64_t medianUs(std::vector<uint64_t> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2] / 1000;
+}
+
+static bool runStarts(const char *name, const std::vector<uint8_t> &srm, const char *cachePath, bool cold)
+{
+	std::vector<uint64_t> initialize, deferred, ready;
+	for (int i = 0; i < START_RUNS; i++)
+	{
+		startResult result;
+		if (cold)
+		{
+			unlink(cachePath);
+		}
+		if (!startOnce(srm, cachePath, &result) || (result.stats.cacheHit != 0) == cold)
+		{
+			fprintf(stderr, "%-6s failed\n", name);
+			return false;
+		}
+		initialize.push_back(result.stats.initializeNs);
+		deferred.push_back(result.stats.deferredNs);
+		ready.push_back(result.readyNs);
+	}
+	fprintf(stderr, "%-6s %14llu %14llu %14llu\n", name, (unsigned long long)medianUs(initialize),
+	        (unsigned long long)medianUs(deferred), (unsigned long long)medianUs(ready));
+	return true;
+}
+
+/* Flips a byte in the middle of the cache file; the next start must derive the tables again. */
+static bool checkDamagedCache(const std::vector<uint8_t> &srm, const char *cachePath)
+{
+	FILE *file = fopen(cachePath, "r+b");
+	if (file == NULL || fseek(file, 0, SEEK_END) != 0)
+	{
+		return false;
+	}
+	long middle = ftell(file) / 2;
+	int byte;
+	bool ok = fseek(file, middle, SEEK_SET) == 0 && (byte = fgetc(file)) != EOF && fseek(file, middle, SEEK_SET) == 0 &&
+	          fputc(byte ^ 0x01, file) != EOF;
+	ok = fclose(file) == 0 && ok;
+	startResult result;
+	return ok && startOnce(srm, cachePath, &result) && !result.stats.cacheHit &&
+	       startOnce(srm, cachePath, &result) && result.stats.cacheHit;
+}
+
+/* Initializes again after each stop; the SRM of each initialization must be the one taking effect. */
+static bool checkReinitialize(std::vector<uint8_t> srm)
+{
+	static const uint8_t versions[] = { 1, 1, 2, 1 };
+	static const dtcp_result_t expected[] = { DTCP_SUCCESS, DTCP_SUCCESS, DTCP_SUCCESS, DTCP_ERR_INVALID_PARAM };
+	DTCPIP_Config config;
+	bool ok = true;
+	memset(&config, 0, sizeof(config));
+	config.srm = &srm[0];
+	config.srmLength = (uint32_t)srm.size();
+	DTCPMgrSetLogLevel(DTCP_LOG_ERROR);
+	for (size_t i = 0; ok && i < sizeof(versions); i++)
+	{
+		srm[3] = versions[i];
+		dtcp_result_t ret = DTCPMgrInitializeEx(&config);
+		if (ret == DTCP_SUCCESS)
+		{
+			ret = DTCPMgrWaitInitialized(NULL);
+		}
+		ok = (ret == expected[i]);
+		DTCPMgrStopSource();
+	}
+	return ok;
+}
+
+int main(void)
+{
+	char cachePath[64];
+	snprintf(cachePath, sizeof(cachePath), "/tmp/dtcpmgr_start.%d.cache", (int)getpid());
+	std::vector<uint8_t> srm = buildSrm();
+
+	fprintf(stderr, "start with a %u byte SRM, median us of %d starts\n", (unsigned)srm.size(), START_RUNS);
+	fprintf(stderr, "%-6s %14s %14s %14s\n", "", "initialize", "deferred", "ready");
+	bool ok = runStarts("cold", srm, cachePath, true);
+	ok = ok && runStarts("warm", srm, cachePath, false);
+	if (ok && !checkDamagedCache(srm, cachePath))
+	{
+		fprintf(stderr, "a damaged cache file was not rebuilt\n");
+		ok = false;
+	}
+	if (ok && !checkReinitialize(srm))
+	{
+		fprintf(stderr, "the SRM of a re-initialization did not take effect\n");
+		ok = false;
+	}
+	unlink(cachePath);
+	return ok ? 0 : 1;
+}
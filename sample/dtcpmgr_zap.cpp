@@ -0,0 +1,263 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * Channel change benchmark for the DTCP Manager's sink exchange key cache.
+ *
+ * A channel change deletes the sink session and creates one for the next
+ * stream of the same source, then decrypts the first PCP. The source is
+ * started in this process and reached through a relay that holds every AKE
+ * message for ZAP_HOP_DELAY_MS, standing in for the home network and the
+ * certificate work the reference handshake leaves out. Changes with unique
+ * exchange keys run the AKE every time; changes with the shared key find it
+ * in the cache after the first one. The last row restarts the source before
+ * each change, so the cached key is refused by the first PCP and the sink
+ * runs the AKE again. Median times in milliseconds go to stderr.
+ */
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcpmgr.h"
+
+#define ZAP_HOP_DELAY_MS 10
+#define ZAP_CHANGES      20
+#define ZAP_CONTENT_SIZE (188 * 7)
+#define ZAP_BASE_PORT    24000
+
+static double nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Forwards one connection to the source, holding each message for the hop delay. */
+static void relayConnection(int client, int sourcePort)
+{
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)sourcePort);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int upstream = socket(AF_INET, SOCK_STREAM, 0);
+	if (upstream < 0 || connect(upstream, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		if (upstream >= 0)
+		{
+			close(upstream);
+		}
+		return;
+	}
+	struct pollfd fds[2] = { { client, POLLIN, 0 }, { upstream, POLLIN, 0 } };
+	for (;;)
+	{
+		if (poll(fds, 2, -1) <= 0)
+		{
+			break;
+		}
+		int from = (fds[0].revents != 0) ? 0 : 1;
+		uint8_t buffer[256];
+		ssize_t n = recv(fds[from].fd, buffer, sizeof(buffer), 0);
+		if (n <= 0)
+		{
+			break;
+		}
+		usleep(ZAP_HOP_DELAY_MS * 1000);
+		if (send(fds[1 - from].fd, buffer, (size_t)n, MSG_NOSIGNAL) != n)
+		{
+			break;
+		}
+	}
+	close(upstream);
+}
+
+static void relayLoop(int listenFd, int sourcePort, std::atomic<bool> *stop)
+{
+	while (!stop->load())
+	{
+		struct pollfd pfd = { listenFd, POLLIN, 0 };
+		if (poll(&pfd, 1, 100) != 1)
+		{
+			continue;
+		}
+		int client = accept(listenFd, NULL, NULL);
+		if (client >= 0)
+		{
+			relayConnection(client, sourcePort);
+			close(client);
+		}
+	}
+}
+
+static int startSource(void)
+{
+	for (int i = 0; i < 100; i++)
+	{
+		int port = ZAP_BASE_PORT + (int)((getpid() + i * 97) % 20000);
+		if (DTCPMgrStartSource((char *)"lo", port) == DTCP_SUCCESS)
+		{
+			return port;
+		}
+	}
+	return -1;
+}
+
+/* Encrypts one PCP with a new source session and decrypts it on @a sink. */
+static dtcp_result_t decryptFirstPcp(DTCP_SESSION_HANDLE sink)
+{
+	DTCP_SESSION_HANDLE source;
+	std::vector<uint8_t> content(ZAP_CONTENT_SIZE, 0x47);
+	std::vector<uint8_t> stream;
+	DTCPIP_Packet packet;
+
+	if (DTCPMgrCreateSourceSession((char *)"127.0.0.1", -1, 0, 0, &source) != DTCP_SUCCESS)
+	{
+		return DTCP_ERR_GENERAL;
+	}
+	memset(&packet, 0, sizeof(packet));
+	packet.session = source;
+	packet.dataInPtr = &content[0];
+	packet.dataLength = ZAP_CONTENT_SIZE;
+	packet.isEOF = 1;
+	dtcp_result_t result = DTCPMgrProcessPacket(source, &packet);
+	if (result == DTCP_SUCCESS)
+	{
+		stream.assign(packet.pcpHeader, packet.pcpHeader + packet.pcpHeaderLength);
+		stream.insert(stream.end(), packet.dataOutPtr, packet.dataOutPtr + packet.dataLength);
+		DTCPMgrReleasePacket(&packet);
+
+		memset(&packet, 0, sizeof(packet));
+		packet.session = sink;
+		packet.dataInPtr = &stream[0];
+		packet.dataLength = (uint32_t)stream.size();
+		result = DTCPMgrProcessPacket(sink, &packet);
+		if (result == DTCP_SUCCESS)
+		{
+			if (packet.dataLength != ZAP_CONTENT_SIZE || memcmp(packet.dataOutPtr, &content[0], ZAP_CONTENT_SIZE) != 0)
+			{
+				result = DTCP_ERR_GENERAL;
+			}
+			DTCPMgrReleasePacket(&packet);
+		}
+	}
+	DTCPMgrDeleteDTCPSession(source);
+	return result;
+}
+
+/* Creates a sink session and decrypts its first PCP, once more after a refused cached key. */
+static double changeChannel(int relayPort, BOOLEAN uniqueKey)
+{
+	double start = nowMs();
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		DTCP_SESSION_HANDLE sink;
+		if (DTCPMgrCreateSinkSession((char *)"127.0.0.1", relayPort, uniqueKey, 0, &sink) != DTCP_SUCCESS)
+		{
+			return -1;
+		}
+		/* With a unique key the source would encrypt under that key's label, which the relay does not learn. */
+		dtcp_result_t result = uniqueKey ? DTCP_SUCCESS : decryptFirstPcp(sink);
+		DTCPMgrDeleteDTCPSession(sink);
+		if (result == DTCP_SUCCESS)
+		{
+			return nowMs() - start;
+		}
+		if (result != DTCP_ERR_INVALID_KEY_LABEL)
+		{
+			return -1;
+		}
+	}
+	return -1;
+}
+
+static bool runChanges(const char *name, int relayPort, BOOLEAN uniqueKey, bool restartSource, int *sourcePort)
+{
+	std::vector<double> latency;
+	for (int i = 0; i < ZAP_CHANGES; i++)
+	{
+		if (restartSource)
+		{
+			DTCPMgrStopSource();
+			if (DTCPMgrStartSource((char *)"lo", *sourcePort) != DTCP_SUCCESS)
+			{
+				fprintf(stderr, "%-28s could not restart the source\n", name);
+				return false;
+			}
+		}
+		double elapsed = changeChannel(relayPort, uniqueKey);
+		if (elapsed < 0)
+		{
+			fprintf(stderr, "%-28s failed\n", name);
+			return false;
+		}
+		latency.push_back(elapsed);
+	}
+	std::sort(latency.begin(), latency.end());
+	fprintf(stderr, "%-28s %10.2f %10.2f\n", name, latency[ZAP_CHANGES / 2], latency[ZAP_CHANGES - 1]);
+	return true;
+}
+
+int main(void)
+{
+	std::atomic<bool> stop(false);
+	bool ok = true;
+
+	DTCPMgrSetLogLevel(DTCP_LOG_NONE);
+	if (DTCPMgrInitialize() != DTCP_SUCCESS)
+	{
+		return 1;
+	}
+	int sourcePort = startSource();
+	int relay = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (sourcePort < 0 || relay < 0 ||
+	    bind(relay, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(relay, 16) != 0 ||
+	    getsockname(relay, (struct sockaddr *)&address, &length) != 0)
+	{
+		fprintf(stderr, "could not start the source\n");
+		return 1;
+	}
+	int relayPort = ntohs(address.sin_port);
+	std::thread relayThread(relayLoop, relay, sourcePort, &stop);
+
+	fprintf(stderr, "channel change to a source %d ms per AKE message away, ms\n", ZAP_HOP_DELAY_MS);
+	fprintf(stderr, "%-28s %10s %10s\n", "", "median", "max");
+	ok = runChanges("AKE every change", relayPort, 1, false, &sourcePort) && ok;
+	ok = runChanges("cached exchange key", relayPort, 0, false, &sourcePort) && ok;
+	ok = runChanges("source restarted each time", relayPort, 0, true, &sourcePort) && ok;
+
+	stop.store(true);
+	relayThread.join();
+	close(relay);
+	DTCPMgrStopSource();
+	return ok ? 0 : 1;
+}
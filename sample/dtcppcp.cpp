@@ -0,0 +1,726 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "dtcppcp.h"
+#include "dtcpindex.h"
+#include "dtcpkeyahead.h"
+#include "dtcplog.h"
+
+/*
+ * Test key standing in for the device secret that a real AKE would use to
+ * establish exchange keys. Sources and sinks built from this reference share
+ * it, so they interoperate with each other and with nothing else.
+ */
+static const uint8_t referenceDeviceKey[DTCP_EXCHANGE_KEY_SIZE] =
+{
+	0x52, 0x44, 0x4B, 0x2D, 0x44, 0x54, 0x43, 0x50,
+	0x2D, 0x52, 0x45, 0x46, 0x2D, 0x4B, 0x45, 0x59
+};
+
+static void referenceContentKey(const uint8_t *exchangeKey, uint8_t emi, uint64_t nc, uint8_t *contentKey, uint8_t *iv);
+
+static std::atomic<DTCPContentKeyFunc> contentKeyFunc(referenceContentKey);
+
+static inline void putBe64(uint8_t *p, uint64_t v)
+{
+	for (int i = 7; i >= 0; i--)
+	{
+		p[i] = (uint8_t)v;
+		v >>= 8;
+	}
+}
+
+static inline uint64_t getBe64(const uint8_t *p)
+{
+	uint64_t v = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static inline void putBe32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+static inline uint32_t getBe32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t roundUpBlock(uint32_t length)
+{
+	return (length + DTCP_AES_BLOCK_SIZE - 1) & ~(uint32_t)(DTCP_AES_BLOCK_SIZE - 1);
+}
+
+static void referenceContentKey(const uint8_t *exchangeKey, uint8_t emi, uint64_t nc, uint8_t *contentKey, uint8_t *iv)
+{
+	DTCPAesKey aes;
+	uint8_t block[DTCP_AES_BLOCK_SIZE];
+
+	/* Kc = E(Kx, Nc || EMI || "DTCPKc"), IV = E(Kc, Nc || Nc) */
+	putBe64(block, nc);
+	block[8] = emi;
+	memcpy(&block[9], "DTCPKc", 7);
+	DTCPAesSetKey(&aes, exchangeKey);
+	DTCPAesEncryptBlock(&aes, block, contentKey);
+
+	putBe64(block, nc);
+	putBe64(&block[8], nc);
+	DTCPAesSetKey(&aes, contentKey);
+	DTCPAesEncryptBlock(&aes, block, iv);
+}
+
+/* /dev/urandom for kernels without getrandom(), opened once for the process. */
+static int urandomFd(void)
+{
+	static std::atomic<int> cached(-1);
+	int fd = cached.load(std::memory_order_acquire);
+	if (fd < 0)
+	{
+		int opened = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+		if (opened >= 0 && !cached.compare_exchange_strong(fd, opened))
+		{
+			close(opened);
+			return fd;
+		}
+		fd = opened;
+	}
+	return fd;
+}
+
+bool DTCPPcpRandom(void *out, uint32_t length)
+{
+	uint8_t *bytes = (uint8_t *)out;
+	while (length > 0)
+	{
+		ssize_t n = -1;
+		errno = ENOSYS;
+#ifdef SYS_getrandom
+		n = syscall(SYS_getrandom, bytes, (size_t)length, 0);
+#endif
+		if (n < 0 && errno == ENOSYS)
+		{
+			int fd = urandomFd();
+			n = (fd >= 0) ? read(fd, bytes, length) : -1;
+		}
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			DTCP_LOG_ERROR("No random bytes: %s\n", strerror(errno));
+			return false;
+		}
+		bytes += n;
+		length -= (uint32_t)n;
+	}
+	return true;
+}
+
+/* Returns false if no random bytes could be had; Nc must not repeat under the same exchange key. */
+static bool randomNonce(uint64_t *nc)
+{
+	*nc = 0;
+	while (*nc == 0)
+	{
+		if (!DTCPPcpRandom(nc, sizeof(*nc)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DTCPPcpBuildHeader(const DTCPPcpHeader *header, uint8_t *out)
+{
+	out[0] = (uint8_t)(((header->cipherAlgorithm & 0x1) << 4) | (header->emi & 0xF));
+	out[1] = header->exchangeKeyLabel;
+	putBe64(&out[2], header->nc);
+	putBe32(&out[10], header->contentLength);
+}
+
+bool DTCPPcpParseHeader(const uint8_t *in, DTCPPcpHeader *header)
+{
+	if ((in[0] & 0xE0) != 0)
+	{
+		return false;
+	}
+	header->cipherAlgorithm = (in[0] >> 4) & 0x1;
+	header->emi = in[0] & 0xF;
+	header->exchangeKeyLabel = in[1];
+	header->nc = getBe64(&in[2]);
+	header->contentLength = getBe32(&in[10]);
+	return header->cipherAlgorithm == DTCP_PCP_CA_AES128 &&
+	       header->contentLength > 0 &&
+	       header->contentLength <= DTCP_PCP_MAX_CONTENT;
+}
+
+void DTCPPcpSetContentKeyFunc(DTCPContentKeyFunc func)
+{
+	contentKeyFunc.store(func != NULL ? func : referenceContentKey);
+}
+
+/* Encrypts a tagged block under the device key; the reference's stand-in for licensed key material. */
+static void deviceKey(const char *tag, uint8_t value, uint8_t *key)
+{
+	DTCPAesKey aes;
+	uint8_t block[DTCP_AES_BLOCK_SIZE];
+
+	memset(block, 0, sizeof(block));
+	memcpy(block, tag, 6);
+	block[DTCP_AES_BLOCK_SIZE - 1] = value;
+	DTCPAesSetKey(&aes, referenceDeviceKey);
+	DTCPAesEncryptBlock(&aes, block, key);
+}
+
+void DTCPPcpGetExchangeKey(uint8_t keyLabel, uint8_t *exchangeKey)
+{
+	deviceKey("DTCPKx", keyLabel, exchangeKey);
+}
+
+void DTCPPcpGetAuthKey(uint8_t *authKey)
+{
+	deviceKey("DTCPKa", 0, authKey);
+}
+
+void DTCPPcpSelectContentKey(DTCPContentKey *key, const uint8_t *exchangeKey, uint8_t emi, uint64_t nc)
+{
+	if (key->valid && key->emi == emi && key->nc == nc)
+	{
+		return;
+	}
+	uint8_t contentKey[DTCP_AES_BLOCK_SIZE];
+	contentKeyFunc.load()(exchangeKey, emi, nc, contentKey, key->iv);
+	DTCPAesSetKey(&key->aes, contentKey);
+	memset(contentKey, 0, sizeof(contentKey));
+	key->emi = emi;
+	key->nc = nc;
+	key->valid = true;
+}
+
+bool DTCPPcpSourceInit(DTCPPcpSource *source, uint8_t keyLabel, int pcpPacketSize, DTCPKeyAhead *ahead)
+{
+	memset(source, 0, sizeof(*source));
+	source->keyLabel = keyLabel;
+	source->adaptive = (pcpPacketSize == DTCPIP_PCP_SIZE_ADAPTIVE);
+	source->pcpPacketSize = source->adaptive ? 0 : (uint32_t)pcpPacketSize;
+	DTCPTsRateInit(&source->rate);
+	source->ahead = ahead;
+	DTCPPcpGetExchangeKey(keyLabel, source->exchangeKey);
+	return randomNonce(&source->nc);
+}
+
+void DTCPPcpSourceSetExchangeKey(DTCPPcpSource *source, uint8_t keyLabel, const uint8_t *exchangeKey)
+{
+	memcpy(source->exchangeKey, exchangeKey, DTCP_EXCHANGE_KEY_SIZE);
+	source->keyLabel = keyLabel;
+	source->key.valid = false;
+}
+
+uint32_t DTCPPcpSourcePacketSize(const DTCPPcpSource *source)
+{
+	return __atomic_load_n(&source->pcpPacketSize, __ATOMIC_RELAXED);
+}
+
+/* Sizes the PCPs of an adaptive source to its latest bitrate estimate. */
+static void adaptPacketSize(DTCPPcpSource *source)
+{
+	uint64_t size = source->rate.bytesPerSecond * DTCP_PCP_ADAPTIVE_MS / 1000;
+	size -= size % DTCP_PCP_ALIGNMENT;
+	if (size < DTCP_PCP_ALIGNMENT)
+	{
+		size = DTCP_PCP_ALIGNMENT;
+	}
+	if (size > DTCP_PCP_MAX_CONTENT)
+	{
+		size = DTCP_PCP_MAX_CONTENT - DTCP_PCP_MAX_CONTENT % DTCP_PCP_ALIGNMENT;
+	}
+	__atomic_store_n(&source->pcpPacketSize, (uint32_t)size, __ATOMIC_RELAXED);
+}
+
+bool DTCPPcpSourceAtBoundary(const DTCPPcpSource *source)
+{
+	return source->remaining == 0 && source->tailLength == 0;
+}
+
+uint32_t DTCPPcpSourceMaxOutput(const DTCPPcpSource *source, uint32_t length, bool isEOF)
+{
+	/* Carried tail and padding of the PCP closed in this buffer, padding of the next one. */
+	uint32_t size = length + 2 * DTCP_AES_BLOCK_SIZE;
+	if (isEOF)
+	{
+		size += source->remaining;
+	}
+	return size;
+}
+
+/*
+ * Makes the source's content key the one for emi and its Nc, taking it from the
+ * precomputed slot when it is there. Past DTCP_NC_PREPARE_BYTES the next Nc's key
+ * is asked for; not at the switch itself, which would add waking the key thread
+ * to the call that already pays for the switch.
+ */
+static void sourceSelectKey(DTCPPcpSource *source, uint8_t emi)
+{
+	DTCPContentKey *key = &source->key;
+	if (source->ahead == NULL)
+	{
+		DTCPPcpSelectContentKey(key, source->exchangeKey, emi, source->nc);
+		return;
+	}
+	if (!(key->valid && key->emi == emi && key->nc == source->nc) &&
+	    !DTCPKeyAheadTake(source->ahead, source->exchangeKey, emi, source->nc, key))
+	{
+		DTCPPcpSelectContentKey(key, source->exchangeKey, emi, source->nc);
+	}
+	if (source->ncBytes >= DTCP_NC_PREPARE_BYTES)
+	{
+		DTCPKeyAheadRequest(source->ahead, source->exchangeKey, emi, source->nc + 1);
+	}
+}
+
+/* CBC-encrypts content, carrying any partial block in the source's tail. */
+static void sourceFeed(DTCPPcpSource *source, const uint8_t *in, uint32_t length, uint8_t *out, uint32_t *outLength)
+{
+	if (source->tailLength > 0)
+	{
+		uint32_t n = DTCP_AES_BLOCK_SIZE - source->tailLength;
+		if (n > length)
+		{
+			n = length;
+		}
+		memcpy(&source->tail[source->tailLength], in, n);
+		source->tailLength += n;
+		in += n;
+		length -= n;
+		if (source->tailLength < DTCP_AES_BLOCK_SIZE)
+		{
+			return;
+		}
+		if (out != NULL)
+		{
+			DTCPAesCbcEncrypt(&source->key.aes, source->chain, source->tail, out + *outLength, 1);
+		}
+		*outLength += DTCP_AES_BLOCK_SIZE;
+		source->tailLength = 0;
+	}
+	uint32_t blocks = length / DTCP_AES_BLOCK_SIZE;
+	if (out != NULL)
+	{
+		DTCPAesCbcEncrypt(&source->key.aes, source->chain, in, out + *outLength, blocks);
+	}
+	*outLength += blocks * DTCP_AES_BLOCK_SIZE;
+	source->tailLength = length - blocks * DTCP_AES_BLOCK_SIZE;
+	memcpy(source->tail, in + blocks * DTCP_AES_BLOCK_SIZE, source->tailLength);
+}
+
+/* Pads and encrypts the last partial block of a PCP. */
+static void sourceFlush(DTCPPcpSource *source, uint8_t *out, uint32_t *outLength)
+{
+	if (source->tailLength > 0)
+	{
+		memset(&source->tail[source->tailLength], 0, DTCP_AES_BLOCK_SIZE - source->tailLength);
+		if (out != NULL)
+		{
+			DTCPAesCbcEncrypt(&source->key.aes, source->chain, source->tail, out + *outLength, 1);
+		}
+		*outLength += DTCP_AES_BLOCK_SIZE;
+		source->tailLength = 0;
+	}
+}
+
+/*
+ * Encrypts the next length bytes of a buffer. bufferRemaining is what is left of the
+ * whole buffer from in onwards, so that a PCP opened here covers the rest of it.
+ */
+static void sourceEncrypt(DTCPPcpSource *source, uint8_t emi, const uint8_t *in, uint32_t length, uint32_t bufferRemaining,
+                          bool isEOF, uint8_t *out, uint32_t *outLength, uint8_t *header, int *headerOffset)
+{
+	uint32_t pos = 0;
+
+	while (pos < length)
+	{
+		if (source->remaining == 0)
+		{
+			/* Open a new PCP covering at least the rest of this buffer. */
+			DTCPPcpHeader pcp;
+			uint32_t contentLength = bufferRemaining - pos;
+			if (!isEOF && contentLength < source->pcpPacketSize)
+			{
+				contentLength = source->pcpPacketSize;
+			}
+			if (source->ncBytes >= DTCP_NC_UPDATE_BYTES)
+			{
+				source->nc++;
+				source->ncBytes = 0;
+				source->ncRotations++;
+			}
+			source->pcps++;
+			sourceSelectKey(source, emi);
+			memcpy(source->chain, source->key.iv, DTCP_AES_BLOCK_SIZE);
+			source->tailLength = 0;
+			source->remaining = contentLength;
+
+			pcp.cipherAlgorithm = DTCP_PCP_CA_AES128;
+			pcp.emi = emi;
+			pcp.exchangeKeyLabel = source->keyLabel;
+			pcp.nc = source->nc;
+			pcp.contentLength = contentLength;
+			DTCPPcpBuildHeader(&pcp, header);
+			*headerOffset = (int)*outLength;
+		}
+
+		uint32_t take = length - pos;
+		if (take > source->remaining)
+		{
+			take = source->remaining;
+		}
+		sourceFeed(source, in + pos, take, out, outLength);
+		pos += take;
+		source->remaining -= take;
+		source->ncBytes += take;
+		if (source->remaining == 0)
+		{
+			sourceFlush(source, out, outLength);
+		}
+	}
+}
+
+dtcp_result_t DTCPPcpSourceProcess(DTCPPcpSource *source, uint8_t emi, const uint8_t *in, uint32_t length, bool isEOF,
+                                   uint8_t *out, uint32_t *outLength, uint8_t *header, int *headerOffset)
+{
+	static const uint8_t zeros[256] = { 0 };
+
+	if (length > DTCP_PCP_MAX_CONTENT)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	*outLength = 0;
+	*headerOffset = -1;
+
+	/* Read before in-place encryption overwrites the content. */
+	if (source->adaptive && DTCPTsRateFeed(&source->rate, in, length))
+	{
+		adaptPacketSize(source);
+	}
+
+	if (in != out || out == NULL)
+	{
+		sourceEncrypt(source, emi, in, length, length, isEOF, out, outLength, header, headerOffset);
+	}
+	else
+	{
+		/*
+		 * In place, the output runs ahead of the input by the carried tail plus the
+		 * padding of a PCP closed in this buffer, less than DTCP_INPLACE_LEAD bytes.
+		 * Input is staged in small chunks, always copied DTCP_INPLACE_LEAD bytes
+		 * beyond what has been encrypted, so no unread byte is overwritten.
+		 */
+		uint8_t stage[DTCP_INPLACE_CHUNK + DTCP_INPLACE_LEAD];
+		uint32_t consumed = 0;
+		uint32_t copied = 0;
+		while (consumed < length)
+		{
+			uint32_t n = length - consumed;
+			if (n > DTCP_INPLACE_CHUNK)
+			{
+				n = DTCP_INPLACE_CHUNK;
+			}
+			uint32_t need = consumed + n + DTCP_INPLACE_LEAD;
+			if (need > length)
+			{
+				need = length;
+			}
+			memcpy(stage + (copied - consumed), in + copied, need - copied);
+			copied = need;
+			sourceEncrypt(source, emi, stage, n, length - consumed, isEOF, out, outLength, header, headerOffset);
+			memmove(stage, stage + n, copied - consumed - n);
+			consumed += n;
+		}
+	}
+
+	/* The stream ends inside a PCP opened by an earlier buffer: complete it. */
+	while (isEOF && source->remaining > 0)
+	{
+		uint32_t take = (source->remaining < sizeof(zeros)) ? source->remaining : sizeof(zeros);
+		sourceFeed(source, zeros, take, out, outLength);
+		source->remaining -= take;
+		source->ncBytes += take;
+		if (source->remaining == 0)
+		{
+			sourceFlush(source, out, outLength);
+		}
+	}
+
+	if (*headerOffset >= 0 && source->index != NULL)
+	{
+		DTCPIndexAdd(source->index, source->streamBytes + (uint64_t)*headerOffset, header);
+	}
+	source->streamBytes += *outLength + ((*headerOffset >= 0) ? DTCP_PCP_HEADER_SIZE : 0);
+	return DTCP_SUCCESS;
+}
+
+void DTCPPcpSinkInit(DTCPPcpSink *sink)
+{
+	memset(sink, 0, sizeof(*sink));
+}
+
+void DTCPPcpSinkSetExchangeKey(DTCPPcpSink *sink, uint8_t keyLabel, const uint8_t *exchangeKey)
+{
+	memcpy(sink->exchangeKey, exchangeKey, DTCP_EXCHANGE_KEY_SIZE);
+	sink->keyLabel = keyLabel;
+	sink->haveExchangeKey = true;
+	sink->fixedKey = true;
+	sink->key.valid = false;
+}
+
+bool DTCPPcpSinkAtBoundary(const DTCPPcpSink *sink)
+{
+	return sink->payloadRemaining == 0 && sink->headerLength == 0;
+}
+
+uint32_t DTCPPcpSinkMaxOutput(const DTCPPcpSink *sink, uint32_t length)
+{
+	return length + sink->tailLength;
+}
+
+/* Accounts for decrypted bytes written at out + *outLength, dropping padding and bytes before a seek target. */
+static void sinkOutput(DTCPPcpSink *sink, uint32_t decrypted, uint8_t *out, uint32_t *outLength)
+{
+	uint32_t produced = (decrypted < sink->contentRemaining) ? decrypted : sink->contentRemaining;
+	sink->contentRemaining -= produced;
+	sink->payloadRemaining -= decrypted;
+	if (sink->discard > 0)
+	{
+		uint32_t drop = (sink->discard < produced) ? sink->discard : produced;
+		sink->discard = 0;
+		if (out != NULL)
+		{
+			memmove(out + *outLength, out + *outLength + drop, produced - drop);
+		}
+		produced -= drop;
+	}
+	*outLength += produced;
+}
+
+/* Starts the PCP of a parsed header: checks its key label and selects its content key. */
+static dtcp_result_t sinkOpenPcp(DTCPPcpSink *sink, const DTCPPcpHeader *pcp)
+{
+	if (sink->fixedKey && sink->keyLabel != pcp->exchangeKeyLabel)
+	{
+		return DTCP_ERR_INVALID_KEY_LABEL;
+	}
+	if (!sink->haveExchangeKey || sink->keyLabel != pcp->exchangeKeyLabel)
+	{
+		DTCPPcpGetExchangeKey(pcp->exchangeKeyLabel, sink->exchangeKey);
+		sink->keyLabel = pcp->exchangeKeyLabel;
+		sink->haveExchangeKey = true;
+		sink->key.valid = false;
+	}
+	if (sink->key.valid && sink->key.nc != pcp->nc)
+	{
+		sink->ncRotations++;
+	}
+	sink->pcps++;
+	DTCPPcpSelectContentKey(&sink->key, sink->exchangeKey, pcp->emi, pcp->nc);
+	memcpy(sink->chain, sink->key.iv, DTCP_AES_BLOCK_SIZE);
+	sink->emi = pcp->emi;
+	sink->contentRemaining = pcp->contentLength;
+	sink->payloadRemaining = roundUpBlock(pcp->contentLength);
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPPcpSinkSeek(DTCPPcpSink *sink, const uint8_t *header, uint64_t pcpOffset, uint64_t offset,
+                              uint64_t *readOffset)
+{
+	DTCPPcpHeader pcp;
+	uint64_t payloadStart = pcpOffset + DTCP_PCP_HEADER_SIZE;
+	uint64_t skip = (offset > payloadStart) ? offset - payloadStart : 0;
+	if (!DTCPPcpParseHeader(header, &pcp) || offset < pcpOffset || skip >= roundUpBlock(pcp.contentLength))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	dtcp_result_t ret = sinkOpenPcp(sink, &pcp);
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+	uint32_t blocks = (uint32_t)skip & ~(uint32_t)(DTCP_AES_BLOCK_SIZE - 1);
+	sink->headerLength = 0;
+	sink->tailLength = 0;
+	sink->payloadRemaining -= blocks;
+	sink->contentRemaining = (pcp.contentLength > blocks) ? pcp.contentLength - blocks : 0;
+	sink->chainNeeded = (blocks > 0) ? DTCP_AES_BLOCK_SIZE : 0;
+	sink->discard = (uint32_t)skip - blocks;
+	*readOffset = payloadStart + blocks - sink->chainNeeded;
+	sink->streamBytes = *readOffset;
+	return DTCP_SUCCESS;
+}
+
+/*
+ * Runs the PCP parser over one chunk of the stream. A header or AES block
+ * cut by the end of the chunk is kept in the sink until the next chunk
+ * completes it; whole blocks are decrypted straight from the input.
+ */
+static dtcp_result_t sinkDecrypt(DTCPPcpSink *sink, const uint8_t *in, uint32_t length, uint8_t *out, uint32_t *outLength)
+{
+	uint32_t pos = 0;
+
+	while (pos < length)
+	{
+		if (sink->chainNeeded > 0)
+		{
+			/* After a seek, the ciphertext of the block before the first one decrypted. */
+			uint32_t take = (sink->chainNeeded < length - pos) ? sink->chainNeeded : length - pos;
+			memcpy(sink->chain + DTCP_AES_BLOCK_SIZE - sink->chainNeeded, in + pos, take);
+			sink->chainNeeded -= take;
+			pos += take;
+			continue;
+		}
+		if (sink->payloadRemaining == 0)
+		{
+			uint32_t take = DTCP_PCP_HEADER_SIZE - sink->headerLength;
+			if (take > length - pos)
+			{
+				take = length - pos;
+			}
+			memcpy(sink->header + sink->headerLength, in + pos, take);
+			sink->headerLength += take;
+			pos += take;
+			if (sink->headerLength < DTCP_PCP_HEADER_SIZE)
+			{
+				break;
+			}
+			sink->headerLength = 0;
+
+			DTCPPcpHeader pcp;
+			if (!DTCPPcpParseHeader(sink->header, &pcp))
+			{
+				return DTCP_ERR_INVALID_PARAM;
+			}
+			dtcp_result_t ret = sinkOpenPcp(sink, &pcp);
+			if (ret != DTCP_SUCCESS)
+			{
+				return ret;
+			}
+			if (sink->index != NULL)
+			{
+				DTCPIndexAdd(sink->index, sink->streamBytes + pos - DTCP_PCP_HEADER_SIZE, sink->header);
+			}
+			continue;
+		}
+
+		if (sink->tailLength > 0 || length - pos < DTCP_AES_BLOCK_SIZE)
+		{
+			uint32_t take = DTCP_AES_BLOCK_SIZE - sink->tailLength;
+			if (take > length - pos)
+			{
+				take = length - pos;
+			}
+			memcpy(sink->tail + sink->tailLength, in + pos, take);
+			sink->tailLength += take;
+			pos += take;
+			if (sink->tailLength < DTCP_AES_BLOCK_SIZE)
+			{
+				break;
+			}
+			sink->tailLength = 0;
+			if (out != NULL)
+			{
+				DTCPAesCbcDecrypt(&sink->key.aes, sink->chain, sink->tail, out + *outLength, 1);
+			}
+			sinkOutput(sink, DTCP_AES_BLOCK_SIZE, out, outLength);
+			continue;
+		}
+
+		uint32_t take = length - pos;
+		if (take > sink->payloadRemaining)
+		{
+			take = sink->payloadRemaining;
+		}
+		take &= ~(uint32_t)(DTCP_AES_BLOCK_SIZE - 1);
+		if (out != NULL)
+		{
+			DTCPAesCbcDecrypt(&sink->key.aes, sink->chain, in + pos, out + *outLength, take / DTCP_AES_BLOCK_SIZE);
+		}
+		sinkOutput(sink, take, out, outLength);
+		pos += take;
+	}
+	sink->streamBytes += length;
+	return DTCP_SUCCESS;
+}
+
+dtcp_result_t DTCPPcpSinkProcess(DTCPPcpSink *sink, const uint8_t *in, uint32_t length,
+                                 uint8_t *out, uint32_t *outLength, uint32_t *emi)
+{
+	dtcp_result_t ret = DTCP_SUCCESS;
+
+	*outLength = 0;
+	if (in != out || out == NULL || sink->tailLength == 0)
+	{
+		/* Headers only make the output fall behind the input, so in place is safe. */
+		ret = sinkDecrypt(sink, in, length, out, outLength);
+	}
+	else
+	{
+		/*
+		 * In place with a block carried over, the output runs ahead of the input by
+		 * up to the carried bytes. Stage the input as DTCPPcpSourceProcess() does.
+		 */
+		uint8_t stage[DTCP_INPLACE_CHUNK + DTCP_INPLACE_LEAD];
+		uint32_t consumed = 0;
+		uint32_t copied = 0;
+		while (ret == DTCP_SUCCESS && consumed < length)
+		{
+			uint32_t n = length - consumed;
+			if (n > DTCP_INPLACE_CHUNK)
+			{
+				n = DTCP_INPLACE_CHUNK;
+			}
+			uint32_t need = consumed + n + DTCP_INPLACE_LEAD;
+			if (need > length)
+			{
+				need = length;
+			}
+			memcpy(stage + (copied - consumed), in + copied, need - copied);
+			copied = need;
+			ret = sinkDecrypt(sink, stage, n, out, outLength);
+			memmove(stage, stage + n, copied - consumed - n);
+			consumed += n;
+		}
+	}
+	if (emi != NULL)
+	{
+		*emi = sink->emi;
+	}
+	return ret;
+}
@@ -0,0 +1,275 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcppcp.h
+ * Protected Content Packet (PCP) framing for the reference DTCP Manager.
+ *
+ * A PCP is a 14 byte header followed by the AES-128-CBC encrypted content,
+ * zero padded to a multiple of the AES block size:
+ *
+ * Offset | Size | Field
+ * -------| -----| -----
+ * 0      | 1    | reserved (3 bits), C_A (1 bit), EMI (4 bits)
+ * 1      | 1    | Exchange key label
+ * 2      | 8    | Nc, big endian
+ * 10     | 4    | CL (content length before padding), big endian
+ *
+ * The content key derivation is pluggable: the reference derivation uses
+ * test constants, since the DTCP-IP constants are only available to licensees.
+ */
+
+#ifndef __DTCPPCP_H_
+#define __DTCPPCP_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+#include "dtcpaes.h"
+#include "dtcptsrate.h"
+
+#define DTCP_PCP_HEADER_SIZE   DTCPIP_PCP_HEADER_SIZE
+#define DTCP_PCP_CA_AES128     0
+#define DTCP_PCP_MAX_CONTENT   (128 * 1024 * 1024)        /**< Largest CL of a single PCP.               */
+#define DTCP_PCP_ALIGNMENT     (4 * DTCP_TS_PACKET_SIZE)  /**< Multiple of TS packets and AES blocks.    */
+#define DTCP_PCP_ADAPTIVE_MS   100                        /**< Stream time an adaptive PCP spans.        */
+#define DTCP_NC_UPDATE_BYTES   (128 * 1024 * 1024)        /**< Content encrypted before Nc changes.      */
+#define DTCP_NC_PREPARE_BYTES  (DTCP_NC_UPDATE_BYTES / 2) /**< Content before the next key is derived.  */
+#define DTCP_EXCHANGE_KEY_SIZE 16
+#define DTCP_DEFAULT_KEY_LABEL 0
+#define DTCP_INPLACE_CHUNK     4096                       /**< Staging chunk of in-place encryption.     */
+#define DTCP_INPLACE_LEAD      (2 * DTCP_AES_BLOCK_SIZE)  /**< Bound on how far in-place output leads.   */
+
+typedef struct DTCPKeyAhead_s DTCPKeyAhead;
+typedef struct DTCPIndex_s DTCPIndex;
+
+/**
+ * @brief Decoded PCP header.
+ */
+typedef struct DTCPPcpHeader_s
+{
+	uint8_t  cipherAlgorithm;   /**< C_A, DTCP_PCP_CA_AES128.          */
+	uint8_t  emi;               /**< Encryption Mode Indicator.        */
+	uint8_t  exchangeKeyLabel;  /**< Label of the exchange key in use. */
+	uint64_t nc;                /**< Nonce for the content key.        */
+	uint32_t contentLength;     /**< CL, bytes of content in the PCP.  */
+} DTCPPcpHeader;
+
+/**
+ * @brief Content key derivation hook.
+ *
+ * Derives the content key Kc and the CBC initialisation vector from the
+ * exchange key, the EMI and Nc. SoC or licensee builds install their own
+ * derivation with DTCPPcpSetContentKeyFunc().
+ */
+typedef void (*DTCPContentKeyFunc)(const uint8_t *exchangeKey, uint8_t emi, uint64_t nc,
+                                   uint8_t *contentKey, uint8_t *iv);
+
+/**
+ * @brief Content key cache entry, valid for one (EMI, Nc) pair.
+ */
+typedef struct DTCPContentKey_s
+{
+	bool       valid;
+	uint8_t    emi;
+	uint64_t   nc;
+	DTCPAesKey aes;
+	uint8_t    iv[DTCP_AES_BLOCK_SIZE];
+} DTCPContentKey;
+
+/**
+ * @brief Source (encrypting) state of one session.
+ */
+typedef struct DTCPPcpSource_s
+{
+	uint8_t        exchangeKey[DTCP_EXCHANGE_KEY_SIZE];
+	uint8_t        keyLabel;
+	uint32_t       pcpPacketSize;                  /**< Minimum CL of a PCP, 0 for one PCP per buffer. */
+	bool           adaptive;                       /**< pcpPacketSize follows the stream's bitrate.    */
+	DTCPTsRate     rate;                           /**< Bitrate of an adaptive source's content.       */
+	uint64_t       nc;
+	uint64_t       ncBytes;                        /**< Content encrypted under the current Nc.        */
+	DTCPContentKey key;
+	uint32_t       remaining;                      /**< Content bytes left in the open PCP.            */
+	uint8_t        chain[DTCP_AES_BLOCK_SIZE];     /**< CBC chaining value.                            */
+	uint8_t        tail[DTCP_AES_BLOCK_SIZE];      /**< Partial block carried to the next buffer.      */
+	uint32_t       tailLength;
+	uint64_t       pcps;                           /**< PCPs opened, for statistics.                   */
+	uint64_t       ncRotations;                    /**< Nc updates, for statistics.                    */
+	DTCPKeyAhead   *ahead;                         /**< Next content key, derived in the background.   */
+	DTCPIndex      *index;                         /**< Where PCPs are indexed, NULL if nowhere.       */
+	uint64_t       streamBytes;                    /**< Output so far, PCP headers included.           */
+} DTCPPcpSource;
+
+/**
+ * @brief Sink (decrypting) state of one session.
+ */
+typedef struct DTCPPcpSink_s
+{
+	bool           haveExchangeKey;
+	bool           fixedKey;                       /**< Key came from an AKE, other labels are refused. */
+	uint8_t        keyLabel;
+	uint8_t        exchangeKey[DTCP_EXCHANGE_KEY_SIZE];
+	DTCPContentKey key;
+	uint8_t        emi;                            /**< EMI of the open PCP.                           */
+	uint32_t       payloadRemaining;               /**< Encrypted bytes left in the open PCP.          */
+	uint32_t       contentRemaining;               /**< Content bytes left in the open PCP.            */
+	uint8_t        chain[DTCP_AES_BLOCK_SIZE];
+	uint8_t        header[DTCP_PCP_HEADER_SIZE];   /**< Header split across buffers.                   */
+	uint32_t       headerLength;
+	uint8_t        tail[DTCP_AES_BLOCK_SIZE];      /**< Partial block carried to the next buffer.      */
+	uint32_t       tailLength;
+	uint64_t       pcps;                           /**< PCP headers parsed, for statistics.            */
+	uint64_t       ncRotations;                    /**< Nc changes between PCPs, for statistics.       */
+	DTCPIndex      *index;                         /**< Where PCPs are indexed, NULL if nowhere.       */
+	uint64_t       streamBytes;                    /**< Input so far.                                  */
+	uint32_t       chainNeeded;                    /**< Bytes of ciphertext owed to the CBC chain after a seek. */
+	uint32_t       discard;                        /**< Decrypted bytes to drop after a seek.          */
+} DTCPPcpSink;
+
+void DTCPPcpBuildHeader(const DTCPPcpHeader *header, uint8_t *out);
+
+/**
+ * @brief Parses a PCP header.
+ *
+ * @return false if reserved bits are set, C_A is not AES-128 or CL is out of range.
+ */
+bool DTCPPcpParseHeader(const uint8_t *in, DTCPPcpHeader *header);
+
+/**
+ * @brief Installs a content key derivation, or restores the reference one if @a func is NULL.
+ */
+void DTCPPcpSetContentKeyFunc(DTCPContentKeyFunc func);
+
+/**
+ * @brief Returns the exchange key for @a keyLabel.
+ */
+void DTCPPcpGetExchangeKey(uint8_t keyLabel, uint8_t *exchangeKey);
+
+/**
+ * @brief Returns the authentication key both ends of the reference AKE share.
+ *
+ * Stands in for the key a licensed AKE derives from the device certificates.
+ */
+void DTCPPcpGetAuthKey(uint8_t *authKey);
+
+/**
+ * @brief Fills @a out with @a length random bytes from the kernel.
+ *
+ * Takes them from getrandom(), or from /dev/urandom opened once, and never makes them up.
+ *
+ * @return false if the kernel gave none; keys and nonces must not be made then.
+ */
+bool DTCPPcpRandom(void *out, uint32_t length);
+
+/**
+ * @brief Makes @a key hold the content key for (@a emi, @a nc), deriving it only if it changed.
+ */
+void DTCPPcpSelectContentKey(DTCPContentKey *key, const uint8_t *exchangeKey, uint8_t emi, uint64_t nc);
+
+/**
+ * @brief Initialises a source; @a ahead, which may be NULL, is where the next content key is precomputed.
+ *
+ * With @a pcpPacketSize DTCPIP_PCP_SIZE_ADAPTIVE every buffer is a PCP until the bitrate of the
+ * transport stream is known; from then on PCPs span DTCP_PCP_ADAPTIVE_MS of it, in multiples of
+ * DTCP_PCP_ALIGNMENT bytes.
+ *
+ * @return false if no random initial Nc could be drawn.
+ */
+bool DTCPPcpSourceInit(DTCPPcpSource *source, uint8_t keyLabel, int pcpPacketSize, DTCPKeyAhead *ahead);
+
+/**
+ * @brief Returns the current minimum CL of a PCP; may be called while another thread processes.
+ */
+uint32_t DTCPPcpSourcePacketSize(const DTCPPcpSource *source);
+
+/**
+ * @brief Replaces the reference exchange key of a new source with one issued by the AKE.
+ */
+void DTCPPcpSourceSetExchangeKey(DTCPPcpSource *source, uint8_t keyLabel, const uint8_t *exchangeKey);
+
+/**
+ * @brief Returns true if no PCP is open, so the next buffer does not depend on the CBC chain.
+ */
+bool DTCPPcpSourceAtBoundary(const DTCPPcpSource *source);
+
+/**
+ * @brief Returns the output buffer size needed by DTCPPcpSourceProcess() for @a length input bytes.
+ */
+uint32_t DTCPPcpSourceMaxOutput(const DTCPPcpSource *source, uint32_t length, bool isEOF);
+
+/**
+ * @brief Encrypts one buffer of content.
+ *
+ * Writes the encrypted payload to @a out. When a PCP starts in this buffer its header is
+ * written to @a header and @a headerOffset receives the offset in @a out where it belongs,
+ * otherwise @a headerOffset is set to -1. Content that does not fill an AES block is
+ * carried over to the next call; on @a isEOF the open PCP is completed with zero bytes.
+ * @a out may equal @a in for in-place operation, provided the buffer holds
+ * DTCPPcpSourceMaxOutput() bytes. With @a out NULL only the framing state is
+ * advanced, without encrypting; the CBC chain is then left undefined.
+ */
+dtcp_result_t DTCPPcpSourceProcess(DTCPPcpSource *source, uint8_t emi, const uint8_t *in, uint32_t length, bool isEOF,
+                                   uint8_t *out, uint32_t *outLength, uint8_t *header, int *headerOffset);
+
+void DTCPPcpSinkInit(DTCPPcpSink *sink);
+
+/**
+ * @brief Installs the exchange key obtained by the AKE.
+ *
+ * From then on a PCP with another exchange key label fails with DTCP_ERR_INVALID_KEY_LABEL,
+ * instead of the sink deriving the reference key for that label.
+ */
+void DTCPPcpSinkSetExchangeKey(DTCPPcpSink *sink, uint8_t keyLabel, const uint8_t *exchangeKey);
+
+/**
+ * @brief Positions a sink at stream byte @a offset of the PCP whose @a header starts at @a pcpOffset.
+ *
+ * @a readOffset receives the offset the stream must be read from next. Inside the payload that is the
+ * start of the AES block before the one holding @a offset, whose ciphertext continues the CBC chain;
+ * the sink consumes it and drops decrypted bytes before @a offset.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a header is invalid or @a offset is not inside the PCP,
+ * DTCP_ERR_INVALID_KEY_LABEL if the sink has an exchange key from an AKE with another label.
+ */
+dtcp_result_t DTCPPcpSinkSeek(DTCPPcpSink *sink, const uint8_t *header, uint64_t pcpOffset, uint64_t offset,
+                              uint64_t *readOffset);
+
+/**
+ * @brief Returns true if the sink expects the start of a PCP header.
+ */
+bool DTCPPcpSinkAtBoundary(const DTCPPcpSink *sink);
+
+/**
+ * @brief Returns the output buffer size needed by DTCPPcpSinkProcess() for @a length input bytes.
+ */
+uint32_t DTCPPcpSinkMaxOutput(const DTCPPcpSink *sink, uint32_t length);
+
+/**
+ * @brief Decrypts one buffer of a PCP stream.
+ *
+ * The stream may be split anywhere, also inside a PCP header or an AES block; the
+ * unfinished header or block is carried over to the next call. Headers and padding are
+ * stripped; @a out must hold DTCPPcpSinkMaxOutput() bytes and may equal @a in.
+ * With @a out NULL only the headers are parsed and the framing state advanced.
+ * @a emi receives the EMI of the last PCP seen.
+ */
+dtcp_result_t DTCPPcpSinkProcess(DTCPPcpSink *sink, const uint8_t *in, uint32_t length,
+                                 uint8_t *out, uint32_t *outLength, uint32_t *emi);
+
+#endif //__DTCPPCP_H_
@@ -0,0 +1,239 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include "dtcppool.h"
+
+#define BLOCK_MAGIC 0x44504F4Cu
+
+typedef struct blockHeader_s
+{
+	uint32_t magic;
+	uint32_t size;
+	uint32_t refs;                  /**< Packets holding the buffer, atomic. */
+	DTCPBufferPool *pool;           /**< NULL for a one-off heap block. */
+	struct blockHeader_s *next;     /**< Free list link.                */
+} blockHeader;
+
+typedef struct slabHeader_s
+{
+	struct slabHeader_s *next;
+} slabHeader;
+
+struct DTCPBufferPool_s
+{
+	std::mutex lock;
+	uint32_t bufferSize;
+	uint32_t blockSize;
+	blockHeader *freeList;
+	slabHeader *slabs;
+	std::atomic<int> refs;
+	uint32_t allocated;
+	uint32_t inUse;
+	uint32_t highWater;
+	uint64_t heapAllocations;
+};
+
+static inline uint32_t alignUp(uint32_t size)
+{
+	return (size + DTCP_POOL_ALIGNMENT - 1) & ~(uint32_t)(DTCP_POOL_ALIGNMENT - 1);
+}
+
+static inline uint8_t *blockData(blockHeader *block)
+{
+	return (uint8_t *)block + DTCP_POOL_ALIGNMENT;
+}
+
+static void poolUnref(DTCPBufferPool *pool)
+{
+	if (pool->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+	slabHeader *slab = pool->slabs;
+	while (slab != NULL)
+	{
+		slabHeader *next = slab->next;
+		free(slab);
+		slab = next;
+	}
+	delete pool;
+}
+
+/* Adds a slab of DTCP_POOL_SLAB_BUFFERS buffers to the free list. Called with the lock held. */
+static bool poolGrow(DTCPBufferPool *pool)
+{
+	void *memory = NULL;
+	size_t size = DTCP_POOL_ALIGNMENT + (size_t)DTCP_POOL_SLAB_BUFFERS * pool->blockSize;
+	if (posix_memalign(&memory, DTCP_POOL_ALIGNMENT, size) != 0)
+	{
+		return false;
+	}
+	slabHeader *slab = (slabHeader *)memory;
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+	for (int i = 0; i < DTCP_POOL_SLAB_BUFFERS; i++)
+	{
+		blockHeader *block = (blockHeader *)((uint8_t *)memory + DTCP_POOL_ALIGNMENT + (size_t)i * pool->blockSize);
+		block->magic = BLOCK_MAGIC;
+		block->size = pool->bufferSize;
+		block->pool = pool;
+		block->next = pool->freeList;
+		pool->freeList = block;
+	}
+	pool->allocated += DTCP_POOL_SLAB_BUFFERS;
+	pool->heapAllocations++;
+	return true;
+}
+
+DTCPBufferPool *DTCPPoolCreate(uint32_t bufferSize)
+{
+	DTCPBufferPool *pool = new (std::nothrow) DTCPBufferPool;
+	if (pool == NULL)
+	{
+		return NULL;
+	}
+	pool->bufferSize = alignUp(bufferSize > 0 ? bufferSize : 1);
+	pool->blockSize = DTCP_POOL_ALIGNMENT + pool->bufferSize;
+	pool->freeList = NULL;
+	pool->slabs = NULL;
+	pool->refs.store(1);
+	pool->allocated = 0;
+	pool->inUse = 0;
+	pool->highWater = 0;
+	pool->heapAllocations = 0;
+	return pool;
+}
+
+void DTCPPoolDestroy(DTCPBufferPool *pool)
+{
+	if (pool != NULL)
+	{
+		poolUnref(pool);
+	}
+}
+
+/* Takes a buffer off the free list, growing the pool if it is empty. Called with the lock held. */
+static uint8_t *takeBlock(DTCPBufferPool *pool)
+{
+	if (pool->freeList == NULL && !poolGrow(pool))
+	{
+		return NULL;
+	}
+	blockHeader *block = pool->freeList;
+	pool->freeList = block->next;
+	block->next = NULL;
+	block->refs = 1;
+	pool->inUse++;
+	if (pool->inUse > pool->highWater)
+	{
+		pool->highWater = pool->inUse;
+	}
+	pool->refs.fetch_add(1, std::memory_order_relaxed);
+	return blockData(block);
+}
+
+uint8_t *DTCPPoolGet(DTCPBufferPool *pool, uint32_t size)
+{
+	if (size > pool->bufferSize)
+	{
+		void *memory = NULL;
+		if (posix_memalign(&memory, DTCP_POOL_ALIGNMENT, DTCP_POOL_ALIGNMENT + (size_t)size) != 0)
+		{
+			return NULL;
+		}
+		blockHeader *block = (blockHeader *)memory;
+		block->magic = BLOCK_MAGIC;
+		block->size = size;
+		block->refs = 1;
+		block->pool = NULL;
+		block->next = NULL;
+		std::lock_guard<std::mutex> guard(pool->lock);
+		pool->heapAllocations++;
+		return blockData(block);
+	}
+
+	std::lock_guard<std::mutex> guard(pool->lock);
+	return takeBlock(pool);
+}
+
+uint32_t DTCPPoolGetBatch(DTCPBufferPool *pool, uint8_t **buffers, uint32_t count)
+{
+	std::lock_guard<std::mutex> guard(pool->lock);
+	uint32_t taken = 0;
+	while (taken < count && (buffers[taken] = takeBlock(pool)) != NULL)
+	{
+		taken++;
+	}
+	return taken;
+}
+
+uint32_t DTCPPoolBufferSize(const DTCPBufferPool *pool)
+{
+	return pool->bufferSize;
+}
+
+void DTCPPoolPut(uint8_t *buffer)
+{
+	if (buffer == NULL)
+	{
+		return;
+	}
+	blockHeader *block = (blockHeader *)(buffer - DTCP_POOL_ALIGNMENT);
+	if (block->magic != BLOCK_MAGIC || __atomic_sub_fetch(&block->refs, 1, __ATOMIC_ACQ_REL) != 0)
+	{
+		return;
+	}
+	DTCPBufferPool *pool = block->pool;
+	if (pool == NULL)
+	{
+		block->magic = 0;
+		free(block);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		block->next = pool->freeList;
+		pool->freeList = block;
+		pool->inUse--;
+	}
+	poolUnref(pool);
+}
+
+void DTCPPoolRetain(uint8_t *buffer)
+{
+	if (buffer != NULL)
+	{
+		blockHeader *block = (blockHeader *)(buffer - DTCP_POOL_ALIGNMENT);
+		__atomic_add_fetch(&block->refs, 1, __ATOMIC_RELAXED);
+	}
+}
+
+void DTCPPoolGetInfo(DTCPBufferPool *pool, DTCPIP_BufferPoolInfo *info)
+{
+	std::lock_guard<std::mutex> guard(pool->lock);
+	info->bufferSize = pool->bufferSize;
+	info->buffersAllocated = pool->allocated;
+	info->buffersInUse = pool->inUse;
+	info->highWaterMark = pool->highWater;
+	info->heapAllocations = pool->heapAllocations;
+}
@@ -0,0 +1,93 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcppool.h
+ * Per-session buffer pool of the reference DTCP Manager.
+ *
+ * Buffers handed out in DTCPIP_Packet are carved from cache-line aligned
+ * slabs and recycled by DTCPMgrReleasePacket(), so a session that has
+ * reached its working set no longer touches the heap. Every buffer is
+ * preceded by a one cache line block header naming its pool, which lets
+ * a buffer be returned without knowing its session, and counting the
+ * packets that share it. A pool stays alive until its session is deleted
+ * and every buffer has been returned.
+ */
+
+#ifndef __DTCPPOOL_H_
+#define __DTCPPOOL_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+
+#define DTCP_POOL_ALIGNMENT     64
+#define DTCP_POOL_SLAB_BUFFERS  4
+#define DTCP_POOL_DEFAULT_SIZE  (64 * 1024)  /**< Buffer size when the session has no maxPacketSize. */
+
+typedef struct DTCPBufferPool_s DTCPBufferPool;
+
+/**
+ * @brief Creates a pool of buffers of @a bufferSize bytes.
+ *
+ * @return The pool, or NULL on allocation failure.
+ */
+DTCPBufferPool *DTCPPoolCreate(uint32_t bufferSize);
+
+/**
+ * @brief Drops the owner's reference; the pool is freed once all its buffers are returned.
+ */
+void DTCPPoolDestroy(DTCPBufferPool *pool);
+
+/**
+ * @brief Returns a buffer of at least @a size bytes.
+ *
+ * Requests larger than the pool's buffer size are served by a one-off heap block.
+ *
+ * @return The buffer, or NULL on allocation failure.
+ */
+uint8_t *DTCPPoolGet(DTCPBufferPool *pool, uint32_t size);
+
+/**
+ * @brief Takes up to @a count buffers of the pool's buffer size at once, under one lock.
+ *
+ * @return The number of buffers stored in @a buffers, less than @a count only on allocation failure.
+ */
+uint32_t DTCPPoolGetBatch(DTCPBufferPool *pool, uint8_t **buffers, uint32_t count);
+
+/**
+ * @brief Returns the size of the pool's buffers; DTCPPoolGet() serves larger requests from the heap.
+ */
+uint32_t DTCPPoolBufferSize(const DTCPBufferPool *pool);
+
+/**
+ * @brief Drops a reference to a buffer obtained with DTCPPoolGet(), returning it to its pool with the last one.
+ */
+void DTCPPoolPut(uint8_t *buffer);
+
+/**
+ * @brief Takes another reference to a buffer, so it can be handed out in more than one packet.
+ */
+void DTCPPoolRetain(uint8_t *buffer);
+
+/**
+ * @brief Fills @a info with the pool's counters.
+ */
+void DTCPPoolGetInfo(DTCPBufferPool *pool, DTCPIP_BufferPoolInfo *info);
+
+#endif //__DTCPPOOL_H_
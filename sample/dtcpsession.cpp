@@ -0,0 +1,189 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string.h>
+#include "dtcpindex.h"
+#include "dtcpkeyahead.h"
+#include "dtcpsession.h"
+#include "dtcpshared.h"
+#include "dtcpstrand.h"
+
+#define SLOT_MASK        ((1u << DTCP_SESSION_SLOT_BITS) - 1)
+#define GENERATION_MASK  (0xFFFFFFFFu >> DTCP_SESSION_SLOT_BITS)
+
+/*
+ * An odd generation marks a live session, an even one a free slot, so
+ * publishing and deleting each advance the generation by one. The stats
+ * are never reset: they add up every session the slot has held.
+ */
+typedef struct
+{
+	std::atomic<uint32_t> generation;
+	std::atomic<uint32_t> users;
+	DTCPStats stats;
+	sessionHandle session;
+} __attribute__((aligned(64))) sessionSlot;
+
+static sessionSlot slots[DTCP_MAX_SESSIONS];
+static std::atomic<int> sessionCounts[DTCP_UNKNOWN];
+static std::mutex tableMutex;
+static int freeSlots[DTCP_MAX_SESSIONS];
+static int numFreeSlots = -1;
+
+static inline uint32_t nextGeneration(uint32_t generation)
+{
+	return (generation + 1) & GENERATION_MASK;
+}
+
+sessionHandle *DTCPSessionAlloc(void)
+{
+	std::lock_guard<std::mutex> lock(tableMutex);
+	if (numFreeSlots < 0)
+	{
+		for (int i = 0; i < DTCP_MAX_SESSIONS; i++)
+		{
+			freeSlots[i] = DTCP_MAX_SESSIONS - 1 - i;
+		}
+		numFreeSlots = DTCP_MAX_SESSIONS;
+	}
+	if (numFreeSlots == 0)
+	{
+		return NULL;
+	}
+	int index = freeSlots[--numFreeSlots];
+	sessionHandle *session = &slots[index].session;
+	memset(session, 0, sizeof(*session));
+	session->id = index;
+	session->stats = &slots[index].stats;
+	DTCPStatsCopy(session->stats, &session->statsBase);
+	return session;
+}
+
+void DTCPSessionFree(sessionHandle *session)
+{
+	std::lock_guard<std::mutex> lock(tableMutex);
+	freeSlots[numFreeSlots++] = session->id;
+}
+
+DTCP_SESSION_HANDLE DTCPSessionPublish(sessionHandle *session)
+{
+	sessionSlot *slot = &slots[session->id];
+	uint32_t generation = nextGeneration(slot->generation.load(std::memory_order_relaxed));
+	sessionCounts[session->type].fetch_add(1, std::memory_order_relaxed);
+	slot->generation.store(generation, std::memory_order_release);
+	return ((DTCP_SESSION_HANDLE)generation << DTCP_SESSION_SLOT_BITS) | (DTCP_SESSION_HANDLE)session->id;
+}
+
+sessionHandle *DTCPSessionAcquire(DTCP_SESSION_HANDLE handle)
+{
+	uint32_t index = (uint32_t)(handle & SLOT_MASK);
+	uint32_t generation = (uint32_t)(handle >> DTCP_SESSION_SLOT_BITS);
+	if (index >= DTCP_MAX_SESSIONS || (generation & 1) == 0 || generation > GENERATION_MASK)
+	{
+		return NULL;
+	}
+	sessionSlot *slot = &slots[index];
+	slot->users.fetch_add(1);
+	if (slot->generation.load() != generation)
+	{
+		slot->users.fetch_sub(1, std::memory_order_release);
+		return NULL;
+	}
+	return &slot->session;
+}
+
+void DTCPSessionRelease(sessionHandle *session)
+{
+	slots[session->id].users.fetch_sub(1, std::memory_order_release);
+}
+
+void DTCPSessionRetain(sessionHandle *session)
+{
+	slots[session->id].users.fetch_add(1, std::memory_order_relaxed);
+}
+
+dtcp_result_t DTCPSessionDelete(DTCP_SESSION_HANDLE handle)
+{
+	uint32_t index = (uint32_t)(handle & SLOT_MASK);
+	uint32_t generation = (uint32_t)(handle >> DTCP_SESSION_SLOT_BITS);
+	if (index >= DTCP_MAX_SESSIONS || (generation & 1) == 0)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionSlot *slot = &slots[index];
+	if (!slot->generation.compare_exchange_strong(generation, nextGeneration(generation)))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	/* New lookups now fail; wait for the ones already inside the session. */
+	while (slot->users.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+	sessionCounts[slot->session.type].fetch_sub(1, std::memory_order_relaxed);
+	DTCPFdFlush(&slot->session.fdSender, DTCP_FD_FLUSH_TIMEOUT_MS);
+	DTCPStrandDestroy(slot->session.strand);
+	DTCPSharedDestroy(slot->session.shared);
+	DTCPKeyAheadDestroy(slot->session.source.ahead);
+	DTCPIndexDestroy(slot->session.index);
+	DTCPPoolDestroy(slot->session.dataPool);
+	DTCPPoolDestroy(slot->session.headerPool);
+	DTCPSessionFree(&slot->session);
+	return DTCP_SUCCESS;
+}
+
+void DTCPSessionForEach(DTCPSessionFunc func, void *arg)
+{
+	for (uint32_t index = 0; index < DTCP_MAX_SESSIONS; index++)
+	{
+		uint32_t generation = slots[index].generation.load(std::memory_order_relaxed);
+		sessionHandle *session =
+			DTCPSessionAcquire(((DTCP_SESSION_HANDLE)generation << DTCP_SESSION_SLOT_BITS) | (DTCP_SESSION_HANDLE)index);
+		if (session != NULL)
+		{
+			func(session, arg);
+			DTCPSessionRelease(session);
+		}
+	}
+}
+
+void DTCPSessionGetTotals(DTCPIP_SessionStats *out)
+{
+	DTCPStatsGet(&slots[0].stats, NULL, out);
+	for (int index = 1; index < DTCP_MAX_SESSIONS; index++)
+	{
+		DTCPStatsAccumulate(&slots[index].stats, out);
+	}
+}
+
+int DTCPSessionCount(DTCPDeviceType type)
+{
+	if (type == DTCP_UNKNOWN)
+	{
+		return sessionCounts[DTCP_SOURCE].load(std::memory_order_relaxed) +
+		       sessionCounts[DTCP_SINK].load(std::memory_order_relaxed);
+	}
+	if (type != DTCP_SOURCE && type != DTCP_SINK)
+	{
+		return 0;
+	}
+	return sessionCounts[type].load(std::memory_order_relaxed);
+}
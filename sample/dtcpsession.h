@@ -0,0 +1,135 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpsession.h
+ * Session table of the reference DTCP Manager.
+ *
+ * Sessions live in a fixed table. A DTCP_SESSION_HANDLE carries the slot
+ * index in its low bits and the slot generation above them, so a lookup is
+ * a single array access and a handle of a deleted session is rejected even
+ * after its slot has been reused.
+ *
+ * Lookups never take a lock: a reader announces itself in the slot's user
+ * count and then checks the generation, and deletion retires the generation
+ * before waiting for the user count to drain. Creation and deletion are
+ * serialized by a mutex that is never taken on the packet path.
+ */
+
+#ifndef __DTCPSESSION_H_
+#define __DTCPSESSION_H_
+
+#include "dtcpmgr.h"
+#include "dtcppcp.h"
+#include "dtcppool.h"
+#include "dtcpfd.h"
+#include "dtcpstats.h"
+
+#define DTCP_MAX_SESSIONS      128
+#define DTCP_SESSION_SLOT_BITS 8
+#define DTCP_REMOTE_IP_SIZE    64
+
+typedef struct DTCPStrand_s DTCPStrand;
+typedef struct DTCPSharedStream_s DTCPSharedStream;
+
+typedef struct
+{
+	int id;                /**< Slot index in the session table. */
+	DTCPDeviceType type;
+	int maxPacketSize;
+	DTCPPcpSource source;
+	DTCPPcpSink sink;
+	DTCPBufferPool *dataPool;
+	DTCPBufferPool *headerPool;
+	DTCPFdSender fdSender;
+	DTCPStrand *strand;    /**< Packets submitted for the worker pool, NULL until the first one. */
+	DTCPStats *stats;      /**< The slot's counters, shared with the sessions it held before. */
+	DTCPStats statsBase;   /**< The slot's counters when the session was created. */
+	char remoteIp[DTCP_REMOTE_IP_SIZE];
+	int remotePort;        /**< Port of the source a sink ran the AKE with, 0 if none. */
+	DTCPSharedStream *shared;          /**< Members of a shared stream, NULL for other sessions. */
+	DTCP_SESSION_HANDLE sharedStream;  /**< Shared stream the session is a member of, 0 if none; atomic. */
+	DTCPIndex *index;      /**< PCP index of the stream, NULL until DTCPMgrStartPcpIndex(). */
+	BOOLEAN uniqueKey;
+}sessionHandle;
+
+typedef void (*DTCPSessionFunc)(sessionHandle *session, void *arg);
+
+/**
+ * @brief Reserves a free slot.
+ *
+ * The returned session is zeroed and not visible to lookups until DTCPSessionPublish().
+ *
+ * @return The session, or NULL if all slots are in use.
+ */
+sessionHandle *DTCPSessionAlloc(void);
+
+/**
+ * @brief Returns an unpublished session obtained with DTCPSessionAlloc() to the table.
+ */
+void DTCPSessionFree(sessionHandle *session);
+
+/**
+ * @brief Makes an initialized session visible and returns its handle.
+ */
+DTCP_SESSION_HANDLE DTCPSessionPublish(sessionHandle *session);
+
+/**
+ * @brief Looks up a session and pins it against deletion.
+ *
+ * @return The session, or NULL if @a handle is invalid or stale.
+ * Every successful call must be paired with DTCPSessionRelease().
+ */
+sessionHandle *DTCPSessionAcquire(DTCP_SESSION_HANDLE handle);
+
+void DTCPSessionRelease(sessionHandle *session);
+
+/**
+ * @brief Takes another pin on a session already acquired by the caller.
+ *
+ * The pin keeps the session from being deleted until the matching DTCPSessionRelease(),
+ * which may be called from another thread.
+ */
+void DTCPSessionRetain(sessionHandle *session);
+
+/**
+ * @brief Deletes a session, waiting for concurrent users of it to finish.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a handle is invalid or stale.
+ */
+dtcp_result_t DTCPSessionDelete(DTCP_SESSION_HANDLE handle);
+
+/**
+ * @brief Calls @a func on every live session, pinned for the duration of the call.
+ */
+void DTCPSessionForEach(DTCPSessionFunc func, void *arg);
+
+/**
+ * @brief Copies the counters and histograms of every session ever created, live or deleted, into @a out.
+ *
+ * The pool fields of @a out are left untouched.
+ */
+void DTCPSessionGetTotals(DTCPIP_SessionStats *out);
+
+/**
+ * @brief Returns the number of live sessions of @a type, or of all types for DTCP_UNKNOWN.
+ */
+int DTCPSessionCount(DTCPDeviceType type);
+
+#endif //__DTCPSESSION_H_
@@ -0,0 +1,233 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string.h>
+#include "dtcpshared.h"
+
+typedef struct
+{
+	DTCP_SESSION_HANDLE handle;
+	bool                started;   /* Has had a PCP header, so gets every packet from now on. */
+} sharedMember;
+
+struct DTCPSharedStream_s
+{
+	std::mutex        lock;
+	std::atomic<bool> feeding;     /* Inside DTCPSharedProcess(), so the stream's own processing is allowed. */
+	uint32_t          numMembers;
+	sharedMember      members[DTCPIP_MAX_SHARED_MEMBERS];
+};
+
+DTCPSharedStream *DTCPSharedCreate(void)
+{
+	return new (std::nothrow) DTCPSharedStream();
+}
+
+void DTCPSharedDestroy(DTCPSharedStream *shared)
+{
+	delete shared;
+}
+
+/* Returns the stream @a session is a member of, clearing a link to a stream deleted since. */
+static DTCP_SESSION_HANDLE currentStream(sessionHandle *session)
+{
+	DTCP_SESSION_HANDLE streamHandle = __atomic_load_n(&session->sharedStream, __ATOMIC_ACQUIRE);
+	if (streamHandle == 0)
+	{
+		return 0;
+	}
+	sessionHandle *stream = DTCPSessionAcquire(streamHandle);
+	if (stream == NULL)
+	{
+		__atomic_compare_exchange_n(&session->sharedStream, &streamHandle, (DTCP_SESSION_HANDLE)0, false,
+		                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		return 0;
+	}
+	DTCPSessionRelease(stream);
+	return streamHandle;
+}
+
+bool DTCPSharedRefuses(sessionHandle *session)
+{
+	if (session->shared != NULL)
+	{
+		return !session->shared->feeding.load(std::memory_order_relaxed);
+	}
+	return currentStream(session) != 0;
+}
+
+dtcp_result_t DTCPSharedJoin(sessionHandle *stream, DTCP_SESSION_HANDLE streamHandle, sessionHandle *member,
+                             DTCP_SESSION_HANDLE memberHandle)
+{
+	DTCPSharedStream *shared = stream->shared;
+	if (shared == NULL || member->type != DTCP_SOURCE || member->shared != NULL || currentStream(member) != 0)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	if (member->source.keyLabel != stream->source.keyLabel ||
+	    memcmp(member->source.exchangeKey, stream->source.exchangeKey, DTCP_EXCHANGE_KEY_SIZE) != 0)
+	{
+		return DTCP_ERR_INVALID_KEY_LABEL;
+	}
+
+	/* Claims the member before entering it, so concurrent joins of one session cannot both succeed. */
+	DTCP_SESSION_HANDLE none = 0;
+	if (!__atomic_compare_exchange_n(&member->sharedStream, &none, streamHandle, false, __ATOMIC_ACQ_REL,
+	                                 __ATOMIC_ACQUIRE))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	std::lock_guard<std::mutex> lock(shared->lock);
+	if (shared->numMembers == DTCPIP_MAX_SHARED_MEMBERS)
+	{
+		__atomic_store_n(&member->sharedStream, (DTCP_SESSION_HANDLE)0, __ATOMIC_RELEASE);
+		return DTCP_ERR_OUT_OF_SESSIONS;
+	}
+	sharedMember *entry = &shared->members[shared->numMembers++];
+	entry->handle = memberHandle;
+	entry->started = false;
+	return DTCP_SUCCESS;
+}
+
+static void removeMember(DTCPSharedStream *shared, uint32_t index)
+{
+	shared->members[index] = shared->members[--shared->numMembers];
+}
+
+dtcp_result_t DTCPSharedLeave(sessionHandle *member, DTCP_SESSION_HANDLE memberHandle)
+{
+	DTCP_SESSION_HANDLE streamHandle = currentStream(member);
+	if (streamHandle == 0)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	sessionHandle *stream = DTCPSessionAcquire(streamHandle);
+	if (stream != NULL)
+	{
+		std::lock_guard<std::mutex> lock(stream->shared->lock);
+		for (uint32_t i = 0; i < stream->shared->numMembers; i++)
+		{
+			if (stream->shared->members[i].handle == memberHandle)
+			{
+				removeMember(stream->shared, i);
+				break;
+			}
+		}
+		DTCPSessionRelease(stream);
+	}
+	__atomic_store_n(&member->sharedStream, (DTCP_SESSION_HANDLE)0, __ATOMIC_RELEASE);
+	return DTCP_SUCCESS;
+}
+
+/* Fills @a out for one member; returns false if the member is not at a PCP boundary yet. */
+static bool memberPacket(sharedMember *entry, sessionHandle *member, const DTCPIP_Packet *packet, uint32_t inLength,
+                         DTCPIP_Packet *out)
+{
+	uint32_t skip = 0;
+	if (!entry->started)
+	{
+		if (packet->pcpHeaderOffset < 0)
+		{
+			return false;
+		}
+		skip = (uint32_t)packet->pcpHeaderOffset;
+	}
+
+	memset(out, 0, sizeof(*out));
+	out->session = entry->handle;
+	out->emi = packet->emi;
+	out->dataInPtr = packet->dataInPtr;
+	out->isEOF = packet->isEOF;
+	out->dataLength = packet->dataLength - skip;
+	out->pcpHeaderOffset = -1;
+	if (skip == 0)
+	{
+		DTCPPoolRetain(packet->dataOutPtr);
+		out->dataOutPtr = packet->dataOutPtr;
+	}
+	else
+	{
+		/* A pool buffer is only shared whole, so the part from the PCP header on is copied, once per join. */
+		out->dataOutPtr = DTCPPoolGet(member->dataPool, out->dataLength);
+		if (out->dataOutPtr == NULL)
+		{
+			return false;
+		}
+		memcpy(out->dataOutPtr, packet->dataOutPtr + skip, out->dataLength);
+	}
+	if (packet->pcpHeader != NULL)
+	{
+		DTCPPoolRetain(packet->pcpHeader);
+		out->pcpHeader = packet->pcpHeader;
+		out->pcpHeaderLength = packet->pcpHeaderLength;
+		out->pcpHeaderOffset = packet->pcpHeaderOffset - (int)skip;
+	}
+	entry->started = true;
+	DTCPStatsRecordPacket(member->stats, true, inLength, out->dataLength + out->pcpHeaderLength,
+	                      (out->pcpHeader != NULL) ? 1 : 0, 0, 0);
+	return true;
+}
+
+dtcp_result_t DTCPSharedProcess(sessionHandle *stream, DTCP_SESSION_HANDLE streamHandle, DTCPIP_Packet *packet,
+                                DTCPSharedEncryptFunc encrypt, DTCPIP_Packet *memberPackets, uint32_t maxMembers,
+                                uint32_t *numMembers)
+{
+	DTCPSharedStream *shared = stream->shared;
+	std::lock_guard<std::mutex> lock(shared->lock);
+	if (shared->numMembers > maxMembers || (memberPackets == NULL && shared->numMembers > 0))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	uint32_t inLength = packet->dataLength;
+	shared->feeding.store(true, std::memory_order_relaxed);
+	dtcp_result_t ret = encrypt(stream, packet);
+	shared->feeding.store(false, std::memory_order_relaxed);
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < shared->numMembers; )
+	{
+		sharedMember *entry = &shared->members[i];
+		sessionHandle *member = DTCPSessionAcquire(entry->handle);
+		if (member == NULL || __atomic_load_n(&member->sharedStream, __ATOMIC_ACQUIRE) != streamHandle)
+		{
+			/* Deleted since it joined. */
+			if (member != NULL)
+			{
+				DTCPSessionRelease(member);
+			}
+			removeMember(shared, i);
+			continue;
+		}
+		if (memberPacket(entry, member, packet, inLength, &memberPackets[count]))
+		{
+			count++;
+		}
+		DTCPSessionRelease(member);
+		i++;
+	}
+	*numMembers = count;
+	return DTCP_SUCCESS;
+}
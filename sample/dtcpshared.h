@@ -0,0 +1,82 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpshared.h
+ * Shared streams of the reference DTCP Manager.
+ *
+ * A shared stream is a source session whose output is handed to every
+ * member source session: each buffer is encrypted once, and every member's
+ * packet references the same pool buffers, counted by the pool. A member
+ * that joins mid-PCP gets nothing until the next PCP starts, and its first
+ * packet begins with that PCP's header.
+ *
+ * Members are held by handle, not pinned, so deleting a member needs no
+ * cooperation from the stream: the stream drops a member whose handle no
+ * longer resolves, and a member whose stream is gone is free again.
+ */
+
+#ifndef __DTCPSHARED_H_
+#define __DTCPSHARED_H_
+
+#include "dtcpsession.h"
+
+typedef dtcp_result_t (*DTCPSharedEncryptFunc)(sessionHandle *stream, DTCPIP_Packet *packet);
+
+/**
+ * @brief Allocates the member list of a shared stream.
+ *
+ * @return The stream state, or NULL on allocation failure.
+ */
+DTCPSharedStream *DTCPSharedCreate(void);
+
+void DTCPSharedDestroy(DTCPSharedStream *shared);
+
+/**
+ * @brief Adds the source session @a member to the shared stream @a stream.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a member is not a plain source session or is already a member,
+ * DTCP_ERR_INVALID_KEY_LABEL if it does not use the stream's exchange key,
+ * DTCP_ERR_OUT_OF_SESSIONS if the stream has DTCPIP_MAX_SHARED_MEMBERS members.
+ */
+dtcp_result_t DTCPSharedJoin(sessionHandle *stream, DTCP_SESSION_HANDLE streamHandle, sessionHandle *member,
+                             DTCP_SESSION_HANDLE memberHandle);
+
+/**
+ * @brief Removes @a member from its shared stream.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a member is not a member of a stream.
+ */
+dtcp_result_t DTCPSharedLeave(sessionHandle *member, DTCP_SESSION_HANDLE memberHandle);
+
+/**
+ * @brief Returns true if packets must not be processed on @a session directly.
+ *
+ * That is the case for a member of a stream and for a stream outside DTCPSharedProcess().
+ */
+bool DTCPSharedRefuses(sessionHandle *session);
+
+/**
+ * @brief Encrypts @a packet on @a stream with @a encrypt and fills one packet per member ready for it.
+ */
+dtcp_result_t DTCPSharedProcess(sessionHandle *stream, DTCP_SESSION_HANDLE streamHandle, DTCPIP_Packet *packet,
+                                DTCPSharedEncryptFunc encrypt, DTCPIP_Packet *memberPackets, uint32_t maxMembers,
+                                uint32_t *numMembers);
+
+#endif //__DTCPSHARED_H_
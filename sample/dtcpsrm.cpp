@@ -0,0 +1,459 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "dtcplog.h"
+#include "dtcpsrm.h"
+
+#define SRM_ENTRY_IDS    0
+#define SRM_ENTRY_RANGES 1
+#define SRM_BLOOM_HASHES 3
+#define SRM_CACHE_MAGIC  "DTCPSRMI"
+#define SRM_CACHE_FORMAT 1
+
+typedef struct
+{
+	uint64_t first;
+	uint64_t last;
+} srmRange;
+
+struct DTCPSrmIndex_s
+{
+	uint16_t              version;
+	const srmRange       *ranges;      /* Sorted and disjoint. */
+	uint64_t              numRanges;
+	const uint64_t       *bloom;       /* NULL if there is no filter. */
+	uint64_t              bloomWords;
+	uint64_t              bloomMask;   /* Bit count - 1, a power of 2 less 1. */
+	std::vector<srmRange> rangeStore;  /* Storage of an index built from an SRM... */
+	std::vector<uint64_t> bloomStore;
+	void                 *mapping;     /* ...or the cache file it is mapped from. */
+	size_t                mappingLength;
+};
+
+/* Cache file header; the ranges and then the Bloom filter words follow it. */
+typedef struct
+{
+	char     magic[8];
+	uint32_t format;
+	uint32_t bloomShift;
+	uint64_t srmDigest;
+	uint32_t srmLength;
+	uint16_t version;
+	uint16_t reserved;
+	uint64_t numRanges;
+	uint64_t bloomWords;
+	uint64_t bloomMask;
+	uint64_t checksum;       /* Of the header with this field 0, and of the ranges and filter. */
+} srmCacheHeader;
+
+/* Never freed, like the worker pool: the AKE thread may check a peer while the process exits. */
+static std::shared_ptr<const DTCPSrmIndex> *current = new std::shared_ptr<const DTCPSrmIndex>();
+static std::mutex updateLock;
+
+static uint16_t getBe16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint64_t getDeviceId(const uint8_t *p)
+{
+	uint64_t id = 0;
+	for (int i = 0; i < DTCP_SRM_DEVICE_ID_SIZE; i++)
+	{
+		id = (id << 8) | p[i];
+	}
+	return id;
+}
+
+static uint64_t mix(uint64_t x)
+{
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+static void bloomAdd(DTCPSrmIndex *index, uint64_t block)
+{
+	uint64_t h = mix(block);
+	uint64_t step = (h >> 32) | 1;
+	for (int i = 0; i < SRM_BLOOM_HASHES; i++, h += step)
+	{
+		uint64_t bit = h & index->bloomMask;
+		index->bloomStore[bit >> 6] |= 1ULL << (bit & 63);
+	}
+}
+
+static bool bloomTest(const DTCPSrmIndex *index, uint64_t block)
+{
+	uint64_t h = mix(block);
+	uint64_t step = (h >> 32) | 1;
+	for (int i = 0; i < SRM_BLOOM_HASHES; i++, h += step)
+	{
+		uint64_t bit = h & index->bloomMask;
+		if ((index->bloom[bit >> 6] & (1ULL << (bit & 63))) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Reads the CRL entries into @a ranges; returns false if they do not fill the CRL exactly. */
+static bool parseEntries(const uint8_t *p, uint32_t length, std::vector<srmRange> *ranges)
+{
+	while (length > 0)
+	{
+		if (length < 3)
+		{
+			return false;
+		}
+		uint8_t type = p[0];
+		uint32_t count = getBe16(&p[1]);
+		uint32_t entrySize = (type == SRM_ENTRY_IDS) ? DTCP_SRM_DEVICE_ID_SIZE : DTCP_SRM_DEVICE_ID_SIZE + 2;
+		p += 3;
+		length -= 3;
+		if (type > SRM_ENTRY_RANGES || length < count * entrySize)
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < count; i++, p += entrySize)
+		{
+			srmRange range;
+			range.first = getDeviceId(p);
+			range.last = range.first + ((type == SRM_ENTRY_RANGES) ? getBe16(&p[DTCP_SRM_DEVICE_ID_SIZE]) : 0);
+			ranges->push_back(range);
+		}
+		length -= count * entrySize;
+	}
+	return true;
+}
+
+/* Sorts the ranges and merges those that overlap or touch. */
+static void mergeRanges(std::vector<srmRange> *ranges)
+{
+	std::sort(ranges->begin(), ranges->end(), [](const srmRange &a, const srmRange &b) { return a.first < b.first; });
+	size_t out = 0;
+	for (size_t i = 0; i < ranges->size(); i++)
+	{
+		const srmRange &range = (*ranges)[i];
+		if (out > 0 && range.first <= (*ranges)[out - 1].last + 1)
+		{
+			(*ranges)[out - 1].last = std::max((*ranges)[out - 1].last, range.last);
+			continue;
+		}
+		(*ranges)[out++] = range;
+	}
+	ranges->resize(out);
+	ranges->shrink_to_fit();
+}
+
+static void buildBloom(DTCPSrmIndex *index)
+{
+	uint64_t blocks = 0;
+	const std::vector<srmRange> &ranges = index->rangeStore;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		blocks += (ranges[i].last >> DTCP_SRM_BLOOM_SHIFT) - (ranges[i].first >> DTCP_SRM_BLOOM_SHIFT) + 1;
+	}
+	if (blocks == 0 || blocks > DTCP_SRM_BLOOM_MAX_BLOCKS)
+	{
+		return;
+	}
+	uint64_t bits = 64;
+	while (bits < blocks * DTCP_SRM_BLOOM_BITS)
+	{
+		bits <<= 1;
+	}
+	index->bloomStore.assign(bits / 64, 0);
+	index->bloomMask = bits - 1;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		for (uint64_t block = ranges[i].first >> DTCP_SRM_BLOOM_SHIFT; block <= ranges[i].last >> DTCP_SRM_BLOOM_SHIFT;
+		     block++)
+		{
+			bloomAdd(index, block);
+		}
+	}
+}
+
+bool DTCPSrmHeaderValid(const uint8_t *srm, uint32_t length)
+{
+	return srm != NULL && length >= DTCP_SRM_HEADER_SIZE + DTCP_SRM_SIGNATURE_SIZE && (srm[0] >> 4) == 0 &&
+	       getBe16(&srm[5]) == length - (DTCP_SRM_HEADER_SIZE - 2);
+}
+
+dtcp_result_t DTCPSrmIndexCreate(const uint8_t *srm, uint32_t length, bool bloom, DTCPSrmIndex **index)
+{
+	if (index == NULL || !DTCPSrmHeaderValid(srm, length))
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	DTCPSrmIndex *created = new (std::nothrow) DTCPSrmIndex();
+	if (created == NULL)
+	{
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	created->version = getBe16(&srm[2]);
+	try
+	{
+		if (!parseEntries(&srm[DTCP_SRM_HEADER_SIZE], length - DTCP_SRM_HEADER_SIZE - DTCP_SRM_SIGNATURE_SIZE,
+		                  &created->rangeStore))
+		{
+			delete created;
+			return DTCP_ERR_INVALID_PARAM;
+		}
+		mergeRanges(&created->rangeStore);
+		if (bloom)
+		{
+			buildBloom(created);
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		delete created;
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	created->ranges = created->rangeStore.data();
+	created->numRanges = created->rangeStore.size();
+	created->bloom = created->bloomStore.empty() ? NULL : created->bloomStore.data();
+	created->bloomWords = created->bloomStore.size();
+	*index = created;
+	return DTCP_SUCCESS;
+}
+
+void DTCPSrmIndexDestroy(DTCPSrmIndex *index)
+{
+	if (index != NULL && index->mapping != NULL)
+	{
+		munmap(index->mapping, index->mappingLength);
+	}
+	delete index;
+}
+
+/* Hashes 8 bytes at a time, with one multiply of latency per word. */
+static uint64_t checksum(uint64_t h, const uint8_t *p, size_t length)
+{
+	for (; length >= 8; p += 8, length -= 8)
+	{
+		uint64_t word;
+		memcpy(&word, p, 8);
+		h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	uint64_t tail = length;
+	for (size_t i = 0; i < length; i++)
+	{
+		tail = (tail << 8) | p[i];
+	}
+	return mix(h ^ tail);
+}
+
+static uint64_t cacheChecksum(const srmCacheHeader *header, const void *ranges, const void *bloom)
+{
+	srmCacheHeader copy = *header;
+	copy.checksum = 0;
+	uint64_t h = checksum(0, (const uint8_t *)&copy, sizeof(copy));
+	h = checksum(h, (const uint8_t *)ranges, header->numRanges * sizeof(srmRange));
+	return checksum(h, (const uint8_t *)bloom, header->bloomWords * sizeof(uint64_t));
+}
+
+static bool writeAll(int fd, const void *data, size_t length)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	while (length > 0)
+	{
+		ssize_t written = write(fd, p, length);
+		if (written < 0)
+		{
+			return false;
+		}
+		p += written;
+		length -= (size_t)written;
+	}
+	return true;
+}
+
+bool DTCPSrmIndexSave(const DTCPSrmIndex *index, const uint8_t *srm, uint32_t length, const char *path)
+{
+	srmCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SRM_CACHE_MAGIC, sizeof(header.magic));
+	header.format = SRM_CACHE_FORMAT;
+	header.bloomShift = DTCP_SRM_BLOOM_SHIFT;
+	header.srmDigest = checksum(0, srm, length);
+	header.srmLength = length;
+	header.version = index->version;
+	header.numRanges = index->numRanges;
+	header.bloomWords = index->bloomWords;
+	header.bloomMask = index->bloomMask;
+	header.checksum = cacheChecksum(&header, index->ranges, index->bloom);
+
+	/* Written aside and renamed over the old file, so a reader never maps a partial one. */
+	char temp[4096];
+	if (snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid()) >= (int)sizeof(temp))
+	{
+		return false;
+	}
+	int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		return false;
+	}
+	bool ok = writeAll(fd, &header, sizeof(header)) &&
+	          writeAll(fd, index->ranges, index->numRanges * sizeof(srmRange)) &&
+	          writeAll(fd, index->bloom, index->bloomWords * sizeof(uint64_t));
+	ok = (close(fd) == 0) && ok;
+	if (!ok || rename(temp, path) != 0)
+	{
+		unlink(temp);
+		return false;
+	}
+	return true;
+}
+
+dtcp_result_t DTCPSrmIndexLoad(const char *path, const uint8_t *srm, uint32_t length, DTCPSrmIndex **index)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	struct stat st;
+	void *mapping = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= sizeof(srmCacheHeader))
+	{
+		mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	size_t size = (size_t)st.st_size;
+	size_t payload = size - sizeof(srmCacheHeader);
+	const srmCacheHeader *header = (const srmCacheHeader *)mapping;
+	const uint8_t *ranges = (const uint8_t *)mapping + sizeof(*header);
+	/* The sizes are checked without multiplying, so a corrupt count cannot wrap around. */
+	bool valid = memcmp(header->magic, SRM_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+	             header->format == SRM_CACHE_FORMAT && header->bloomShift == DTCP_SRM_BLOOM_SHIFT &&
+	             header->srmLength == length && header->numRanges <= payload / sizeof(srmRange) &&
+	             header->bloomWords <= payload / sizeof(uint64_t) &&
+	             header->bloomWords * sizeof(uint64_t) == payload - header->numRanges * sizeof(srmRange) &&
+	             (header->bloomWords == 0 || header->bloomMask + 1 == header->bloomWords * 64) &&
+	             header->srmDigest == checksum(0, srm, length);
+	const uint8_t *bloom = ranges + (valid ? header->numRanges * sizeof(srmRange) : 0);
+	if (!valid || header->checksum != cacheChecksum(header, ranges, bloom))
+	{
+		munmap(mapping, size);
+		return DTCP_ERR_INVALID_PARAM;
+	}
+
+	DTCPSrmIndex *loaded = new (std::nothrow) DTCPSrmIndex();
+	if (loaded == NULL)
+	{
+		munmap(mapping, size);
+		return DTCP_ERR_MEMORY_ALLOC;
+	}
+	loaded->version = header->version;
+	loaded->ranges = (const srmRange *)ranges;
+	loaded->numRanges = header->numRanges;
+	loaded->bloom = (header->bloomWords > 0) ? (const uint64_t *)bloom : NULL;
+	loaded->bloomWords = header->bloomWords;
+	loaded->bloomMask = header->bloomMask;
+	loaded->mapping = mapping;
+	loaded->mappingLength = size;
+	*index = loaded;
+	return DTCP_SUCCESS;
+}
+
+uint16_t DTCPSrmIndexVersion(const DTCPSrmIndex *index)
+{
+	return index->version;
+}
+
+bool DTCPSrmIndexRevoked(const DTCPSrmIndex *index, uint64_t deviceId)
+{
+	if (index->bloom != NULL && !bloomTest(index, deviceId >> DTCP_SRM_BLOOM_SHIFT))
+	{
+		return false;
+	}
+	/* The last range starting at or before deviceId is the only one that can hold it. */
+	const srmRange *end = index->ranges + index->numRanges;
+	const srmRange *next = std::upper_bound(index->ranges, end, deviceId,
+	                                        [](uint64_t id, const srmRange &range) { return id < range.first; });
+	return next != index->ranges && deviceId <= (next - 1)->last;
+}
+
+dtcp_result_t DTCPSrmUpdate(const uint8_t *srm, uint32_t length)
+{
+	DTCPSrmIndex *index;
+	dtcp_result_t ret = DTCPSrmIndexCreate(srm, length, true, &index);
+	if (ret != DTCP_SUCCESS)
+	{
+		return ret;
+	}
+	return DTCPSrmInstall(index);
+}
+
+dtcp_result_t DTCPSrmInstall(DTCPSrmIndex *index)
+{
+	std::shared_ptr<const DTCPSrmIndex> next(index, DTCPSrmIndexDestroy);
+	std::lock_guard<std::mutex> lock(updateLock);
+	std::shared_ptr<const DTCPSrmIndex> previous = std::atomic_load(current);
+	if (previous && previous->version >= index->version)
+	{
+		DTCP_LOG_WARN("SRM version %u is not newer than version %u in use\n", index->version, previous->version);
+		return DTCP_ERR_INVALID_PARAM;
+	}
+	/* Checks in progress keep the previous index until they drop their reference. */
+	std::atomic_store(current, next);
+	DTCP_LOG_INFO("SRM version %u in use, %u revoked ranges\n", index->version, (uint32_t)index->numRanges);
+	return DTCP_SUCCESS;
+}
+
+bool DTCPSrmVersion(uint16_t *version)
+{
+	std::shared_ptr<const DTCPSrmIndex> index = std::atomic_load(current);
+	if (!index)
+	{
+		return false;
+	}
+	*version = index->version;
+	return true;
+}
+
+bool DTCPSrmRevoked(uint64_t deviceId)
+{
+	std::shared_ptr<const DTCPSrmIndex> index = std::atomic_load(current);
+	return index && DTCPSrmIndexRevoked(index.get(), deviceId);
+}
@@ -0,0 +1,144 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpsrm.h
+ * System Renewability Message (SRM) of the reference DTCP Manager.
+ *
+ * An SRM lists the device IDs whose certificates are revoked, so that the AKE
+ * refuses them. The reference reads an SRM laid out after the DTCP one:
+ *
+ * Offset | Size | Field
+ * -------| -----| -----
+ * 0      | 1    | SRM type (high 4 bits, 0) and SRM generation (low 4 bits, 1)
+ * 1      | 1    | Reserved
+ * 2      | 2    | Version number, big endian
+ * 4      | 1    | Generation of the CRL
+ * 5      | 2    | CRL length: bytes from this field to the end of the SRM, big endian
+ * 7      | n    | CRL entries
+ * 7 + n  | 40   | Signature of the DTCP licensing authority
+ *
+ * A CRL entry is a type byte and a big endian count, followed by that many
+ * 5 byte device IDs (type 0) or ranges, each a 5 byte first device ID and the
+ * big endian 16 bit number of IDs after it (type 1). The licensed library
+ * verifies the signature with the licensing authority's key; the reference,
+ * which authenticates with a test key, does not.
+ *
+ * The SRM is parsed once into an index of sorted, merged ID ranges that a
+ * check bisects. In front of it sits a Bloom filter over blocks of
+ * 2^DTCP_SRM_BLOOM_SHIFT IDs, so that the usual check, of a device that is
+ * not revoked, mostly ends after a few bit tests. A newer SRM is indexed on
+ * the side and swapped in, so checks never wait for an update.
+ *
+ * An index can be saved to a cache file and mapped back from it, so that a
+ * restart with the same SRM skips the parse. The file is a header followed
+ * by the ranges and the filter words, in host byte order, and is used in
+ * place. It is only taken for the SRM whose length and digest it records,
+ * and only if the checksum over all of it matches, so a stale or damaged
+ * file is rebuilt rather than trusted. The checksum guards against damage,
+ * not tampering: the file belongs in a directory only the Manager writes.
+ */
+
+#ifndef __DTCPSRM_H_
+#define __DTCPSRM_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+
+#define DTCP_SRM_DEVICE_ID_SIZE   5           /**< Bytes of a device ID.                         */
+#define DTCP_SRM_HEADER_SIZE      7           /**< Up to and including the CRL length.           */
+#define DTCP_SRM_SIGNATURE_SIZE   40
+#define DTCP_SRM_BLOOM_SHIFT      8           /**< log2 of the IDs per Bloom filter block.       */
+#define DTCP_SRM_BLOOM_BITS       16          /**< Filter bits per block, about 0.5% false hits. */
+#define DTCP_SRM_BLOOM_MAX_BLOCKS (1 << 20)   /**< Beyond this the ranges are only bisected.     */
+
+typedef struct DTCPSrmIndex_s DTCPSrmIndex;
+
+/**
+ * @brief Returns true if the header of the SRM @a srm is consistent with its @a length.
+ *
+ * The entries are only checked by DTCPSrmIndexCreate().
+ */
+bool DTCPSrmHeaderValid(const uint8_t *srm, uint32_t length);
+
+/**
+ * @brief Parses the SRM @a srm into an index, with a Bloom filter if @a bloom is true.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a srm is malformed, DTCP_ERR_MEMORY_ALLOC.
+ */
+dtcp_result_t DTCPSrmIndexCreate(const uint8_t *srm, uint32_t length, bool bloom, DTCPSrmIndex **index);
+
+void DTCPSrmIndexDestroy(DTCPSrmIndex *index);
+
+/**
+ * @brief Returns the version number of the SRM @a index was built from.
+ */
+uint16_t DTCPSrmIndexVersion(const DTCPSrmIndex *index);
+
+/**
+ * @brief Returns true if @a index revokes @a deviceId.
+ */
+bool DTCPSrmIndexRevoked(const DTCPSrmIndex *index, uint64_t deviceId);
+
+/**
+ * @brief Writes @a index, built from the SRM @a srm, to the cache file @a path.
+ *
+ * The file is written next to @a path and renamed over it.
+ *
+ * @return false if the file could not be written.
+ */
+bool DTCPSrmIndexSave(const DTCPSrmIndex *index, const uint8_t *srm, uint32_t length, const char *path);
+
+/**
+ * @brief Maps the index of the SRM @a srm from the cache file @a path.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a path does not hold a valid index of @a srm, DTCP_ERR_MEMORY_ALLOC.
+ */
+dtcp_result_t DTCPSrmIndexLoad(const char *path, const uint8_t *srm, uint32_t length, DTCPSrmIndex **index);
+
+/**
+ * @brief Makes the SRM @a srm the one AKE peers are checked against.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if @a srm is malformed or its version is not newer than the one in use,
+ * DTCP_ERR_MEMORY_ALLOC.
+ */
+dtcp_result_t DTCPSrmUpdate(const uint8_t *srm, uint32_t length);
+
+/**
+ * @brief Makes @a index, with a Bloom filter or not, the one AKE peers are checked against.
+ *
+ * Takes ownership of @a index, also on failure.
+ *
+ * @return DTCP_ERR_INVALID_PARAM if its version is not newer than the one in use.
+ */
+dtcp_result_t DTCPSrmInstall(DTCPSrmIndex *index);
+
+/**
+ * @brief Sets @a version to the version number of the SRM in use.
+ *
+ * @return false if there is none.
+ */
+bool DTCPSrmVersion(uint16_t *version);
+
+/**
+ * @brief Returns true if the SRM in use revokes @a deviceId; false if there is none.
+ */
+bool DTCPSrmRevoked(uint64_t deviceId);
+
+#endif //__DTCPSRM_H_
@@ -0,0 +1,147 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <string.h>
+#include <time.h>
+#include "dtcpstats.h"
+
+static inline void add(uint64_t *counter, uint64_t value)
+{
+	if (value != 0)
+	{
+		__atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+	}
+}
+
+static inline uint64_t load(const uint64_t *counter)
+{
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/* Records @a count samples that took @a elapsedNs together, each in the bucket of their average. */
+static void record(DTCPHistogram *histogram, uint64_t elapsedNs, uint64_t count)
+{
+	uint64_t each = elapsedNs / count;
+	int bucket = (each == 0) ? 0 : 63 - __builtin_clzll(each);
+	if (bucket >= DTCPIP_HISTOGRAM_BUCKETS)
+	{
+		bucket = DTCPIP_HISTOGRAM_BUCKETS - 1;
+	}
+	add(&histogram->count, count);
+	add(&histogram->totalNs, elapsedNs);
+	add(&histogram->buckets[bucket], count);
+}
+
+/* Adds @a histogram less @a base (NULL for none) to @a out. */
+static void addHistogram(const DTCPHistogram *histogram, const DTCPHistogram *base, DTCPIP_Histogram *out)
+{
+	out->count += load(&histogram->count) - (base ? load(&base->count) : 0);
+	out->totalNs += load(&histogram->totalNs) - (base ? load(&base->totalNs) : 0);
+	for (int i = 0; i < DTCPIP_HISTOGRAM_BUCKETS; i++)
+	{
+		out->buckets[i] += load(&histogram->buckets[i]) - (base ? load(&base->buckets[i]) : 0);
+	}
+}
+
+/* Adds @a stats less @a base (NULL for none) to @a out. */
+static void addStats(const DTCPStats *stats, const DTCPStats *base, DTCPIP_SessionStats *out)
+{
+	out->bytesIn += load(&stats->bytesIn) - (base ? load(&base->bytesIn) : 0);
+	out->bytesOut += load(&stats->bytesOut) - (base ? load(&base->bytesOut) : 0);
+	out->packets += load(&stats->packets) - (base ? load(&base->packets) : 0);
+	out->errors += load(&stats->errors) - (base ? load(&base->errors) : 0);
+	out->pcps += load(&stats->pcps) - (base ? load(&base->pcps) : 0);
+	out->ncRotations += load(&stats->ncRotations) - (base ? load(&base->ncRotations) : 0);
+	addHistogram(&stats->process, base ? &base->process : NULL, &out->processLatency);
+	addHistogram(&stats->ake, base ? &base->ake : NULL, &out->akeLatency);
+}
+
+uint64_t DTCPStatsNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void DTCPStatsRecordPacket(DTCPStats *stats, bool ok, uint32_t bytesIn, uint32_t bytesOut, uint64_t pcps,
+                           uint64_t ncRotations, uint64_t elapsedNs)
+{
+	if (ok)
+	{
+		add(&stats->bytesIn, bytesIn);
+		add(&stats->bytesOut, bytesOut);
+		add(&stats->packets, 1);
+	}
+	else
+	{
+		add(&stats->errors, 1);
+	}
+	add(&stats->pcps, pcps);
+	add(&stats->ncRotations, ncRotations);
+	record(&stats->process, elapsedNs, 1);
+}
+
+void DTCPStatsRecordBatch(DTCPStats *stats, uint32_t packets, uint32_t errors, uint64_t bytesIn, uint64_t bytesOut,
+                          uint64_t pcps, uint64_t ncRotations, uint64_t elapsedNs)
+{
+	if (packets + errors == 0)
+	{
+		return;
+	}
+	add(&stats->bytesIn, bytesIn);
+	add(&stats->bytesOut, bytesOut);
+	add(&stats->packets, packets);
+	add(&stats->errors, errors);
+	add(&stats->pcps, pcps);
+	add(&stats->ncRotations, ncRotations);
+	record(&stats->process, elapsedNs, packets + errors);
+}
+
+void DTCPStatsRecordAke(DTCPStats *stats, uint64_t elapsedNs)
+{
+	record(&stats->ake, elapsedNs, 1);
+}
+
+void DTCPStatsGet(const DTCPStats *stats, const DTCPStats *base, DTCPIP_SessionStats *out)
+{
+	out->bytesIn = 0;
+	out->bytesOut = 0;
+	out->packets = 0;
+	out->errors = 0;
+	out->pcps = 0;
+	out->ncRotations = 0;
+	memset(&out->processLatency, 0, sizeof(out->processLatency));
+	memset(&out->akeLatency, 0, sizeof(out->akeLatency));
+	addStats(stats, base, out);
+}
+
+void DTCPStatsCopy(const DTCPStats *stats, DTCPStats *copy)
+{
+	const uint64_t *from = (const uint64_t *)stats;
+	uint64_t *to = (uint64_t *)copy;
+	for (size_t i = 0; i < sizeof(DTCPStats) / sizeof(uint64_t); i++)
+	{
+		to[i] = load(&from[i]);
+	}
+}
+
+void DTCPStatsAccumulate(const DTCPStats *stats, DTCPIP_SessionStats *out)
+{
+	addStats(stats, NULL, out);
+}
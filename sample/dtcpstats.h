@@ -0,0 +1,99 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpstats.h
+ * Session statistics of the reference DTCP Manager.
+ *
+ * Counters are plain integers updated with relaxed atomic adds, so that
+ * packets processed concurrently on the worker pool need no lock. Each
+ * session slot has a block that is never reset; a session's figures are
+ * that block less a copy taken when it was created, and the process-wide
+ * figures are the sum of all blocks. So a packet touches only its own
+ * session's counters, and deleted sessions are still counted in the totals.
+ */
+
+#ifndef __DTCPSTATS_H_
+#define __DTCPSTATS_H_
+
+#include <stdint.h>
+#include "dtcpmgr.h"
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t totalNs;
+	uint64_t buckets[DTCPIP_HISTOGRAM_BUCKETS];
+} DTCPHistogram;
+
+typedef struct
+{
+	uint64_t      bytesIn;
+	uint64_t      bytesOut;
+	uint64_t      packets;
+	uint64_t      errors;
+	uint64_t      pcps;
+	uint64_t      ncRotations;
+	DTCPHistogram process;
+	DTCPHistogram ake;
+} DTCPStats;
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+uint64_t DTCPStatsNow(void);
+
+/**
+ * @brief Records one processed packet; @a bytesIn and @a bytesOut count only on success.
+ */
+void DTCPStatsRecordPacket(DTCPStats *stats, bool ok, uint32_t bytesIn, uint32_t bytesOut, uint64_t pcps,
+                           uint64_t ncRotations, uint64_t elapsedNs);
+
+/**
+ * @brief Records a batch of packets processed together in @a elapsedNs, as one update of each counter.
+ *
+ * The packets are not timed one by one: each goes into the latency histogram with the batch's average
+ * time, so a slow packet within a batch shows only in the batch's average.
+ */
+void DTCPStatsRecordBatch(DTCPStats *stats, uint32_t packets, uint32_t errors, uint64_t bytesIn, uint64_t bytesOut,
+                          uint64_t pcps, uint64_t ncRotations, uint64_t elapsedNs);
+
+/**
+ * @brief Records the time taken to establish a session's exchange key.
+ */
+void DTCPStatsRecordAke(DTCPStats *stats, uint64_t elapsedNs);
+
+/**
+ * @brief Copies the counters and histograms of @a stats less those of @a base (NULL for none) into @a out.
+ *
+ * The pool fields of @a out are left untouched.
+ */
+void DTCPStatsGet(const DTCPStats *stats, const DTCPStats *base, DTCPIP_SessionStats *out);
+
+/**
+ * @brief Copies @a stats into @a copy, e.g. as the base of a new session.
+ */
+void DTCPStatsCopy(const DTCPStats *stats, DTCPStats *copy);
+
+/**
+ * @brief Adds the counters and histograms of @a stats to those of @a out.
+ */
+void DTCPStatsAccumulate(const DTCPStats *stats, DTCPIP_SessionStats *out);
+
+#endif //__DTCPSTATS_H_
@@ -0,0 +1,328 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "dtcpstrand.h"
+#include "dtcpworker.h"
+
+typedef struct
+{
+	DTCPJob        work;
+	DTCPStrand    *strand;
+	DTCPIP_Packet *packet;
+	dtcp_result_t  result;
+	bool           waiting;     /**< Starts when its predecessor has been processed. */
+	bool           processed;
+	DTCPIP_CompletionCallback callback;
+	void          *userData;
+	DTCPPcpSource  source;
+	DTCPPcpSink    sink;
+} strandJob;
+
+struct DTCPStrand_s
+{
+	std::mutex              lock;
+	std::condition_variable cond;
+	sessionHandle          *session;
+	DTCPStrandProcessFunc   process;
+	uint32_t                head;         /**< Oldest outstanding job.                      */
+	uint32_t                count;        /**< Jobs submitted and not completed.            */
+	uint32_t                unprocessed;
+	uint32_t                newest;
+	bool                    newestValid;  /**< jobs[newest] holds the latest session state. */
+	bool                    delivering;   /**< A thread is calling completion callbacks.    */
+	int                     eventFd;
+	strandJob               jobs[DTCP_STRAND_MAX_JOBS];
+};
+
+static void copyState(strandJob *to, const DTCPPcpSource *source, const DTCPPcpSink *sink, DTCPDeviceType type)
+{
+	/* Only the session's own state, which runs ahead in submission order, indexes PCPs. */
+	if (type == DTCP_SOURCE)
+	{
+		to->source = *source;
+		to->source.index = NULL;
+	}
+	else
+	{
+		to->sink = *sink;
+		to->sink.index = NULL;
+	}
+}
+
+/* Advances the session's framing past @a packet without encrypting it. */
+static void runAhead(sessionHandle *session, const DTCPIP_Packet *packet)
+{
+	uint32_t outLength;
+	if ((packet->dataInPtr == NULL && packet->dataLength > 0) ||
+	    (session->maxPacketSize > 0 && packet->dataLength > (uint32_t)session->maxPacketSize))
+	{
+		/* Processing will reject the packet without touching the state. */
+		return;
+	}
+	if (session->type == DTCP_SOURCE)
+	{
+		uint8_t header[DTCP_PCP_HEADER_SIZE];
+		int headerOffset;
+		DTCPPcpSourceProcess(&session->source, (uint8_t)packet->emi, packet->dataInPtr, packet->dataLength,
+		                     packet->isEOF, NULL, &outLength, header, &headerOffset);
+	}
+	else
+	{
+		DTCPPcpSinkProcess(&session->sink, packet->dataInPtr, packet->dataLength, NULL, &outLength, NULL);
+	}
+}
+
+/* Completes processed packets with a callback at the head, one thread at a time to keep them in order. */
+static void deliver(DTCPStrand *strand, std::unique_lock<std::mutex> &lock)
+{
+	if (strand->delivering)
+	{
+		return;
+	}
+	strand->delivering = true;
+	while (strand->count > 0 && strand->jobs[strand->head].processed && strand->jobs[strand->head].callback != NULL)
+	{
+		strandJob *job = &strand->jobs[strand->head];
+		DTCPIP_CompletionCallback callback = job->callback;
+		void *userData = job->userData;
+		DTCPIP_Packet *packet = job->packet;
+		dtcp_result_t result = job->result;
+		strand->head = (strand->head + 1) % DTCP_STRAND_MAX_JOBS;
+		strand->count--;
+		lock.unlock();
+		strand->cond.notify_all();
+		callback(packet, result, userData);
+		lock.lock();
+	}
+	strand->delivering = false;
+}
+
+static void strandRun(DTCPJob *work)
+{
+	strandJob *job = (strandJob *)((char *)work - offsetof(strandJob, work));
+	DTCPStrand *strand = job->strand;
+	sessionHandle *session = strand->session;
+	strandJob *next = NULL;
+	bool signal;
+
+	job->result = strand->process(session, &job->source, &job->sink, job->packet);
+	std::unique_lock<std::mutex> lock(strand->lock);
+	uint32_t index = (uint32_t)(job - strand->jobs);
+	uint32_t nextIndex = (index + 1) % DTCP_STRAND_MAX_JOBS;
+	job->processed = true;
+	signal = (job->callback == NULL);
+	strand->unprocessed--;
+	if ((nextIndex + DTCP_STRAND_MAX_JOBS - strand->head) % DTCP_STRAND_MAX_JOBS < strand->count &&
+	    strand->jobs[nextIndex].waiting)
+	{
+		next = &strand->jobs[nextIndex];
+		next->waiting = false;
+		copyState(next, &job->source, &job->sink, session->type);
+	}
+	lock.unlock();
+	if (next != NULL)
+	{
+		DTCPWorkerSubmit(&next->work);
+	}
+	if (signal)
+	{
+		uint64_t one = 1;
+		/* Fails only if the counter is saturated, in which case the fd is readable anyway. */
+		ssize_t written = write(strand->eventFd, &one, sizeof(one));
+		(void)written;
+	}
+	strand->cond.notify_all();
+	lock.lock();
+	deliver(strand, lock);
+	lock.unlock();
+	/* Drops the pin taken at submit; the strand may be destroyed from here on. */
+	DTCPSessionRelease(session);
+}
+
+DTCPStrand *DTCPStrandCreate(sessionHandle *session, DTCPStrandProcessFunc process)
+{
+	DTCPStrand *strand = new (std::nothrow) DTCPStrand;
+	if (strand == NULL)
+	{
+		return NULL;
+	}
+	strand->session = session;
+	strand->process = process;
+	strand->head = 0;
+	strand->count = 0;
+	strand->unprocessed = 0;
+	strand->newest = 0;
+	strand->newestValid = false;
+	strand->delivering = false;
+	strand->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (strand->eventFd < 0)
+	{
+		delete strand;
+		return NULL;
+	}
+	for (int i = 0; i < DTCP_STRAND_MAX_JOBS; i++)
+	{
+		strand->jobs[i].work.run = strandRun;
+		strand->jobs[i].strand = strand;
+	}
+	return strand;
+}
+
+void DTCPStrandDestroy(DTCPStrand *strand)
+{
+	if (strand == NULL)
+	{
+		return;
+	}
+	for (uint32_t i = 0; i < strand->count; i++)
+	{
+		strandJob *job = &strand->jobs[(strand->head + i) % DTCP_STRAND_MAX_JOBS];
+		if (job->result == DTCP_SUCCESS)
+		{
+			DTCPMgrReleasePacket(job->packet);
+		}
+	}
+	close(strand->eventFd);
+	delete strand;
+}
+
+dtcp_result_t DTCPStrandSubmit(DTCPStrand *strand, DTCPIP_Packet *packet, DTCPIP_CompletionCallback callback,
+                               void *userData, bool wait)
+{
+	sessionHandle *session = strand->session;
+	bool start = true;
+	strandJob *job;
+	{
+		std::unique_lock<std::mutex> lock(strand->lock);
+		if (!wait && strand->count == DTCP_STRAND_MAX_JOBS)
+		{
+			return DTCP_ERR_BUSY;
+		}
+		/* Callbacks delivered behind a packet the caller has yet to complete would be out of order. */
+		if (strand->count > 0 && (strand->jobs[strand->newest].callback == NULL) != (callback == NULL))
+		{
+			return DTCP_ERR_INVALID_PARAM;
+		}
+		strand->cond.wait(lock, [strand] { return strand->count < DTCP_STRAND_MAX_JOBS; });
+		uint32_t index = (strand->head + strand->count) % DTCP_STRAND_MAX_JOBS;
+		bool boundary = (session->type == DTCP_SOURCE) ? DTCPPcpSourceAtBoundary(&session->source)
+		                                               : DTCPPcpSinkAtBoundary(&session->sink);
+		job = &strand->jobs[index];
+		job->packet = packet;
+		job->result = DTCP_ERR_GENERAL;
+		job->processed = false;
+		job->waiting = false;
+		job->callback = callback;
+		job->userData = userData;
+		if (boundary || !strand->newestValid)
+		{
+			/* No CBC chain is carried, or the session state is the real one. */
+			copyState(job, &session->source, &session->sink, session->type);
+		}
+		else if (strand->jobs[strand->newest].processed)
+		{
+			strandJob *prev = &strand->jobs[strand->newest];
+			copyState(job, &prev->source, &prev->sink, session->type);
+		}
+		else
+		{
+			job->waiting = true;
+			start = false;
+		}
+		strand->count++;
+		strand->unprocessed++;
+		strand->newest = index;
+		strand->newestValid = true;
+	}
+	runAhead(session, packet);
+	DTCPSessionRetain(session);
+	if (start)
+	{
+		DTCPWorkerSubmit(&job->work);
+	}
+	return DTCP_SUCCESS;
+}
+
+int DTCPStrandEventFd(const DTCPStrand *strand)
+{
+	return strand->eventFd;
+}
+
+dtcp_result_t DTCPStrandComplete(DTCPStrand *strand, int timeoutMs, DTCPIP_Packet **packet, dtcp_result_t *result)
+{
+	std::unique_lock<std::mutex> lock(strand->lock);
+	auto ready = [strand] {
+		return strand->count > 0 && strand->jobs[strand->head].processed && strand->jobs[strand->head].callback == NULL;
+	};
+	/* Packets completed by callbacks may leave nothing to wait for. */
+	auto done = [strand, &ready] { return ready() || strand->count == 0; };
+	if (timeoutMs < 0)
+	{
+		strand->cond.wait(lock, done);
+	}
+	else
+	{
+		/* A bounded wait also covers a packet submitted by another thread meanwhile. */
+		strand->cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready);
+	}
+	if (!ready())
+	{
+		return DTCP_ERR_TIMEOUT;
+	}
+	strandJob *job = &strand->jobs[strand->head];
+	*packet = job->packet;
+	*result = job->result;
+	strand->head = (strand->head + 1) % DTCP_STRAND_MAX_JOBS;
+	strand->count--;
+	lock.unlock();
+	strand->cond.notify_all();
+	return DTCP_SUCCESS;
+}
+
+void DTCPStrandSync(DTCPStrand *strand)
+{
+	std::unique_lock<std::mutex> lock(strand->lock);
+	strand->cond.wait(lock, [strand] { return strand->unprocessed == 0; });
+	if (strand->newestValid)
+	{
+		strandJob *newest = &strand->jobs[strand->newest];
+		/* The job copies have no index (see copyState()); keep the session's. */
+		if (strand->session->type == DTCP_SOURCE)
+		{
+			DTCPIndex *index = strand->session->source.index;
+			strand->session->source = newest->source;
+			strand->session->source.index = index;
+		}
+		else
+		{
+			DTCPIndex *index = strand->session->sink.index;
+			strand->session->sink = newest->sink;
+			strand->session->sink.index = index;
+		}
+		strand->newestValid = false;
+	}
+}
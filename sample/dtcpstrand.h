@@ -0,0 +1,99 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpstrand.h
+ * Ordered packet submission of the reference DTCP Manager.
+ *
+ * A strand queues the packets submitted to one session and hands them to
+ * the worker pool. Packets are completed in submit order, but they need
+ * not be processed in that order: a buffer that starts on a PCP boundary
+ * depends only on the framing state (Nc, key, byte counts), not on the
+ * CBC chain of the buffer before it. At submit time the framing is run
+ * ahead on the session's own state without encrypting; a buffer starting
+ * on a boundary takes a copy of that state and runs at once, any other
+ * buffer waits for the final state of its predecessor.
+ *
+ * A packet submitted with a callback is completed by the thread that finds
+ * it at the head of the strand once processed; the others are returned by
+ * DTCPStrandComplete() and signalled on the strand's eventfd.
+ */
+
+#ifndef __DTCPSTRAND_H_
+#define __DTCPSTRAND_H_
+
+#include "dtcpmgr.h"
+#include "dtcppcp.h"
+#include "dtcpsession.h"
+
+#define DTCP_STRAND_MAX_JOBS DTCPIP_MAX_IN_FLIGHT
+
+/**
+ * @brief Processes one packet of @a session on the given state.
+ */
+typedef dtcp_result_t (*DTCPStrandProcessFunc)(sessionHandle *session, DTCPPcpSource *source, DTCPPcpSink *sink,
+                                               DTCPIP_Packet *packet);
+
+/**
+ * @return The strand, or NULL if it or its eventfd could not be allocated.
+ */
+DTCPStrand *DTCPStrandCreate(sessionHandle *session, DTCPStrandProcessFunc process);
+
+/**
+ * @brief Frees a strand whose session has no users left.
+ *
+ * Packets processed but not completed are released with DTCPMgrReleasePacket().
+ */
+void DTCPStrandDestroy(DTCPStrand *strand);
+
+/**
+ * @brief Queues @a packet, to be completed by @a callback if not NULL.
+ *
+ * Submission to one strand must not be concurrent, as for DTCPMgrProcessPacket().
+ *
+ * @return DTCP_ERR_BUSY if DTCP_STRAND_MAX_JOBS packets are outstanding and @a wait is false;
+ * otherwise it waits for room. DTCP_ERR_INVALID_PARAM if the outstanding packets are completed
+ * the other way, with or without a callback.
+ */
+dtcp_result_t DTCPStrandSubmit(DTCPStrand *strand, DTCPIP_Packet *packet, DTCPIP_CompletionCallback callback,
+                               void *userData, bool wait);
+
+/**
+ * @brief Returns the eventfd signalled for each processed packet submitted without a callback.
+ */
+int DTCPStrandEventFd(const DTCPStrand *strand);
+
+/**
+ * @brief Returns the oldest outstanding packet once it has been processed.
+ *
+ * Packets submitted with a callback are never returned here.
+ *
+ * @return DTCP_ERR_TIMEOUT if none was ready within @a timeoutMs, which covers packets submitted
+ * meanwhile (negative waits as long as packets are outstanding).
+ */
+dtcp_result_t DTCPStrandComplete(DTCPStrand *strand, int timeoutMs, DTCPIP_Packet **packet, dtcp_result_t *result);
+
+/**
+ * @brief Waits until all submitted packets are processed and hands their final state to the session.
+ *
+ * Called before the session is used synchronously.
+ */
+void DTCPStrandSync(DTCPStrand *strand);
+
+#endif //__DTCPSTRAND_H_
@@ -0,0 +1,112 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <string.h>
+#include "dtcptsrate.h"
+
+#define PCR_WRAP ((1ULL << 33) * 300)
+
+void DTCPTsRateInit(DTCPTsRate *rate)
+{
+	memset(rate, 0, sizeof(*rate));
+	rate->pcrPid = -1;
+}
+
+/* Looks at the head of a TS packet; returns true if it completed an estimate. */
+static bool inspect(DTCPTsRate *rate)
+{
+	const uint8_t *head = rate->head;
+	if (head[0] != DTCP_TS_SYNC_BYTE)
+	{
+		rate->lost = true;
+		return false;
+	}
+	int pid = ((head[1] & 0x1F) << 8) | head[2];
+	bool hasPcr = (head[3] & 0x20) != 0 && head[4] >= 7 && (head[5] & 0x10) != 0;
+	if (!hasPcr || (rate->pcrPid >= 0 && pid != rate->pcrPid))
+	{
+		return false;
+	}
+	rate->pcrPid = pid;
+
+	uint64_t base = ((uint64_t)head[6] << 25) | ((uint64_t)head[7] << 17) | ((uint64_t)head[8] << 9) |
+	                ((uint64_t)head[9] << 1) | (head[10] >> 7);
+	uint64_t pcr = base * 300 + (((uint64_t)(head[10] & 0x01) << 8) | head[11]);
+	bool discontinuity = (head[5] & 0x80) != 0;
+	if (!rate->haveWindow || discontinuity)
+	{
+		rate->haveWindow = true;
+		rate->windowPcr = pcr;
+		rate->windowStart = rate->packetStart;
+		return false;
+	}
+
+	uint64_t elapsed = (pcr + PCR_WRAP - rate->windowPcr) % PCR_WRAP;
+	if (elapsed < DTCP_TS_RATE_WINDOW)
+	{
+		return false;
+	}
+	bool updated = false;
+	if (elapsed <= DTCP_TS_PCR_MAX_GAP)
+	{
+		rate->bytesPerSecond = (rate->packetStart - rate->windowStart) * DTCP_TS_PCR_HZ / elapsed;
+		updated = true;
+	}
+	rate->windowPcr = pcr;
+	rate->windowStart = rate->packetStart;
+	return updated;
+}
+
+bool DTCPTsRateFeed(DTCPTsRate *rate, const uint8_t *in, uint32_t length)
+{
+	bool updated = false;
+	uint32_t pos = 0;
+	while (pos < length && !rate->lost)
+	{
+		uint32_t n;
+		if (rate->phase < DTCP_TS_HEAD_SIZE)
+		{
+			n = DTCP_TS_HEAD_SIZE - rate->phase;
+			if (n > length - pos)
+			{
+				n = length - pos;
+			}
+			memcpy(rate->head + rate->phase, in + pos, n);
+			rate->phase += n;
+			pos += n;
+			if (rate->phase == DTCP_TS_HEAD_SIZE && inspect(rate))
+			{
+				updated = true;
+			}
+			continue;
+		}
+		n = DTCP_TS_PACKET_SIZE - rate->phase;
+		if (n > length - pos)
+		{
+			n = length - pos;
+		}
+		rate->phase += n;
+		pos += n;
+		if (rate->phase == DTCP_TS_PACKET_SIZE)
+		{
+			rate->phase = 0;
+			rate->packetStart += DTCP_TS_PACKET_SIZE;
+		}
+	}
+	return updated;
+}
@@ -0,0 +1,67 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcptsrate.h
+ * MPEG transport stream bitrate estimate of the reference DTCP Manager.
+ *
+ * Follows the 188 byte TS packets of a source's content, also across
+ * buffers split anywhere, and measures the bytes between program clock
+ * references (PCRs) of one PID. The estimate comes from the stream's own
+ * clock, not from the rate it is handed over at, so a file read faster
+ * than real time is measured at its real bitrate, and the same content
+ * always gives the same estimate at the same byte. Content that is not a
+ * transport stream, or loses TS sync, gets no estimate.
+ */
+
+#ifndef __DTCPTSRATE_H_
+#define __DTCPTSRATE_H_
+
+#include <stdint.h>
+
+#define DTCP_TS_PACKET_SIZE   188
+#define DTCP_TS_SYNC_BYTE     0x47
+#define DTCP_TS_HEAD_SIZE     12                        /**< TS header and adaptation field up to the PCR.  */
+#define DTCP_TS_PCR_HZ        27000000ULL
+#define DTCP_TS_RATE_WINDOW   (DTCP_TS_PCR_HZ / 10)     /**< Shortest PCR span an estimate is made over.    */
+#define DTCP_TS_PCR_MAX_GAP   (DTCP_TS_PCR_HZ * 2)      /**< Longer PCR steps are taken as discontinuities. */
+
+typedef struct DTCPTsRate_s
+{
+	uint8_t  head[DTCP_TS_HEAD_SIZE];   /**< Start of the current TS packet.               */
+	uint32_t phase;                     /**< Bytes of the current TS packet seen.          */
+	bool     lost;                      /**< Not a transport stream, no more estimates.    */
+	int      pcrPid;                    /**< PID whose PCRs are used, -1 until one is seen. */
+	uint64_t packetStart;               /**< Stream offset of the current TS packet.       */
+	bool     haveWindow;
+	uint64_t windowPcr;                 /**< PCR the measurement started at.               */
+	uint64_t windowStart;               /**< Stream offset of its TS packet.               */
+	uint64_t bytesPerSecond;            /**< Latest estimate, 0 for none yet.              */
+} DTCPTsRate;
+
+void DTCPTsRateInit(DTCPTsRate *rate);
+
+/**
+ * @brief Follows the next @a length bytes of the stream.
+ *
+ * @return true if DTCP_TS_RATE_WINDOW has passed since the last estimate and bytesPerSecond was updated.
+ */
+bool DTCPTsRateFeed(DTCPTsRate *rate, const uint8_t *in, uint32_t length);
+
+#endif //__DTCPTSRATE_H_
@@ -0,0 +1,153 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include "dtcpworker.h"
+
+typedef struct
+{
+	std::mutex lock;
+	std::deque<DTCPJob *> jobs;
+} __attribute__((aligned(64))) workerQueue;
+
+typedef struct
+{
+	workerQueue             queues[DTCP_MAX_WORKERS];
+	std::atomic<uint32_t>   nextQueue;
+	std::atomic<int>        queuedJobs;
+	std::mutex              idleLock;
+	std::condition_variable idleCond;
+} workerPool;
+
+/* Never freed: detached workers still wait on it while static destructors run at exit. */
+static workerPool *pool = NULL;
+static std::atomic<uint32_t> numWorkers(0);
+static std::mutex startLock;
+static thread_local int workerIndex = -1;
+
+static DTCPJob *takeJob(int self, uint32_t count)
+{
+	{
+		workerQueue *own = &pool->queues[self];
+		std::lock_guard<std::mutex> lock(own->lock);
+		if (!own->jobs.empty())
+		{
+			DTCPJob *job = own->jobs.back();
+			own->jobs.pop_back();
+			return job;
+		}
+	}
+	for (uint32_t i = 1; i < count; i++)
+	{
+		workerQueue *victim = &pool->queues[(self + i) % count];
+		std::lock_guard<std::mutex> lock(victim->lock);
+		if (!victim->jobs.empty())
+		{
+			DTCPJob *job = victim->jobs.front();
+			victim->jobs.pop_front();
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static void workerMain(int self, uint32_t count)
+{
+	workerIndex = self;
+	for (;;)
+	{
+		DTCPJob *job = takeJob(self, count);
+		if (job != NULL)
+		{
+			pool->queuedJobs.fetch_sub(1);
+			job->run(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(pool->idleLock);
+		pool->idleCond.wait(lock, [] { return pool->queuedJobs.load() > 0; });
+	}
+}
+
+bool DTCPWorkerStart(uint32_t count)
+{
+	std::lock_guard<std::mutex> lock(startLock);
+	if (numWorkers.load() != 0 || count == 0 || count > DTCP_MAX_WORKERS)
+	{
+		return false;
+	}
+	pool = new (std::nothrow) workerPool;
+	if (pool == NULL)
+	{
+		return false;
+	}
+	pool->nextQueue.store(0);
+	pool->queuedJobs.store(0);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		try
+		{
+			std::thread(workerMain, (int)i, count).detach();
+		}
+		catch (const std::system_error &)
+		{
+			/* The threads already started serve a pool of their own size. */
+			if (i == 0)
+			{
+				delete pool;
+				pool = NULL;
+				return false;
+			}
+			count = i;
+			break;
+		}
+	}
+	numWorkers.store(count);
+	return true;
+}
+
+uint32_t DTCPWorkerCount(void)
+{
+	return numWorkers.load();
+}
+
+void DTCPWorkerSubmit(DTCPJob *job)
+{
+	uint32_t count = numWorkers.load();
+	if (count == 0)
+	{
+		job->run(job);
+		return;
+	}
+	uint32_t index = (workerIndex >= 0) ? (uint32_t)workerIndex : pool->nextQueue.fetch_add(1) % count;
+	{
+		std::lock_guard<std::mutex> lock(pool->queues[index].lock);
+		pool->queues[index].jobs.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> lock(pool->idleLock);
+		pool->queuedJobs.fetch_add(1);
+	}
+	pool->idleCond.notify_one();
+}
@@ -0,0 +1,66 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file   dtcpworker.h
+ * Worker pool of the reference DTCP Manager.
+ *
+ * Each worker owns a job deque. Jobs submitted from outside the pool are
+ * spread round robin over the deques; a job submitted by a worker goes to
+ * that worker's own deque, where it runs next while its data is still in
+ * cache. A worker takes its newest job first and, when its deque is empty,
+ * steals the oldest job of another worker.
+ */
+
+#ifndef __DTCPWORKER_H_
+#define __DTCPWORKER_H_
+
+#include <stdint.h>
+
+#define DTCP_MAX_WORKERS 64
+
+typedef struct DTCPJob_s DTCPJob;
+typedef void (*DTCPJobFunc)(DTCPJob *job);
+
+/**
+ * @brief A unit of work, embedded in the caller's own job structure.
+ */
+struct DTCPJob_s
+{
+	DTCPJobFunc run;
+};
+
+/**
+ * @brief Starts @a numWorkers worker threads; the pool lives until the process exits.
+ *
+ * @return false if the pool is already running or a thread could not be started.
+ */
+bool DTCPWorkerStart(uint32_t numWorkers);
+
+/**
+ * @brief Returns the number of worker threads, 0 if the pool is not running.
+ */
+uint32_t DTCPWorkerCount(void);
+
+/**
+ * @brief Queues @a job, or runs it in the calling thread if the pool is not running.
+ */
+void DTCPWorkerSubmit(DTCPJob *job);
+
+#endif //__DTCPWORKER_H_